@@ -0,0 +1,685 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>       // For std::remove
+#include <cstdlib>      // For atof
+#include <ctime>
+
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+#include "Trajectory.h"
+#include "TrajectoryFile.h"
+#include "Batch.h"
+#include "ResultCache.h"
+#include "Network.h"
+#include "FrequencyResponse.h"
+#include "Identification.h"
+#include "Analytic.h"
+#include "SoaRK4.h"
+#include "RealTime.h"
+#include "Nonlinear.h"
+#include "OutputPolicy.h"
+#include "Parareal.h"
+#include "Server.h"
+#include "Forcing.h"
+#include "utils.h"
+
+using namespace std;
+
+// Microbenchmarks of the solvers, the stop logic and the file writers.
+// Every case is calibrated to run at least --min-time seconds, repeated
+// REPEATS times; the fastest repeat is reported (least disturbed by the OS).
+// Results are printed as a table and written as JSON (Google Benchmark layout,
+// so the usual compare tools can diff two releases).
+
+static const int REPEATS = 5;
+
+// Set by the correctness checks some groups run before timing (exit code 4).
+static bool checks_failed = false;
+
+// One measured case.
+struct BenchResult{
+    string name;
+    long iterations;                         // Calls per repeat
+    double ns_per_iter;                      // Fastest repeat
+    double median_ns_per_iter;
+    vector<pair<string, double>> counters;   // Derived figures (ns/step, MB/s, ...)
+};
+
+struct BenchOptions{
+    double min_time = 0.2;          // [s] per repeat
+    string filter;                  // Only names containing this
+    string json_file = "bench_results.json";
+    string scratch = "msd_bench_tmp"; // Prefix of the temporary files
+};
+
+// Discards every sample but keeps the last one, so nothing can be optimized away.
+class NullSink : public TrajectorySink{
+public:
+    double last_t = 0, checksum = 0;
+    long samples = 0;
+    void write(double t, double x, double v, double a) override { last_t = t; checksum += x; samples++; (void)v; (void)a; }
+};
+
+// Silences cout (the writers print a line per exported file) while alive.
+class QuietCout{
+private:
+    ostringstream sink;
+    streambuf* saved;
+public:
+    QuietCout() : saved(cout.rdbuf(sink.rdbuf())) {}
+    ~QuietCout() { cout.rdbuf(saved); }
+};
+
+// Times body() and returns per-call figures. body() is called 'iterations'
+// times per repeat; iterations grow until one repeat lasts min_time.
+template<class Body>
+static BenchResult measure(const string& name, const BenchOptions& opt, Body&& body){
+    typedef chrono::steady_clock clock;
+    BenchResult r;
+    r.name = name;
+
+    body(); // Warm-up (page faults, caches, first file creation)
+    long iterations = 1;
+    while(true){
+        clock::time_point start = clock::now();
+        for(long i = 0; i < iterations; i++) body();
+        double elapsed = chrono::duration<double>(clock::now() - start).count();
+        if(elapsed >= opt.min_time || iterations >= (1L << 30)) break;
+        // Aim a bit past min_time, without growing more than 10x per round.
+        double grow = (elapsed > 0) ? 1.4 * opt.min_time / elapsed : 10.0;
+        iterations = long(ceil(iterations * min(10.0, max(2.0, grow))));
+    }
+
+    vector<double> ns(REPEATS);
+    for(int rep = 0; rep < REPEATS; rep++){
+        clock::time_point start = clock::now();
+        for(long i = 0; i < iterations; i++) body();
+        ns[rep] = chrono::duration<double, nano>(clock::now() - start).count() / double(iterations);
+    }
+    sort(ns.begin(), ns.end());
+    r.iterations = iterations;
+    r.ns_per_iter = ns.front();
+    r.median_ns_per_iter = ns[REPEATS/2];
+    return r;
+}
+
+static bool selected(const BenchOptions& opt, const string& name){
+    return opt.filter.empty() || name.find(opt.filter) != string::npos;
+}
+
+static void print_result(const BenchResult& r){
+    cout << left << setw(36) << r.name << right << setw(14) << fixed << setprecision(1) << r.ns_per_iter << " ns"
+         << setw(11) << r.iterations;
+    for(const auto& c : r.counters){
+        cout << "  " << c.first << "=";
+        if(c.second != 0 && abs(c.second) < 1e-3) cout << scientific << setprecision(2) << c.second << fixed; // Errors
+        else cout << setprecision(c.second < 100 ? 3 : 1) << c.second;
+    }
+    cout << defaultfloat << endl;
+}
+
+// --- Cases ---
+
+struct Regime{
+    const char* name;
+    double m, c, k, xo, vo;
+};
+
+// zeta = c / (2*sqrt(k*m)): 0.008, 1 and 4.7 for m = 1, k = 1000.
+static const Regime REGIMES[] = {
+    {"underdamped", 1, 0.5, 1000, 1, 0},
+    {"critical",    1, 63.245553203367585, 1000, 1, 0},
+    {"overdamped",  1, 300, 1000, 1, 0},
+};
+
+static const Solver SOLVERS[] = {Solver::Euler, Solver::RK4, Solver::RK45, Solver::Verlet, Solver::Exact};
+static const char* const SOLVER_NAMES[] = {"euler", "rk4", "rk45", "verlet", "exact"};
+static const int SOLVER_COUNT = sizeof(SOLVERS) / sizeof(SOLVERS[0]);
+
+static MassSpringDamper make_system(const Regime& r){
+    MassSpringDamper s;
+    s.set_parameters(r.m, r.c, r.k, r.xo, r.vo);
+    return s;
+}
+
+// Largest |x| error of a run against the exact solution, over every step.
+static double run_max_error(const MassSpringDamper& s, Solver solver){
+    struct ErrorSink : public TrajectorySink{
+        ErrorTracker error;
+        explicit ErrorSink(const MassSpringDamper& s_) : error(s_) {}
+        void write(double t, double x, double v, double a) override { error.add(t, x, v); (void)a; }
+    } sink(s);
+    simulate(s, solver, sink);
+    return sink.error.report().max_x_error;
+}
+
+// ns/step of each integrator, without any I/O, plus the summary-only path used by batch runs.
+// The adaptive solver also reports its wall time over fixed-step RK4's on the same run
+// (wall_vs_rk4 < 1: faster) and both global errors, since fewer steps only pay off if
+// they cost less in total at a comparable accuracy.
+static void bench_solvers(const BenchOptions& opt, vector<BenchResult>& out){
+    for(const Regime& reg : REGIMES){
+        MassSpringDamper s = make_system(reg);
+        double rk4_ns = 0;
+        for(int i = 0; i < SOLVER_COUNT; i++){
+            string name = string("solver/") + SOLVER_NAMES[i] + "/" + reg.name;
+            if(selected(opt, name)){
+                NullSink sink;
+                int steps = simulate(s, SOLVERS[i], sink).accepted;
+                BenchResult r = measure(name, opt, [&]{ simulate(s, SOLVERS[i], sink); });
+                r.counters.push_back({"steps", double(steps)});
+                r.counters.push_back({"ns_per_step", r.ns_per_iter / steps});
+                if(SOLVERS[i] == Solver::RK4) rk4_ns = r.ns_per_iter;
+                if(SOLVERS[i] == Solver::RK45){
+                    if(rk4_ns == 0) rk4_ns = measure(name, opt, [&]{ simulate(s, Solver::RK4, sink); }).ns_per_iter;
+                    r.counters.push_back({"wall_vs_rk4", r.ns_per_iter / rk4_ns});
+                    r.counters.push_back({"max_error", run_max_error(s, Solver::RK45)});
+                    r.counters.push_back({"rk4_max_error", run_max_error(s, Solver::RK4)});
+                }
+                out.push_back(r);
+                print_result(r);
+            }
+
+            name = string("summary/") + SOLVER_NAMES[i] + "/" + reg.name;
+            if(selected(opt, name)){
+                int steps = simulate_summary(s, SOLVERS[i]).steps;
+                BenchResult r = measure(name, opt, [&]{ simulate_summary(s, SOLVERS[i]); });
+                r.counters.push_back({"steps", double(steps)});
+                r.counters.push_back({"ns_per_step", r.ns_per_iter / steps});
+                out.push_back(r);
+                print_result(r);
+            }
+        }
+    }
+}
+
+// Cost of the peak-detection stop logic: the same run with the rule on and
+// off (simulate_for() over the same time span), compared per step.
+static void bench_stop_logic(const BenchOptions& opt, vector<BenchResult>& out){
+    for(const Regime& reg : REGIMES){
+        MassSpringDamper s = make_system(reg);
+        for(int i = 0; i < SOLVER_COUNT; i++){
+            string name = string("stop_logic/") + SOLVER_NAMES[i] + "/" + reg.name;
+            if(!selected(opt, name)) continue;
+
+            NullSink sink;
+            int steps_on = simulate(s, SOLVERS[i], sink).accepted;
+            double t_end = sink.last_t;
+            int steps_off = simulate_for(s, SOLVERS[i], t_end, sink).accepted;
+
+            BenchResult on = measure(name, opt, [&]{ simulate(s, SOLVERS[i], sink); });
+            BenchResult off = measure(name, opt, [&]{ simulate_for(s, SOLVERS[i], t_end, sink); });
+            double ns_on = on.ns_per_iter / steps_on, ns_off = off.ns_per_iter / steps_off;
+
+            on.counters.push_back({"steps", double(steps_on)});
+            on.counters.push_back({"ns_per_step", ns_on});
+            on.counters.push_back({"ns_per_step_without", ns_off});
+            on.counters.push_back({"overhead_ns_per_step", ns_on - ns_off});
+            on.counters.push_back({"overhead_pct", 100.0 * (ns_on - ns_off) / ns_off});
+            out.push_back(on);
+            print_result(on);
+        }
+    }
+}
+
+// Throughput of every way a trajectory reaches the disk, on the same data.
+static void bench_export(const BenchOptions& opt, vector<BenchResult>& out){
+    const size_t N = 1 << 18;
+    vector<double> t(N), x(N), v(N), a(N);
+    for(size_t i = 0; i < N; i++){
+        t[i] = i * 1e-3;
+        x[i] = exp(-0.05*t[i]) * cos(31.6*t[i]);
+        v[i] = -31.6 * exp(-0.05*t[i]) * sin(31.6*t[i]);
+        a[i] = -1000 * x[i];
+    }
+    const string csv_file = opt.scratch + ".csv", bin_file = opt.scratch + ".msdt";
+    vector<BenchResult> results;
+
+    auto add = [&](BenchResult r, size_t bytes){
+        r.counters.push_back({"MB", bytes / 1e6});
+        r.counters.push_back({"MB_per_s", bytes / (r.ns_per_iter * 1e-3)});
+        r.counters.push_back({"ns_per_sample", r.ns_per_iter / N});
+        results.push_back(r);
+    };
+    auto file_size = [](const string& f){
+        ifstream in(f, ios::binary | ios::ate);
+        return in ? size_t(in.tellg()) : size_t(0);
+    };
+
+    {
+        QuietCout quiet;
+        if(selected(opt, "export/csv_stream")){
+            BenchResult r = measure("export/csv_stream", opt, [&]{
+                CsvStreamWriter w(csv_file);
+                for(size_t i = 0; i < N; i++) w.write(t[i], x[i], v[i], a[i]);
+            });
+            add(r, file_size(csv_file));
+        }
+        if(selected(opt, "export/msdt_stream")){
+            BenchResult r = measure("export/msdt_stream", opt, [&]{
+                BinaryStreamWriter w(bin_file);
+                for(size_t i = 0; i < N; i++) w.write(t[i], x[i], v[i], a[i]);
+            });
+            add(r, file_size(bin_file));
+        }
+        if(selected(opt, "export/export_results")){
+            BenchResult r = measure("export/export_results", opt, [&]{ export_results(t, x, v, a, csv_file); });
+            add(r, file_size(csv_file));
+        }
+        if(selected(opt, "export/msdt_to_csv")){
+            {
+                BinaryStreamWriter w(bin_file);
+                for(size_t i = 0; i < N; i++) w.write(t[i], x[i], v[i], a[i]);
+            }
+            BenchResult r = measure("export/msdt_to_csv", opt, [&]{ export_results_csv(bin_file, csv_file); });
+            add(r, file_size(csv_file));
+        }
+    }
+    remove(csv_file.c_str());
+    remove(bin_file.c_str());
+
+    for(const BenchResult& r : results){
+        out.push_back(r);
+        print_result(r);
+    }
+}
+
+// Largest gap between the lanes of the SIMD kernel and scalar RK4 over a
+// grid of zeta regimes (30 systems, so the last block is padded). Peak and
+// final amplitude count relative to the peak, settling time in steps; a
+// lane that stops on another step than the scalar run gives 1. The kernel
+// steps with the same map, so only fused multiply-adds separate them (~1e-15).
+static double soa_kernel_gap(){
+    vector<MassSpringDamper> systems;
+    for(double zeta : {0.002, 0.01, 0.05, 0.3, 0.7, 0.99, 1.0, 1.01, 2.0, 5.0}){
+        for(double k : {10.0, 1000.0, 1e5}){
+            MassSpringDamper s;
+            s.set_parameters(1, 2*zeta*sqrt(k), k, 1, (systems.size() % 2) ? -3 : 0);
+            systems.push_back(s);
+        }
+    }
+    OscillatorSoA soa;
+    load_soa(soa, systems.data(), systems.size());
+    vector<SimSummary> lanes(systems.size());
+    rk4_soa(soa, lanes.data());
+
+    double gap = 0;
+    for(size_t i = 0; i < systems.size(); i++){
+        SimSummary scalar = simulate_summary(systems[i], Solver::RK4);
+        if(scalar.steps != lanes[i].steps) gap = max(gap, 1.0);
+        gap = max(gap, abs(scalar.peak - lanes[i].peak) / scalar.peak);
+        gap = max(gap, abs(scalar.final_amplitude - lanes[i].final_amplitude) / scalar.peak);
+        gap = max(gap, abs(scalar.settling_time - lanes[i].settling_time) / default_dt(systems[i]));
+    }
+    return gap;
+}
+
+// Whole-grid throughput of the batch runner (all hardware threads).
+// Checked first: every lane of the SoA kernel against scalar RK4 (within 1e-12).
+static void bench_batch(const BenchOptions& opt, vector<BenchResult>& out){
+    if(selected(opt, "batch/rk4")){
+        double gap = soa_kernel_gap();
+        if(gap > 1e-12){
+            cout << "Error: the " << rk4_soa_isa() << " RK4 kernel strays from scalar RK4 (" << gap << ")" << endl;
+            checks_failed = true;
+        }
+    }
+
+    size_t rejected;
+    vector<MassSpringDamper> grid = build_grid({0.5, 5, 20}, {0.1, 50, 20}, {1, 1000, 20}, 1, 0, &rejected);
+    for(int i = 0; i < 3; i++){
+        string name = string("batch/") + SOLVER_NAMES[i];
+        if(!selected(opt, name)) continue;
+        BenchResult r = measure(name, opt, [&]{ run_batch(grid, SOLVERS[i]); });
+        r.counters.push_back({"systems", double(grid.size())});
+        r.counters.push_back({"systems_per_s", grid.size() / (r.ns_per_iter * 1e-9)});
+        out.push_back(r);
+        print_result(r);
+    }
+
+    // Reduced precision: float kernel plus the error estimates (and the double re-runs).
+    const char* precision_names[2] = {"batch/rk4/single", "batch/rk4/mixed"};
+    const Precision precisions[2] = {Precision::Single, Precision::Mixed};
+    for(int i = 0; i < 2; i++){
+        if(!selected(opt, precision_names[i])) continue;
+        PrecisionOptions popt;
+        popt.precision = precisions[i];
+        PrecisionReport report;
+        BenchResult r = measure(precision_names[i], opt, [&]{ run_batch_precision(grid, popt, 0, &report); });
+        r.counters.push_back({"systems", double(grid.size())});
+        r.counters.push_back({"systems_per_s", grid.size() / (r.ns_per_iter * 1e-9)});
+        r.counters.push_back({"flagged", double(report.flagged)});
+        r.counters.push_back({"max_error", report.max_error});
+        out.push_back(r);
+        print_result(r);
+    }
+
+    // The same grid again through a warm cache: what a repeated sweep costs.
+    const char* cached_name = "batch/rk4/cached";
+    if(selected(opt, cached_name)){
+        ResultCache cache("", grid.size());
+        run_batch(grid, Solver::RK4, 0, &cache);
+        BenchResult r = measure(cached_name, opt, [&]{ run_batch(grid, Solver::RK4, 0, &cache); });
+        r.counters.push_back({"systems", double(grid.size())});
+        r.counters.push_back({"systems_per_s", grid.size() / (r.ns_per_iter * 1e-9)});
+        out.push_back(r);
+        print_result(r);
+    }
+}
+
+// N-DOF force evaluation + RK4 update: time per step should grow with the
+// number of springs, not with N^2.
+static void bench_network(const BenchOptions& opt, vector<BenchResult>& out){
+    const int STEPS = 20;
+    for(size_t n : {size_t(1000), size_t(10000), size_t(100000)}){
+        for(int topology = 0; topology < 2; topology++){
+            string name = string(topology == 0 ? "network/chain/" : "network/mesh/") + to_string(n);
+            if(!selected(opt, name)) continue;
+
+            SpringNetwork net;
+            size_t side = size_t(sqrt(double(n)) + 0.5);
+            if(topology == 0) build_chain(net, n, 1, 1000, 0.1, true);
+            else build_mesh(net, side, side, 1, 1000, 0.1);
+            net.x[0] = 0.01;
+            double t_end = STEPS * net.stable_dt();
+
+            BenchResult r = measure(name, opt, [&]{ simulate_network(net, Solver::RK4, t_end); });
+            r.counters.push_back({"masses", double(net.size())});
+            r.counters.push_back({"springs", double(net.spring_count())});
+            r.counters.push_back({"ns_per_step", r.ns_per_iter / STEPS});
+            r.counters.push_back({"ns_per_spring_step", r.ns_per_iter / STEPS / net.spring_count()});
+            out.push_back(r);
+            print_result(r);
+        }
+    }
+}
+
+// Frequency sweeps: the transfer-function fast path against forced simulations.
+static void bench_bode(const BenchOptions& opt, vector<BenchResult>& out){
+    MassSpringDamper s = make_system(REGIMES[0]);
+    const struct { const char* name; ResponseMethod method; int points; } cases[] = {
+        {"bode/analytic/10000", ResponseMethod::Analytic, 10000},
+        {"bode/simulated/100", ResponseMethod::Simulated, 100},
+    };
+    for(const auto& c : cases){
+        if(!selected(opt, c.name)) continue;
+        vector<double> omegas = log_frequencies(s.get_wn()/100, s.get_wn()*100, c.points);
+        BenchResult r = measure(c.name, opt, [&]{ frequency_sweep(s, omegas, c.method); });
+        r.counters.push_back({"points", double(c.points)});
+        r.counters.push_back({"ns_per_point", r.ns_per_iter / c.points});
+        out.push_back(r);
+        print_result(r);
+    }
+}
+
+// Parameter identification on a clean 10^5-sample log (exact free response).
+static void bench_fit(const BenchOptions& opt, vector<BenchResult>& out){
+    const char* name = "fit/lm/100000";
+    if(!selected(opt, name)) return;
+    MassSpringDamper s = make_system(REGIMES[0]);
+    FreeResponse exact(s);
+    Measurement data;
+    for(int i = 0; i < 100000; i++){
+        data.t.push_back(i*1e-4);
+        data.x.push_back(exact.x(i*1e-4));
+    }
+    data.v0 = s.get_vo();
+    BenchResult r = measure(name, opt, [&]{ fit_parameters(data, s.get_m()); });
+    r.counters.push_back({"samples", double(data.t.size())});
+    out.push_back(r);
+    print_result(r);
+}
+
+// One call of the real-time stepper (10 kHz step, changing force), with and
+// without its own latency recording (two clock reads per step).
+static void bench_realtime(const BenchOptions& opt, vector<BenchResult>& out){
+    MassSpringDamper s = make_system(REGIMES[0]);
+    const int steps = 10000;
+    for(int i = 0; i < SOLVER_COUNT; i++){
+        if(SOLVERS[i] == Solver::RK45) continue;
+        for(int timed = 0; timed < 2; timed++){
+            string name = string("realtime/") + SOLVER_NAMES[i] + (timed ? "/timed" : "/untimed");
+            if(!selected(opt, name)) continue;
+            RealTimeStepper stepper(s, SOLVERS[i], timed == 1);
+            BenchResult r = measure(name, opt, [&]{
+                for(int k = 0; k < steps; k++) stepper.step(1e-4, (k & 63) * 0.01);
+            });
+            r.counters.push_back({"ns_per_step", r.ns_per_iter / steps});
+            out.push_back(r);
+            print_result(r);
+        }
+    }
+}
+
+// Largest distance of the samples of 'sub' (a decimated run) outside the
+// range of the two steps of 'full' around them, relative to the largest
+// |a| of the run. The range is widened by the largest change over the
+// neighbouring steps (an extremum between two steps overshoots both).
+// ~0 when the decimated samples agree with the full-resolution ones.
+static double decimation_excess(const TrajectoryBuffer& full, const TrajectoryBuffer& sub){
+    double excess = 0, scale = 1e-300;
+    for(double a : full.a) scale = max(scale, abs(a));
+    const size_t n = full.t.size();
+    size_t k = 0;
+    for(size_t i = 0; i < sub.t.size(); i++){
+        while(k + 2 < n && full.t[k + 1] < sub.t[i]) k++;
+        for(const vector<double>* c : {&full.x, &full.v, &full.a}){
+            const vector<double>& f = *c;
+            double slack = 0;
+            for(size_t j = (k > 0 ? k - 1 : 0); j + 1 < n && j <= k + 1; j++) slack = max(slack, abs(f[j + 1] - f[j]));
+            const double value = (c == &full.x) ? sub.x[i] : (c == &full.v) ? sub.v[i] : sub.a[i];
+            const double lo = min(f[k], f[k + 1]) - slack, hi = max(f[k], f[k + 1]) + slack;
+            excess = max(excess, max(lo - value, value - hi)/scale);
+        }
+    }
+    return excess;
+}
+
+// ns/step of the nonlinear loop (RK4, 10 s): the linear case through the same
+// loop, then each force law, with the events located per run.
+static void bench_nonlinear(const BenchOptions& opt, vector<BenchResult>& out){
+    MassSpringDamper s;
+    s.set_parameters(1, 0.2, 100, 0.1, 0);
+    Forcing drive = harmonic_force(3, 5);
+    struct Case{ const char* name; NonlinearForces forces; const Forcing* force; };
+    Case cases[5];
+    cases[0].name = "linear";
+    cases[1].name = "duffing";    cases[1].forces.k3 = 1e4;
+    cases[2].name = "friction";   cases[2].forces.friction = 0.2;
+    cases[3].name = "stops";      cases[3].forces.x_min = -0.05; cases[3].forces.x_max = 0.15; cases[3].forces.restitution = 0.9;
+    cases[4].name = "stick_slip"; cases[4].forces.friction = 1; cases[4].forces.static_friction = 1.5;
+    for(int i = 0; i < 4; i++) cases[i].force = nullptr;
+    cases[4].force = &drive;
+
+    for(const Case& c : cases){
+        string name = string("nonlinear/rk4/") + c.name;
+        if(!selected(opt, name)) continue;
+        NullSink sink;
+        EventStats ev;
+        int steps = simulate_nonlinear(s, c.forces, Solver::RK4, c.force, 10, sink, &ev).accepted;
+
+        // Check: interval output interpolates the every-step output
+        TrajectoryBuffer full, decimated;
+        OutputPolicy interval;
+        interval.mode = OutputMode::FixedInterval;
+        interval.interval = 0.0105;
+        DecimatingSink decimating(decimated, interval);
+        simulate_nonlinear(s, c.forces, Solver::RK4, c.force, 10, full);
+        simulate_nonlinear(s, c.forces, Solver::RK4, c.force, 10, decimating);
+        double excess = decimation_excess(full, decimated);
+        if(excess > 1e-9){
+            cout << "Error: interval output of " << name << " strays from the every-step output (" << excess << ")" << endl;
+            checks_failed = true;
+        }
+
+        BenchResult r = measure(name, opt, [&]{ simulate_nonlinear(s, c.forces, Solver::RK4, c.force, 10, sink); });
+        r.counters.push_back({"steps", double(steps)});
+        r.counters.push_back({"events", double(ev.impacts + ev.sticks + ev.slips + ev.reversals + ev.contacts)});
+        r.counters.push_back({"ns_per_step", r.ns_per_iter / steps});
+        r.counters.push_back({"interval_excess", excess});
+        out.push_back(r);
+        print_result(r);
+    }
+}
+
+// Parareal on one lightly damped run (2000 periods) per coarse propagator,
+// against the same RK4 steps taken serially.
+static void bench_parareal(const BenchOptions& opt, vector<BenchResult>& out){
+    MassSpringDamper s;
+    s.set_parameters(1, 0.01, 1000, 1, 0);
+    const char* names[2] = {"exact", "euler"};
+    const CoarseMethod methods[2] = {CoarseMethod::Exact, CoarseMethod::Euler};
+    for(int i = 0; i < 2; i++){
+        string name = string("parareal/") + names[i];
+        if(!selected(opt, name)) continue;
+        PararealOptions popt;
+        popt.coarse = methods[i];
+        PararealResult first = parareal(s, nullptr, 2000*s.get_T(), popt);
+        popt.serial_reference = false;
+        BenchResult r = measure(name, opt, [&]{ parareal(s, nullptr, 2000*s.get_T(), popt); });
+        r.counters.push_back({"slices", double(first.t.size() - 1)});
+        r.counters.push_back({"iterations", double(first.iterations)});
+        r.counters.push_back({"converged", first.converged ? 1.0 : 0.0});
+        r.counters.push_back({"ns_per_step", r.ns_per_iter / first.steps});
+        r.counters.push_back({"serial_ns_per_step", 1e9*first.serial_seconds / first.steps});
+        r.counters.push_back({"speedup", 1e9*first.serial_seconds / r.ns_per_iter});
+        out.push_back(r);
+        print_result(r);
+    }
+}
+
+// Summary requests through a local server: one round trip at a time (latency)
+// and PIPELINE requests in flight on one connection (what batching buys).
+static void bench_server(const BenchOptions& opt, vector<BenchResult>& out){
+    const int PIPELINE = 256; // 22 kB of requests, 22 kB of replies: fits the socket buffers
+    const char* names[2] = {"server/summary/round_trip", "server/summary/pipelined"};
+    if(!selected(opt, names[0]) && !selected(opt, names[1])) return;
+
+    ServerOptions sopt;
+    sopt.socket_path = opt.scratch + ".sock";
+    sopt.batch_window_us = 50;
+    SimulationServer server(sopt);
+    ServerClient client;
+    if(!server.start() || !client.connect(sopt.socket_path)) return;
+
+    MassSpringDamper s;
+    s.set_parameters(1, 0.5, 100, 0.1, 0);
+    for(int i = 0; i < 2; i++){
+        if(!selected(opt, names[i])) continue;
+        const int n = (i == 0) ? 1 : PIPELINE;
+        ServerStats before = server.stats();
+        BenchResult r = measure(names[i], opt, [&]{
+            for(int j = 0; j < n; j++) client.send(make_request(RequestType::Summary, uint64_t(j), s, Solver::RK4));
+            ServerReply reply;
+            for(int j = 0; j < n; j++) client.receive(reply);
+        });
+        ServerStats after = server.stats();
+        double batches = after.batches - before.batches;
+        r.counters.push_back({"requests_per_s", n / (r.ns_per_iter * 1e-9)});
+        r.counters.push_back({"mean_batch", (batches > 0) ? (after.batched - before.batched)/batches : 0});
+        out.push_back(r);
+        print_result(r);
+    }
+}
+
+// --- JSON output ---
+
+static string json_escape(const string& text){
+    string out;
+    for(char ch : text){
+        if(ch == '"' || ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+static bool write_json(const string& filename, const vector<BenchResult>& results){
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    file << setprecision(10);
+    file << "{\n  \"context\": {\n"
+         << "    \"date\": \"" << date << "\",\n"
+         << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+#if defined(__VERSION__)
+         << "    \"compiler\": \"" << json_escape(__VERSION__) << "\",\n"
+#endif
+#ifdef NDEBUG
+         << "    \"library_build_type\": \"release\",\n"
+#else
+         << "    \"library_build_type\": \"debug\",\n"
+#endif
+         << "    \"soa_kernel\": \"" << rk4_soa_isa() << "\",\n"
+         << "    \"repetitions\": " << REPEATS << "\n"
+         << "  },\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); i++){
+        const BenchResult& r = results[i];
+        file << "    {\n"
+             << "      \"name\": \"" << json_escape(r.name) << "\",\n"
+             << "      \"iterations\": " << r.iterations << ",\n"
+             << "      \"real_time\": " << r.ns_per_iter << ",\n"
+             << "      \"median_real_time\": " << r.median_ns_per_iter << ",\n"
+             << "      \"time_unit\": \"ns\"";
+        for(const auto& c : r.counters){
+            file << ",\n      \"" << c.first << "\": " << c.second;
+        }
+        file << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return true;
+}
+
+static void usage(){
+    cout << "Usage: msd_bench [--json <file>] [--filter <text>] [--min-time <seconds>] [--scratch <path prefix>]\n"
+            "  Groups: solver/, summary/, stop_logic/, export/, batch/, network/, bode/, realtime/, nonlinear/, parareal/, server/ (e.g. --filter stop_logic/rk4)\n";
+}
+
+int main(int argc, char* argv[]){
+    BenchOptions opt;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(arg == "--json" && has_value) opt.json_file = argv[++i];
+        else if(arg == "--filter" && has_value) opt.filter = argv[++i];
+        else if(arg == "--scratch" && has_value) opt.scratch = argv[++i];
+        else if(arg == "--min-time" && has_value) opt.min_time = atof(argv[++i]);
+        else { usage(); return (arg == "--help") ? 0 : 1; }
+    }
+    if(opt.min_time <= 0){
+        usage();
+        return 1;
+    }
+
+    cout << left << setw(36) << "benchmark" << right << setw(17) << "time/iter" << setw(11) << "iters" << endl;
+    vector<BenchResult> results;
+    bench_solvers(opt, results);
+    bench_stop_logic(opt, results);
+    bench_export(opt, results);
+    bench_batch(opt, results);
+    bench_network(opt, results);
+    bench_bode(opt, results);
+    bench_fit(opt, results);
+    bench_realtime(opt, results);
+    bench_nonlinear(opt, results);
+    bench_parareal(opt, results);
+    bench_server(opt, results);
+
+    if(!write_json(opt.json_file, results)) return 3;
+    cout << "'" << opt.json_file << "' file successfully exported!" << endl;
+    return checks_failed ? 4 : 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "MassSpringDamper.h"
+#include "Simulation.h" // For StepMap
+
+/**
+ * @class FreeResponse
+ * @brief Exact free response x(t), v(t) of a linear MSD system.
+ * All constants of the closed-form solution are computed once in the
+ * constructor, so every evaluation is O(1) no matter how large t is.
+ */
+class FreeResponse{
+private:
+    // 0 = underdamped, 1 = critically damped, 2 = overdamped
+    int regime;
+    // Under:    x = e^(-sigma t) (A cos(wd t) + B sin(wd t))
+    // Critical: x = e^(-sigma t) (A + B t)
+    // Over:     x = A e^(r1 t) + B e^(r2 t)
+    double sigma, wd, r1, r2, A, B;
+
+public:
+    explicit FreeResponse(const MassSpringDamper& s);
+
+    // Position and velocity at time t.
+    void state(double t, double& x, double& v) const;
+    double x(double t) const;
+    double v(double t) const;
+
+    // Evaluates n time points in one call (the regime branch is taken once).
+    void evaluate(const double* t, size_t n, double* x, double* v) const;
+};
+
+// Global error of a numerical trajectory against the exact solution.
+struct ErrorReport{
+    double max_x_error;  // max |x_num - x_exact| [m]
+    double max_v_error;  // max |v_num - v_exact| [m/s]
+    double rms_x_error;  // RMS of the position error [m]
+};
+
+// Compares a sampled trajectory (as produced by euler()/rk4()/rk45()) to FreeResponse.
+ErrorReport global_error(const MassSpringDamper& s, const std::vector<double>& t, const std::vector<double>& x, const std::vector<double>& v);
+
+// Streaming form of global_error(): samples are fed one at a time,
+// so the trajectory never has to be stored.
+class ErrorTracker{
+private:
+    FreeResponse exact;
+    ErrorReport r;
+    double sum_sq;
+    size_t n;
+
+public:
+    explicit ErrorTracker(const MassSpringDamper& s);
+    void add(double t, double x, double v);
+    ErrorReport report() const;
+};
+
+// Exact discretization of the linear system over one step dt, with an input
+// u = F/m [m/s^2] held constant over the step (zero-order hold):
+//   x' = xx*x + xv*v + xu*u,  v' = vx*x + vv*v + vu*u
+// 'map' is the transition matrix exp(A*dt) as a StepMap (ax, av: acceleration
+// at the end of the step for u = 0). There is no stability limit: any dt is exact.
+struct ExactStepMap{
+    StepMap map;
+    double xu, vu;
+};
+
+// Computed from wn and zeta alone, in closed form (series near critical
+// damping and for small steps, where the closed forms lose digits).
+ExactStepMap exact_step_map(double wn, double zeta, double dt);
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+class ResultCache;
+
+// One axis of a parameter grid: n points evenly spaced in [min, max].
+struct SweepRange{
+    double min;
+    double max;
+    int n;
+};
+
+// A simulated system and its summary metrics.
+struct BatchResult{
+    MassSpringDamper system;
+    SimSummary summary;
+    // Reduced-precision sweeps only (run_batch_precision)
+    double float_error = 0; // Estimated error of the float run, see PrecisionReport; 0 = ran in double only
+    bool rerun = false;     // The summary comes from a double re-run
+};
+
+// Arithmetic of an RK4 sweep.
+//   Double: the usual double-precision kernel
+//   Single: float kernel (twice the SIMD lanes, half the memory); every
+//           result carries its estimated error and the ones above the
+//           tolerance are flagged
+//   Mixed:  Single, then the flagged systems run again in double
+enum class Precision { Double, Single, Mixed };
+
+struct PrecisionOptions{
+    Precision precision = Precision::Mixed;
+    double tolerance = 1e-3; // Largest float error accepted, relative to the peak (the settling band is 2%)
+};
+
+// Accuracy of a reduced-precision sweep.
+// The error of a system is the distance between its final float state and
+// the double RK4 state after the same number of steps (the double step map
+// raised to that power), sqrt(dx^2 + (dv/wn)^2), relative to the peak.
+// It grows with the number of steps: lightly damped systems over long
+// horizons are the ones that get flagged. Metrics that threshold the state
+// (settling time, the stop step) can still move by half a period where a
+// peak sits within rounding of the 2% band, whatever the error.
+struct PrecisionReport{
+    size_t single = 0;     // Systems run in float
+    size_t too_long = 0;   // Run in double only: more steps than SOA_FLOAT_MAX_STEPS
+    size_t flagged = 0;    // Float error above the tolerance
+    size_t rerun = 0;      // Flagged systems simulated again in double (Mixed)
+    double max_error = 0;  // Largest float error
+    size_t worst = 0;      // Index of that system
+    double seconds = 0;    // Float sweep, error estimates included
+    double rerun_seconds = 0;
+};
+
+// --- Batch Sweep Prototypes ---
+
+// Builds every (m, c, k) combination of the three ranges with fixed xo/vo.
+// Combinations that fail validate_parameters are skipped and counted in 'rejected'.
+std::vector<MassSpringDamper> build_grid(const SweepRange& m, const SweepRange& c, const SweepRange& k, double xo, double vo, size_t* rejected);
+
+// Reads "m,c,k,xo,vo" lines from a text file (a non-numeric header line is allowed).
+// Invalid or malformed lines are skipped and counted in 'rejected'.
+std::vector<MassSpringDamper> read_parameter_list(const std::string& filename, size_t* rejected);
+
+// simulate_summary() of n systems on the calling thread. RK4 runs them
+// together through the SIMD kernel (SoaRK4.h), one system per lane.
+void simulate_summaries(const MassSpringDamper* systems, size_t n, Solver solver, SimSummary* out);
+
+// Simulates every system with simulate_summary() on a work-stealing pool.
+// Results keep the input order. 0 threads = one per hardware thread.
+// With a cache, systems already in it are not simulated again and the new
+// results are stored.
+std::vector<BatchResult> run_batch(const std::vector<MassSpringDamper>& systems, Solver solver, unsigned threads = 0,
+                                   ResultCache* cache = nullptr);
+
+// RK4 sweep in the given precision (Double is run_batch() without a cache).
+// Reduced-precision results are not cached: their keys would collide with double ones.
+std::vector<BatchResult> run_batch_precision(const std::vector<MassSpringDamper>& systems, const PrecisionOptions& opt,
+                                             unsigned threads = 0, PrecisionReport* report = nullptr);
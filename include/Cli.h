@@ -0,0 +1,13 @@
+#pragma once
+
+// Process exit codes of the headless modes.
+const int CLI_OK = 0;
+const int CLI_USAGE_ERROR = 1;        // Bad or missing arguments
+const int CLI_INVALID_PARAMETERS = 2; // validate_parameters() rejected the system
+const int CLI_IO_ERROR = 3;           // An input or output file could not be opened or written
+
+// --- Command-Line Driver Prototypes ---
+
+// Runs the non-interactive command given in argv[1] ("run", "batch", "bode", "parareal", "serve", "request", "network", "--help")
+// and returns the process exit code. Nothing here reads from cin.
+int run_cli(int argc, char* argv[]);
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <limits>
+
+// Shape of the external force F(t) applied to the mass.
+enum class ForceType { None, Harmonic, Step, Impulse, Sampled };
+
+/**
+ * @struct Forcing
+ * @brief External force F(t) [N].
+ *   Harmonic: amplitude * sin(omega*t + phase)
+ *   Step:     amplitude for t >= t0, 0 before
+ *   Impulse:  velocity jump of amplitude/m [amplitude in N.s] at t0
+ *   Sampled:  linear interpolation of (t, f) samples, 0 outside them
+ */
+struct Forcing{
+    ForceType type = ForceType::None;
+    double amplitude = 0; // [N], or [N.s] for an impulse
+    double omega = 0;     // [rad/s]
+    double phase = 0;     // [rad]
+    double t0 = 0;        // Start of a step / time of an impulse [s]
+    std::vector<double> t, f; // Sampled force: increasing times [s] and values [N]
+
+    // Continuous part of the force at time t (an impulse contributes nothing here).
+    double value(double time) const;
+
+    // Time where the force jumps (step start or impulse), infinity if none.
+    double discontinuity() const {
+        return (type == ForceType::Step || type == ForceType::Impulse) ? t0 : std::numeric_limits<double>::infinity();
+    }
+};
+
+// --- Forcing Prototypes ---
+
+// Builders for the common shapes.
+Forcing harmonic_force(double amplitude, double omega, double phase = 0);
+Forcing step_force(double amplitude, double t0 = 0);
+Forcing impulse_force(double impulse, double t0 = 0);
+
+// Reads "time,force" lines (an optional header line is allowed) into a Sampled force.
+// Times must increase. Prints an error and returns false otherwise.
+bool read_force_samples(const std::string& filename, Forcing& force);
+
+// Parses harmonic:A:w[:phase] | step:A[:t0] | impulse:J[:t0] | sampled:<file>.
+// Returns false on an unknown kind, a missing, extra or non-numeric field, or an invalid value.
+bool parse_forcing(const std::string& spec, Forcing& force);
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+// Steady-state response to F(t) = F0*sin(omega*t): x(t) = amplitude*F0*sin(omega*t + phase).
+struct FrequencyPoint{
+    double omega;     // Excitation frequency [rad/s]
+    double amplitude; // |X|/F0 [m/N]
+    double phase;     // Phase of x relative to F [rad], in [-pi, 0] for a linear system
+};
+
+// How a sweep computes each point.
+enum class ResponseMethod { Analytic, Simulated };
+
+// --- Frequency Response Prototypes ---
+
+// Transfer function H(jw) = 1/(k - m*w^2 + j*c*w), in O(1).
+FrequencyPoint transfer_function(const MassSpringDamper& s, double omega);
+
+// Measures the steady state from a forced simulation started at rest: waits
+// for the transient to decay (to e^-8, at most 2000 natural periods)
+// and correlates x(t) with sin/cos over 8 whole forcing periods. The step is
+// shortened to keep at least 64 steps per forcing period. Fixed-step solvers
+// only: RK45 falls back to RK4.
+FrequencyPoint simulated_response(const MassSpringDamper& s, double omega, Solver solver);
+
+// n frequencies evenly spaced on a log scale over [w_min, w_max].
+std::vector<double> log_frequencies(double w_min, double w_max, int n);
+
+// Computes every frequency on a work-stealing pool; results keep the input
+// order. 0 threads = one per hardware thread.
+std::vector<FrequencyPoint> frequency_sweep(const MassSpringDamper& s, const std::vector<double>& omegas, ResponseMethod method,
+                                            Solver solver = Solver::RK4, unsigned threads = 0);
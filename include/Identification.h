@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// A measured displacement log.
+struct Measurement{
+    std::vector<double> t, x; // Increasing times [s], displacements [m]
+    double v0 = 0;            // Initial velocity guess: velocity column, or (x1 - x0)/(t1 - t0)
+};
+
+// Estimated damping and stiffness of one fit (from one start).
+struct FitResult{
+    double c0 = 0, k0 = 0;  // Starting guess
+    double c = 0, k = 0;    // Estimate [N.s/m], [N/m]
+    double c_error = 0, k_error = 0; // One standard error, from the residual variance
+    double x0 = 0, v0 = 0;  // Fitted initial state [m], [m/s]
+    double rms = 0;         // RMS residual [m]
+    int iterations = 0;
+    bool converged = false;
+};
+
+// Settings of the Levenberg-Marquardt search.
+struct FitOptions{
+    int starts = 8;             // Initial guesses, from light to heavy damping
+    int max_iterations = 100;
+    double tolerance = 1e-10;   // Relative cost change that counts as converged
+    unsigned threads = 0;       // 0 = one per hardware thread
+};
+
+// --- Identification Prototypes ---
+
+// Reads a log in the results.csv layout (time, position[, velocity, ...]); a header
+// line is allowed. Prints an error and returns false on a bad or too short file.
+bool read_measurement(const std::string& filename, Measurement& data);
+
+// Least-squares fit of c and k (m known) with Levenberg-Marquardt; the initial
+// state x0, v0 is fitted along with them. The model is RK4, and its Jacobian
+// comes from the forward sensitivity equations (dx/dc, dx/dk, dx/dx0, dx/dv0)
+// integrated alongside the state in the same pass.
+// Every start runs as its own task on a work-stealing pool. Returns the fit with
+// the lowest residual; 'all' (optional) receives every start.
+FitResult fit_parameters(const Measurement& data, double m, const FitOptions& opt = FitOptions(),
+                         std::vector<FitResult>* all = nullptr);
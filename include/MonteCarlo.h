@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <string>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+// Samples per RNG stream. Stream b draws samples [b*B, (b+1)*B), so every
+// sample gets the same numbers whichever thread runs its block.
+const size_t MONTE_CARLO_BLOCK = 256;
+
+/**
+ * @class RandomStream
+ * @brief xoshiro256** generator, seeded from (seed, stream id) through splitmix64.
+ * The sampling below uses only its raw 64-bit output (no <random>
+ * distributions, whose results differ between standard libraries).
+ */
+class RandomStream{
+private:
+    uint64_t s[4];
+
+public:
+    RandomStream(uint64_t seed, uint64_t stream);
+
+    uint64_t next();
+
+    // Uniform in [0, 1), 53 random bits.
+    double uniform();
+
+    // Standard normal (Box-Muller, one value per call).
+    double normal();
+};
+
+enum class DistributionType { Fixed, Uniform, Normal, LogNormal };
+
+// A toleranced parameter.
+//   Fixed:     a
+//   Uniform:   [a, b]
+//   Normal:    mean a, standard deviation b
+//   LogNormal: median a, log-space standard deviation b
+struct Distribution{
+    DistributionType type = DistributionType::Fixed;
+    double a = 0;
+    double b = 0;
+
+    double sample(RandomStream& rng) const;
+};
+
+// Parses "<value>" | "uniform:min:max" | "normal:mean:sd" | "lognormal:median:sigma"
+// | "tol:nominal:percent" (uniform within +-percent).
+bool parse_distribution(const std::string& spec, Distribution& d);
+
+/**
+ * @class RunningStats
+ * @brief Streaming summary of one metric: count, mean, variance (Welford),
+ * min, max and a log-bucket histogram (1% wide buckets) for percentiles.
+ * Accumulators of separate blocks are merged, so nothing per sample is kept.
+ */
+class RunningStats{
+private:
+    std::map<int, uint64_t> buckets; // Bucket i holds values in [1.01^i, 1.01^(i+1))
+    uint64_t zeros = 0;              // Values <= 0
+
+public:
+    uint64_t count = 0;
+    double mean = 0;
+    double m2 = 0;  // Sum of squared deviations from the mean
+    double min = 0;
+    double max = 0;
+
+    void add(double value);
+
+    // Adds another accumulator (Chan's pairwise update). Merging the same
+    // accumulators in the same order always gives the same bits.
+    void merge(const RunningStats& other);
+
+    double stddev() const;
+
+    // p in [0, 100]. Accurate to the 1% bucket width (min/max are exact).
+    double percentile(double p) const;
+};
+
+// Parameter distributions and run settings.
+struct MonteCarloSpec{
+    Distribution m, c, k, xo, vo;
+    size_t samples = 10000;
+    uint64_t seed = 1;
+    Solver solver = Solver::RK4;
+};
+
+// Metric distributions over the accepted samples.
+struct MonteCarloResult{
+    size_t accepted = 0;
+    size_t rejected = 0;       // Samples that failed validate_parameters
+    RunningStats settling_time; // [s], last time |x| was above 2% of the peak
+    RunningStats overshoot;     // [%], largest excursion past equilibrium over the initial (or first) extreme
+    RunningStats peak;          // [m], largest |x|
+};
+
+// --- Monte Carlo Prototypes ---
+
+// Draws spec.samples systems, skips the ones validate_parameters rejects and
+// simulates the rest on a work-stealing pool (0 threads = one per hardware
+// thread). The result is bit-identical for any thread count.
+MonteCarloResult run_monte_carlo(const MonteCarloSpec& spec, unsigned threads = 0);
@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+// Index used in a Spring to tie a mass to the fixed frame.
+const int GROUND = -1;
+
+// Networks with at least this many masses evaluate their forces on a thread pool.
+const size_t NETWORK_PARALLEL_MIN = 16384;
+
+// A spring and a damper in parallel between masses i and j (j = GROUND for the frame).
+struct Spring{
+    int i;
+    int j;
+    double k; // [N/m]
+    double c; // [N.s/m]
+};
+
+/**
+ * @class SpringNetwork
+ * @brief N masses, one DOF each, coupled by springs and dampers.
+ * Stiffness and damping share one CSR sparsity pattern (two value arrays),
+ * so a force evaluation costs O(N + springs) whatever the topology. The state
+ * is kept in contiguous x / v arrays.
+ * A single MassSpringDamper is the 1-DOF case: one mass, one spring to ground.
+ */
+class SpringNetwork{
+private:
+    std::vector<double> inv_m;      // 1/m per mass
+    std::vector<size_t> row_start;  // Row i of K and C spans [row_start[i], row_start[i+1])
+    std::vector<int> col;           // Column of every stored entry
+    std::vector<double> kval, cval; // K and C entries (same pattern)
+    size_t n_springs = 0;
+    double w_max = 0;
+
+public:
+    std::vector<double> x, v; // Current state [m], [m/s]
+
+    // Assembles K and C from the spring list and sets x = v = 0.
+    // Returns false (and prints why) if a mass or a spring is invalid.
+    bool build(const std::vector<double>& masses, const std::vector<Spring>& springs);
+
+    size_t size() const { return inv_m.size(); }
+    size_t spring_count() const { return n_springs; }
+    size_t nonzeros() const { return col.size(); }
+
+    // Upper bound of the highest natural frequency (Gershgorin on M^-1 K) [rad/s].
+    double max_frequency() const { return w_max; }
+
+    // Fixed step of the 1-DOF solvers, with wn taken as max_frequency().
+    double stable_dt() const;
+
+    // a = M^-1 (-K x - C v) for rows [begin, end). Reads x and v of every neighbour.
+    void acceleration(const double* x_, const double* v_, double* a, size_t begin, size_t end) const;
+
+    // Kinetic + potential energy of the current state [J].
+    double energy() const;
+};
+
+/**
+ * @class NetworkSink
+ * @brief Receives the state of a network run, once per stored step.
+ */
+class NetworkSink{
+public:
+    virtual ~NetworkSink() {}
+    virtual void write(double t, const double* x, const double* v, size_t n) = 0;
+    virtual void close() {}
+};
+
+/**
+ * @class NetworkCsvWriter
+ * @brief Writes the time and the positions of a few probe masses,
+ * every N-th step, as "time(s),x<i>(m),..." rows.
+ */
+class NetworkCsvWriter : public NetworkSink{
+private:
+    std::string filename;
+    std::ofstream file;
+    std::vector<int> probes;
+    int every;
+    long calls = 0;
+    bool written = false;
+
+public:
+    NetworkCsvWriter(const std::string& filename, const std::vector<int>& probes, int every = 1);
+    ~NetworkCsvWriter();
+
+    bool is_open() const { return file.is_open(); }
+    // True once close() has stored the whole file (false if it never opened or a write failed).
+    bool ok() const { return written; }
+
+    void write(double t, const double* x, const double* v, size_t n) override;
+    void close() override;
+};
+
+// --- Network Prototypes ---
+
+// n equal masses in a line, neighbours joined by (k, c). fixed_ends ties both
+// end masses to the frame with the same spring.
+bool build_chain(SpringNetwork& net, size_t n, double m, double k, double c, bool fixed_ends);
+
+// rows x cols masses, each joined to its right and lower neighbour; the
+// border masses are tied to the frame.
+bool build_mesh(SpringNetwork& net, size_t rows, size_t cols, double m, double k, double c);
+
+// Reads a network from a text file with one item per line ('#' starts a comment):
+//   mass <m> [x0] [v0]
+//   spring <i> <j|ground> <k> <c>
+// Masses are numbered from 0 in file order. A field that is not a number
+// (or an index), a missing or extra field: prints an error and returns false.
+bool read_network(const std::string& filename, SpringNetwork& net);
+
+// Integrates the network from its current state until t_end (Euler or RK4,
+// fixed step stable_dt()). The state is left at t_end. 'out' gets t = 0 and
+// every step after it. 0 threads = one per hardware thread; networks smaller
+// than NETWORK_PARALLEL_MIN always run on the calling thread.
+// Returns false for solvers without a network version (RK45, Verlet).
+bool simulate_network(SpringNetwork& net, Solver solver, double t_end, NetworkSink* out = nullptr, unsigned threads = 0);
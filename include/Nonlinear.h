@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <limits>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+class TrajectorySink;
+struct OutputPolicy;
+struct Forcing;
+
+/**
+ * @struct NonlinearForces
+ * @brief Forces added to the linear spring and damper of a MassSpringDamper:
+ *   Duffing spring:   -k3*x^3 on top of -k*x (cubic stiffening)
+ *   Coulomb friction: -friction*sign(v) while sliding. A mass that comes to
+ *                     rest sticks until the other forces exceed static_friction.
+ *   Hard stops:       walls at x_min and x_max. An impact reverses v, scaled by
+ *                     the coefficient of restitution; a mass whose bounces
+ *                     die out rests against the wall until pulled away.
+ */
+struct NonlinearForces{
+    double k3 = 0;                // [N/m^3], >= 0
+    double friction = 0;          // Kinetic friction force mu*N [N]
+    double static_friction = -1;  // Break-away force [N], < 0 = same as friction
+    double x_min = -std::numeric_limits<double>::infinity(); // [m]
+    double x_max = std::numeric_limits<double>::infinity();  // [m]
+    double restitution = 0.5;     // 0 = plastic, 1 = elastic
+
+    bool has_stops() const { return x_min > -std::numeric_limits<double>::infinity() || x_max < std::numeric_limits<double>::infinity(); }
+    double break_away() const { return (static_friction < 0) ? friction : static_friction; }
+};
+
+// Events located during a nonlinear run.
+struct EventStats{
+    int impacts = 0;    // Bounces off a stop
+    int sticks = 0;     // v reached 0 and friction held the mass
+    int slips = 0;      // A held mass broke away
+    int reversals = 0;  // v reached 0 and the mass slid back the other way
+    int contacts = 0;   // Bounces died out against a stop
+    int resteps = 0;    // Trial steps taken by the root finder, over all events
+};
+
+// --- Nonlinear Prototypes ---
+
+// Checks k3, friction, restitution and that x0 lies between the stops.
+// Prints every problem and returns false if there is one.
+bool validate_nonlinear(const MassSpringDamper& s, const NonlinearForces& forces);
+
+// Fixed step of a nonlinear run: default_dt() with wn raised by the cubic
+// spring's stiffness at the initial amplitude.
+double nonlinear_dt(const MassSpringDamper& s, const NonlinearForces& forces);
+
+// Integrates the system with the nonlinear forces (and F(t) of 'force', none
+// if null) from (xo, vo) until t_end, writing one sample per fixed step.
+// Friction direction changes, stick/slip and impacts are events: the step is
+// cut where they happen (found by root finding on the step size), so the
+// state lands exactly on the discontinuity and the fixed dt stays usable.
+// Steps and impulses of 'force' are landed on the same way. An unforced run
+// ends early once the mass is held for good (StopReason::Settled).
+// Euler, RK4 and Verlet are supported; RK45 and Exact (linear only) run as RK4. dt <= 0 = nonlinear_dt().
+StepStats simulate_nonlinear(const MassSpringDamper& s, const NonlinearForces& forces, Solver solver, const Forcing* force,
+                             double t_end, TrajectorySink& out, EventStats* events = nullptr, double dt = 0);
+
+// simulate_nonlinear() streamed to a .msdt file through an output policy.
+StepStats simulate_nonlinear_to_file(const MassSpringDamper& s, const NonlinearForces& forces, Solver solver, const Forcing* force,
+                                     double t_end, const std::string& filename, const OutputPolicy& policy, EventStats* events = nullptr,
+                                     double dt = 0);
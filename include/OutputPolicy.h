@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include "Trajectory.h"
+
+// Which samples of a run reach the output file.
+enum class OutputMode{
+    EveryStep,     // Every integration step (default)
+    EveryNth,      // Every N-th step
+    FixedInterval, // Uniform output times, interpolated between steps
+    Events         // Only peaks, zero crossings and settling
+};
+
+// Event kinds for OutputMode::Events (bit flags).
+const unsigned EVENT_PEAK = 1;          // Extremum of x (v = 0)
+const unsigned EVENT_ZERO_CROSSING = 2; // x = 0
+const unsigned EVENT_SETTLED = 4;       // Amplitude first drops below 2% of its maximum
+
+struct OutputPolicy{
+    OutputMode mode = OutputMode::EveryStep;
+    int every = 1;        // EveryNth
+    double interval = 0;  // FixedInterval [s]
+    unsigned events = EVENT_PEAK | EVENT_ZERO_CROSSING | EVENT_SETTLED;
+};
+
+/**
+ * @class DecimatingSink
+ * @brief Applies an OutputPolicy between a solver and another sink.
+ * The solver keeps stepping at full resolution; only the selected samples
+ * are forwarded. Off-step samples (intervals and events) use cubic Hermite
+ * interpolation of the two surrounding steps, which is accurate to O(dt^4).
+ * The first and the last sample of a run are always forwarded.
+ */
+class DecimatingSink : public TrajectorySink{
+private:
+    TrajectorySink& out;
+    OutputPolicy policy;
+
+    double wn = 1;       // From begin()
+    bool have_prev = false;
+    bool prev_written = false;
+    double pt = 0, px = 0, pv = 0, pa = 0; // Previous step
+    size_t step = 0;
+    size_t forwarded = 0;
+    double next_t = 0;   // Next output time (FixedInterval)
+    double amp_max = 0;  // Largest amplitude so far (settling event)
+    bool settled = false;
+
+    void emit(double t, double x, double v, double a);
+    // Interpolates at theta in [0, 1] between the previous and the current step.
+    void interpolate(double theta, double t, double x, double v, double a, double& xi, double& vi, double& ai) const;
+    // Root of x (want_v = false) or v (want_v = true) between the two steps.
+    double locate(bool want_v, double t, double x, double v, double a) const;
+    void write_events(double t, double x, double v, double a);
+
+public:
+    DecimatingSink(TrajectorySink& out, const OutputPolicy& policy);
+
+    void begin(const MassSpringDamper& s, Solver solver, double dt) override;
+    void write(double t, double x, double v, double a) override;
+    void close() override;
+
+    size_t steps_seen() const { return step; }
+    size_t samples_forwarded() const { return forwarded; }
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include "MassSpringDamper.h"
+
+struct Forcing;
+
+// Coarse propagator that predicts each time slice: the exact step of the
+// linear system (Analytic.h) or semi-implicit Euler, the force held over each coarse step.
+enum class CoarseMethod { Exact, Euler };
+
+// Settings of a Parareal run.
+struct PararealOptions{
+    CoarseMethod coarse = CoarseMethod::Exact;
+    int coarse_ratio = 0;         // Coarse step / fine step; 0 = one step per slice (exact), 10 (Euler)
+    int slices = 0;               // Time slices, 0 = one per thread
+    int max_iterations = 0;       // 0 = slices (the result is the serial one by then)
+    double tolerance = 1e-10;     // Largest boundary correction, relative to the largest state, that counts as converged
+    unsigned threads = 0;         // 0 = one per hardware thread
+    bool serial_reference = true; // Also time the serial RK4 run and compare against it
+};
+
+// Slice boundary states and the cost of a Parareal run.
+struct PararealResult{
+    std::vector<double> t, x, v;     // Boundary states, from t = 0 to t_end
+    std::vector<double> corrections; // Largest relative boundary change of each iteration
+    int iterations = 0;
+    bool converged = false;          // The corrections fell under the tolerance
+    bool serial_fallback = false;    // Not converged after one iteration per slice: the boundaries are the serial run's
+    long long steps = 0;             // Fine steps over [0, t_end]
+    long long fine_steps = 0;        // Fine steps taken over all iterations
+    double seconds = 0;              // Wall-clock time, without starting the pool
+
+    // Serial reference (serial_reference only)
+    double serial_seconds = 0;
+    double speedup = 0;
+    double max_deviation = 0;        // Largest |x - x_serial| at the boundaries [m]
+};
+
+// --- Parareal Prototypes ---
+
+// Parallel-in-time integration of one long run over [0, t_end], without the
+// stop logic. The span is cut into time slices; the coarse propagator
+// predicts every slice boundary serially, then all slices are integrated
+// with RK4 at default_dt() concurrently on a work-stealing pool, and the
+// coarse predictions are corrected with them (U[j+1] = G(U[j]) + F(U[j]) - G_old(U[j])).
+// This repeats until the boundaries stop moving. Slices the correction has
+// already swept past are exact and are not integrated again.
+// The fine steps are those of rk4() (the same step map, the same step times
+// for a force), so the converged result matches the serial run to rounding.
+// Impulses of 'force' (null = none) are ignored.
+PararealResult parareal(const MassSpringDamper& s, const Forcing* force, double t_end,
+                        const PararealOptions& opt = PararealOptions());
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+#include "Analytic.h" // For ExactStepMap
+
+struct Forcing;
+
+// Log-linear buckets: values below 16 ns are exact, above that every power of
+// two is split in 16 buckets (at most 6.25% wide), up to 2^64 ns.
+const int LATENCY_SUB_BUCKETS = 16;
+const int LATENCY_BUCKETS = 16 + 60*LATENCY_SUB_BUCKETS;
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-size histogram of durations in ns. Recording is a handful of
+ * integer operations on an in-object array: no allocation, no lock.
+ */
+class LatencyHistogram{
+private:
+    uint64_t buckets[LATENCY_BUCKETS];
+    uint64_t n;
+    uint64_t min_ns, max_ns;
+    double sum_ns;
+
+public:
+    LatencyHistogram();
+
+    void add(uint64_t ns);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    uint64_t count() const { return n; }
+    uint64_t min() const { return n ? min_ns : 0; }
+    uint64_t max() const { return max_ns; }
+    double mean() const { return n ? sum_ns / n : 0; }
+
+    // Upper edge of the bucket that holds the p-th percentile (0..100), at most max().
+    uint64_t percentile(double p) const;
+
+    // Raw buckets, for export: count of bucket i and the largest value it holds.
+    uint64_t bucket(int i) const { return buckets[i]; }
+    static uint64_t bucket_upper(int i);
+};
+
+/**
+ * @class RealTimeStepper
+ * @brief Stateful, step-by-step integration of one system for control and
+ * hardware-in-the-loop use. Everything is set up in the constructor: step()
+ * never allocates, locks, throws or does I/O, and costs the same every call.
+ * The force is held constant over each step (zero-order hold of the input).
+ * RK45 has no fixed-step form and is run as RK4. Exact keeps the transition
+ * matrix of the last dt and only recomputes it (in place) when dt changes.
+ *
+ * With timing on, each step() also records its own duration (latency) and
+ * how far the time since the previous call strays from dt (jitter), which is
+ * meaningful when step() is called once per dt of wall-clock time. Timestamps
+ * come from the TSC (rdtsc) on x86-64, steady_clock elsewhere.
+ */
+class RealTimeStepper{
+private:
+    Solver solver;
+    double cm, km, inv_m;
+    double x, v, t;
+    double force;    // Last force applied [N]
+    uint64_t n;
+
+    ExactStepMap exact; // Solver::Exact: map of step map_dt
+    double map_dt;
+
+    bool timing;
+    double ns_per_tick;
+    uint64_t last_ns;    // Latency of the last step
+    uint64_t last_start; // Start of the last step [ticks]
+    LatencyHistogram latency_ns, jitter_ns;
+
+public:
+    explicit RealTimeStepper(const MassSpringDamper& s, Solver solver = Solver::RK4, bool timing = true);
+
+    // Advances the state by dt [s] under 'force' [N]. Returns the new position [m].
+    double step(double dt, double force);
+
+    // Restarts from (x0, v0) at t = 0. Statistics are kept.
+    void reset(double x0, double v0);
+    void reset_statistics();
+
+    double position() const { return x; }
+    double velocity() const { return v; }
+    double acceleration() const { return -cm*v - km*x + inv_m*force; }
+    double time() const { return t; }
+    uint64_t steps() const { return n; }
+    uint64_t last_latency_ns() const { return last_ns; }
+
+    const LatencyHistogram& latency() const { return latency_ns; }
+    const LatencyHistogram& jitter() const { return jitter_ns; }
+};
+
+// Settings of a soak test: the stepper driven at a fixed rate for a long time.
+struct SoakOptions{
+    double rate = 10000;       // Steps per second of wall-clock time; 0 = back to back (dt stays 1e-4 s)
+    double duration = 10;      // [s] of wall-clock time
+    double report_every = 10;  // [s] between progress lines, 0 = none
+    double budget_us = 0;      // Step time budget [us]; 0 = one period (1/rate)
+};
+
+// Totals of a soak test (the histograms stay in the stepper).
+struct SoakResult{
+    uint64_t steps;
+    uint64_t overruns;   // Steps whose latency exceeded the budget
+    uint64_t late;       // Periods skipped because a step started after the following one was due
+    double seconds;      // Wall-clock time of the run
+    double period_ns;    // 0 = back to back
+    double budget_ns;    // 0 = no budget
+};
+
+// --- Real-Time Prototypes ---
+
+// Runs 'stepper' at opts.rate for opts.duration, spinning (not sleeping)
+// between periods, with F(t) of 'force' (none if null) held over each step.
+// Prints a progress line every opts.report_every seconds.
+SoakResult soak_test(RealTimeStepper& stepper, const SoakOptions& opts, const Forcing* force = nullptr);
+
+// One-line summary of a histogram: "p50 85 ns, p99 140 ns, max 2.1 us".
+std::string latency_summary(const LatencyHistogram& h);
+
+// Prints the soak report (latency, jitter and overruns).
+void print_soak_report(const RealTimeStepper& stepper, const SoakResult& result);
@@ -0,0 +1,142 @@
+#pragma once
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+class TrajectoryFile;
+
+// Bump when an integrator changes its output, so older cache files stop matching.
+const uint32_t CACHE_VERSION = 3;
+
+/**
+ * @struct CacheKey
+ * @brief Canonical description of one free-response run. Runs with equal keys
+ * produce the same samples, so they can share one stored result.
+ */
+struct CacheKey{
+    double m, c, k, xo, vo;
+    double dt;          // Fixed step [s] (first step for RK45)
+    double atol, rtol;  // RK45 tolerances, 0 for the fixed-step solvers
+    uint32_t solver;    // Solver enum value
+    uint32_t version;   // CACHE_VERSION
+};
+static_assert(sizeof(CacheKey) == 72, "CacheKey must have no padding: it is hashed and compared as bytes");
+
+// Hit/miss counters and current size of both tiers.
+struct CacheStats{
+    uint64_t memory_hits = 0;
+    uint64_t disk_hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0;   // Memory and disk
+    size_t memory_entries = 0;
+    size_t disk_entries = 0;
+    uint64_t disk_bytes = 0;
+};
+
+// --- Result Cache Prototypes ---
+
+// Key of a run with the default tolerances and step dt, dt <= 0 = default_dt()
+// (-0.0 is stored as 0.0).
+CacheKey make_cache_key(const MassSpringDamper& s, Solver solver, double dt = 0);
+
+// 64-bit FNV-1a hash of the key bytes; its 16 hex digits name the cache files.
+uint64_t cache_hash(const CacheKey& key);
+
+/**
+ * @class ResultCache
+ * @brief Content-addressed LRU cache of run results, keyed by CacheKey.
+ *   Memory tier: the SimSummary of recent runs, limited in entries.
+ *   Disk tier (optional directory), limited in bytes:
+ *     summaries.msds  append-only log of summary records
+ *     <hash>.msdt     one trajectory file per run, read back through
+ *                     TrajectoryFile (memory-mapped, never re-parsed)
+ * Least recently used entries are evicted first. Evicted summaries stay in
+ * the log as garbage until it is compacted (rewritten with the live records
+ * only) once garbage outweighs them. Use times go to the trajectory files'
+ * modification times and, at compaction, to the summary records, so the LRU
+ * order survives between processes. Every method is thread-safe.
+ */
+class ResultCache{
+private:
+    struct MemoryEntry{
+        CacheKey key;
+        SimSummary summary;
+    };
+    struct DiskEntry{
+        uint64_t hash;
+        bool trajectory;  // <hash>.msdt, else a record of the summary log
+        uint64_t bytes;
+        uint64_t offset;  // Summary: position of its record in the log
+        int64_t used;     // Last use, in file clock ticks
+    };
+    typedef std::list<DiskEntry>::iterator DiskIterator;
+
+    std::string directory;    // Empty = memory only
+    size_t memory_limit;
+    uint64_t disk_limit;
+
+    // Front = most recently used
+    std::list<MemoryEntry> memory;
+    std::unordered_map<uint64_t, std::list<MemoryEntry>::iterator> memory_index;
+    std::list<DiskEntry> disk;
+    std::unordered_map<uint64_t, DiskIterator> disk_summaries, disk_trajectories;
+
+    std::fstream log;         // summaries.msds
+    uint64_t log_end = 0;     // Bytes in the log
+    uint64_t garbage = 0;     // Bytes of evicted or replaced records in it
+
+    CacheStats counters;
+    mutable std::mutex lock;
+
+    // All of these run under 'lock'.
+    std::string path(const std::string& name) const;
+    void remember(const CacheKey& key, const SimSummary& summary);
+    void load_log();
+    void compact_log();
+    DiskIterator add_disk(const DiskEntry& entry);
+    void forget(DiskIterator it);    // Drops the entry, keeps its data
+    void drop_disk(DiskIterator it); // Drops the entry and deletes / garbages its data
+    void use(DiskIterator it);
+    void evict(DiskIterator keep);
+
+public:
+    // Scans 'directory' (created if missing) for the results of earlier runs.
+    // An empty directory name keeps the cache in memory only.
+    explicit ResultCache(const std::string& directory = "", size_t memory_entries = 65536,
+                         uint64_t disk_bytes = uint64_t(1) << 30);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    bool has_directory() const { return !directory.empty(); }
+
+    // Summary lookup (memory, then disk) and store (both tiers).
+    bool find_summary(const CacheKey& key, SimSummary& out);
+    void store_summary(const CacheKey& key, const SimSummary& summary);
+
+    // simulate_summary() through the cache.
+    SimSummary summary(const MassSpringDamper& s, Solver solver);
+
+    // Path of the stored trajectory of 'key', if there is one (disk tier only).
+    bool find_trajectory(const CacheKey& key, std::string& filename);
+
+    // Copies a finished .msdt file of the run 'key' into the cache.
+    bool store_trajectory(const CacheKey& key, const std::string& filename);
+
+    // Maps the trajectory of the run into 'view', integrating and storing it
+    // first on a miss. Needs a directory; returns false without one.
+    bool trajectory(const MassSpringDamper& s, Solver solver, TrajectoryFile& view);
+
+    CacheStats stats() const;
+
+    // Drops every entry of both tiers (and their files). Counters are kept.
+    void clear();
+};
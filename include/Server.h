@@ -0,0 +1,182 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+#include "OutputPolicy.h"
+
+class ThreadPool;
+
+// --- Wire format ---
+// Fixed-size frames in host byte order (the socket never leaves the machine).
+// A client sends ServerRequest frames and may pipeline them; every reply
+// frame carries the id of its request, and replies can come out of order.
+//   Summary    -> one Summary frame
+//   Trajectory -> Samples frames (count records of t, x, v, a follow each), then one End frame
+//   Stats      -> one Stats frame
+// A request that fails validation gets one Error frame instead.
+
+enum class RequestType : uint32_t { Summary, Trajectory, Stats };
+enum class ReplyKind : uint32_t { Summary, Samples, End, Stats, Error };
+enum class ReplyStatus : uint32_t { Ok, InvalidParameters, BadRequest };
+
+struct ServerRequest{
+    char magic[4];      // "MSDQ"
+    uint32_t type;      // RequestType
+    uint64_t id;        // Echoed in the replies
+    double m, c, k, xo, vo;
+    double dt;          // Trajectory step [s], 0 = default_dt(); summaries always use the default
+    double interval;    // OutputMode::FixedInterval [s]
+    uint32_t solver;    // Solver enum value
+    uint32_t output;    // OutputMode enum value (trajectories)
+    uint32_t every;     // OutputMode::EveryNth
+    uint32_t reserved;
+};
+static_assert(sizeof(ServerRequest) == 88, "ServerRequest is sent as raw bytes: no padding");
+
+// values[] by kind:
+//   Summary: peak, settling_time, final_amplitude, steps
+//   End:     accepted steps, rejected steps, StopReason, samples sent
+//   Stats:   the ServerStats fields, in order
+struct ServerReply{
+    char magic[4];      // "MSDR"
+    uint32_t status;    // ReplyStatus
+    uint64_t id;
+    uint32_t kind;      // ReplyKind
+    uint32_t count;     // Samples: records that follow
+    double values[8];
+};
+static_assert(sizeof(ServerReply) == 88, "ServerReply is sent as raw bytes: no padding");
+
+// Counters of a running server.
+struct ServerStats{
+    double requests = 0;      // Received, including Stats and rejected ones
+    double completed = 0;     // Summary and trajectory requests answered
+    double queued = 0;        // Waiting for the dispatcher (queue depth)
+    double in_flight = 0;     // Handed to the pool, not answered yet
+    double batches = 0;       // Summary batches run
+    double batched = 0;       // Summary requests run in those batches
+    double samples = 0;       // Trajectory samples streamed
+    double seconds = 0;       // Since start()
+};
+
+// Settings of a server.
+struct ServerOptions{
+    std::string socket_path = "msd.sock";
+    unsigned threads = 0;          // 0 = one per hardware thread
+    size_t batch_max = 4096;       // Summary requests per batch at most
+    double batch_window_us = 200;  // How long a batch waits for more requests once the first is in
+    size_t max_pending = 1024;     // Requests queued or running per connection; its reader waits above that
+    double send_timeout_s = 5;     // A client that takes no reply for this long is dropped
+};
+
+// Request of one run with the given settings (RequestType::Stats ignores them).
+ServerRequest make_request(RequestType type, uint64_t id, const MassSpringDamper& s, Solver solver,
+                           const OutputPolicy& policy = OutputPolicy(), double dt = 0);
+
+/**
+ * @class SimulationServer
+ * @brief Long-running simulation service on a Unix domain socket.
+ * Each connection has a reader thread that validates requests and queues
+ * them. A dispatcher drains the queue in batches: it waits up to
+ * batch_window_us after the first request so concurrent clients coalesce,
+ * then runs the summary requests together in chunks of the SIMD kernel
+ * (simulate_summaries()) and every trajectory as its own task, all on one
+ * work-stealing pool. Trajectories go through the output policy and stream
+ * back in Samples frames as they are integrated; nothing touches the disk.
+ * A client that stops reading holds at most max_pending requests and is
+ * dropped after send_timeout_s, so it can't stall the pool for the others.
+ * POSIX only: start() fails elsewhere.
+ */
+class SimulationServer{
+private:
+    struct Connection;
+    struct Pending{
+        std::shared_ptr<Connection> conn;
+        ServerRequest request;
+    };
+    struct Reader{
+        std::thread thread;
+        std::shared_ptr<Connection> conn;
+    };
+
+    ServerOptions options;
+    int listen_fd = -1;
+    std::unique_ptr<ThreadPool> pool;
+    std::thread acceptor, dispatcher;
+    std::list<Reader> readers;
+    std::mutex readers_lock;
+
+    std::deque<Pending> queue;
+    std::mutex queue_lock;
+    std::condition_variable queue_ready;
+    bool stopping = false;
+
+    std::chrono::steady_clock::time_point started;
+    std::atomic<uint64_t> n_requests{0}, n_completed{0}, n_in_flight{0}, n_batches{0}, n_batched{0}, n_samples{0};
+
+    void accept_loop();
+    void read_loop(std::shared_ptr<Connection> conn);
+    void dispatch_loop();
+    void run_summaries(std::vector<Pending> batch);
+    void run_trajectory(const Pending& p);
+
+public:
+    explicit SimulationServer(const ServerOptions& options = ServerOptions());
+    ~SimulationServer();
+
+    SimulationServer(const SimulationServer&) = delete;
+    SimulationServer& operator=(const SimulationServer&) = delete;
+
+    // Binds the socket (replacing a stale socket file) and starts the threads.
+    // Prints an error and returns false on failure.
+    bool start();
+
+    // Stops accepting, closes every connection, finishes the queued work and
+    // removes the socket file. Called by the destructor.
+    void stop();
+
+    ServerStats stats();
+};
+
+/**
+ * @class ServerClient
+ * @brief Blocking client of a SimulationServer, for scripts, tests and benchmarks.
+ * send() and receive() can pipeline many requests on one connection; the
+ * helpers below send one request and wait for its replies.
+ */
+class ServerClient{
+private:
+    int fd = -1;
+
+public:
+    ServerClient() {}
+    ~ServerClient();
+
+    ServerClient(const ServerClient&) = delete;
+    ServerClient& operator=(const ServerClient&) = delete;
+
+    // Prints an error and returns false if the server can't be reached.
+    bool connect(const std::string& socket_path);
+    void close();
+
+    bool send(const ServerRequest& request);
+    // Reads one reply frame; Samples records are appended to 'samples' (t, x, v, a each).
+    bool receive(ServerReply& reply, std::vector<double>* samples = nullptr);
+
+    // False on a connection error or an Error reply (its status goes to 'status').
+    bool summary(const MassSpringDamper& s, Solver solver, SimSummary& out, ReplyStatus* status = nullptr);
+    bool trajectory(const MassSpringDamper& s, Solver solver, const OutputPolicy& policy, double dt,
+                    TrajectorySink& out, StepStats* stats = nullptr, ReplyStatus* status = nullptr);
+    bool stats(ServerStats& out);
+};
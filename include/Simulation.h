@@ -1,10 +1,109 @@
 #pragma once
 #include "MassSpringDamper.h" 
+#include <string>
+
+class TrajectorySink;
+struct OutputPolicy;
+struct Forcing;
+
+// Available time-stepping methods (values are stored in .msdt headers: append only).
+// Verlet is velocity Verlet: one model call per step, symplectic for the spring force.
+// Exact steps with the exact transition matrix of the linear system (Analytic.h):
+// no error and no stability limit at any dt; a force is held over each step.
+enum class Solver { Euler, RK4, RK45, Verlet, Exact };
+
+// Per-system result of a headless run (no trajectory is kept).
+struct SimSummary{
+    double peak;            // Largest |x| seen, including x0 [m]
+    double settling_time;   // Last time |x| was above 2% of the peak [s]
+    double final_amplitude; // sqrt(x^2 + (v/wn)^2) at the last step [m]
+    int steps;              // Integration steps taken before the stop condition
+};
+
+// Why a run ended.
+//   Settled:     two consecutive peaks under 2% of the first one (zeta <= 1)
+//   TwoPeriods:  overdamped, 2 natural periods elapsed
+//   EndTime:     the requested t_end was reached (stop logic off)
+//   PeriodLimit: 100 natural periods without settling
+enum class StopReason { Settled, TwoPeriods, EndTime, PeriodLimit };
+
+// Step bookkeeping of a run (rejected steps only happen with the adaptive solver).
+struct StepStats{
+    int accepted;    // Steps kept (one sample each)
+    int rejected;    // Steps retried with a smaller h because the error was too big
+    StopReason stop;
+    bool written = true; // False when a *_to_file run could not store its file
+};
+
+// One fixed step of a solver on the free response, as a linear map:
+// x' = xx*x + xv*v, v' = vx*x + vv*v, and the sampled acceleration a = ax*x + av*v.
+struct StepMap{
+    double xx, xv, vx, vv;
+    double ax, av;
+};
+
+// Default error tolerances of the adaptive solver.
+const double RK45_ATOL = 1e-8; // [m] and [m/s]
+const double RK45_RTOL = 1e-6;
 
 // --- Numerical Solver Prototypes ---
+// The single-argument versions stream to "results.msdt" and print the global
+// error; the others write every sample to 'out' as they step and close it at the end.
 
 // Semi-Implicit Euler solver.
 void euler(const MassSpringDamper& s);
+void euler(const MassSpringDamper& s, TrajectorySink& out);
 
 // 4th Order Runge-Kutta solver.
-void rk4(const MassSpringDamper& s);
\ No newline at end of file
+void rk4(const MassSpringDamper& s);
+void rk4(const MassSpringDamper& s, TrajectorySink& out);
+
+// Adaptive Dormand-Prince RK5(4) solver.
+// The step grows or shrinks so the local error stays under atol + rtol*|y|.
+StepStats rk45(const MassSpringDamper& s, double atol = RK45_ATOL, double rtol = RK45_RTOL);
+StepStats rk45(const MassSpringDamper& s, TrajectorySink& out, double atol = RK45_ATOL, double rtol = RK45_RTOL);
+
+// Fixed step of the Euler/RK4/Verlet/Exact solvers (and first step of RK45): 1/10 of 1/wn, at most 0.01 s.
+double default_dt(const MassSpringDamper& s);
+
+// Most steps a fixed-step run can take (the step counter is an int).
+// Longer runs are cut off there: check fixed_step_count() before a run.
+const double MAX_FIXED_STEPS = 2147483646;
+
+// Steps a fixed-step run with step dt takes at most: round(t_end/dt) for
+// t_end > 0, the 100-period cap of the stop logic otherwise.
+double fixed_step_count(const MassSpringDamper& s, double dt, double t_end = 0);
+
+// Step map of a fixed-step solver (Euler, RK4, Verlet) with step dt; RK45 has
+// none and gets the map of RK4. Found by stepping the unit states once, so it
+// rounds like the solver itself; the free-response loops step with it.
+// Exact gets exact_step_map().
+StepMap free_step_map(const MassSpringDamper& s, Solver solver, double dt);
+
+// Any of the above, picked at run time (RK45 uses the default tolerances).
+// dt <= 0 = default_dt(); the adaptive solver ignores it.
+StepStats simulate(const MassSpringDamper& s, Solver solver, TrajectorySink& out, double dt = 0);
+
+// Same as simulate(), but with the stop logic switched off: integrates until t_end [s].
+// Fixed-step solvers take round(t_end/dt) steps.
+StepStats simulate_for(const MassSpringDamper& s, Solver solver, double t_end, TrajectorySink& out);
+
+// Forced response (Forcing.h) from (xo, vo) until t_end, stop logic off.
+// dt <= 0 keeps the usual fixed step; the adaptive solver ignores it.
+StepStats simulate_forced(const MassSpringDamper& s, Solver solver, const Forcing& force, double t_end, TrajectorySink& out, double dt = 0);
+
+// Streams a run to a .msdt file and prints the global error. The policy
+// (OutputPolicy.h) picks which steps are stored; the default stores all of them.
+// stats.written is false if the file could not be created or written.
+StepStats simulate_to_file(const MassSpringDamper& s, Solver solver, const std::string& filename);
+StepStats simulate_to_file(const MassSpringDamper& s, Solver solver, const std::string& filename, const OutputPolicy& policy,
+                           double dt = 0);
+
+// simulate_forced() streamed to a .msdt file through an output policy.
+StepStats simulate_forced_to_file(const MassSpringDamper& s, Solver solver, const Forcing& force, double t_end,
+                                  const std::string& filename, const OutputPolicy& policy, double dt = 0);
+
+// Runs the same integration and stop logic as simulate(), but only
+// keeps the summary metrics (RK45 uses the default tolerances). Allocates
+// nothing and writes no files, so it is safe to call from many threads at once.
+SimSummary simulate_summary(const MassSpringDamper& s, Solver solver);
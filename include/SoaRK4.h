@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+
+/**
+ * @struct BasicOscillatorSoA
+ * @brief Many independent systems packed as structure-of-arrays, so the RK4
+ * kernel can advance one system per SIMD lane.
+ * Every array has size() entries, padded up to a multiple of the SIMD width;
+ * padding lanes have limit = 0 and never run.
+ * Real is double (OscillatorSoA) or float (FloatOscillatorSoA): float lanes
+ * are twice as many per register and half the memory, for coarse screening.
+ */
+template<class Real>
+struct BasicOscillatorSoA{
+    std::vector<Real> x, v;        // State [m], [m/s]
+    std::vector<Real> xx, xv, vx, vv; // One RK4 step as a linear map of (x, v), see free_step_map()
+    std::vector<Real> dt;          // Same heuristic as rk4(): min(0.1/wn, 0.01)
+    std::vector<Real> wn;
+    std::vector<Real> limit;       // Last step index the lane may take
+    std::vector<Real> oscillating; // 1.0 if zeta <= 1 (peak-based stop), else 0.0
+
+    size_t count = 0; // Real systems (without padding)
+
+    size_t size() const { return x.size(); }
+};
+
+typedef BasicOscillatorSoA<double> OscillatorSoA;
+typedef BasicOscillatorSoA<float> FloatOscillatorSoA;
+
+// Longest run the float kernel can take: its step counter is a float,
+// exact up to 2^24. Longer runs have to go through the double kernel.
+const int SOA_FLOAT_MAX_STEPS = 1 << 24;
+
+// --- SoA RK4 Prototypes ---
+
+// Number of lanes advanced per instruction (8 = AVX-512, 4 = AVX2, 1 = scalar).
+int rk4_soa_width();
+int rk4_soa_float_width(); // Twice the above with a SIMD kernel
+
+// Name of the instruction set the kernel was compiled for.
+const char* rk4_soa_isa();
+
+// Step index at which the run of s stops at the latest (the lane's limit).
+double rk4_soa_step_limit(const MassSpringDamper& s);
+
+// Packs n systems into 'soa' (resizing and padding it).
+// The float form rounds the double step map; every system must have
+// rk4_soa_step_limit() <= SOA_FLOAT_MAX_STEPS.
+void load_soa(OscillatorSoA& soa, const MassSpringDamper* systems, size_t n);
+void load_soa(FloatOscillatorSoA& soa, const MassSpringDamper* systems, size_t n);
+
+// Integrates every lane with RK4 and the same stop logic as simulate_summary().
+// Settled lanes are masked off while the rest of their block keeps running.
+// Writes soa.count summaries to 'out' and leaves the final state in soa.x / soa.v.
+// Steps with the same map as the scalar path, so both give the same samples
+// (up to the last bit where the compiler fuses multiply-adds differently).
+// The float form rounds at every step: its error grows with the run length.
+void rk4_soa(OscillatorSoA& soa, SimSummary* out);
+void rk4_soa(FloatOscillatorSoA& soa, SimSummary* out);
@@ -0,0 +1,112 @@
+#pragma once
+
+// Time-stepping methods for the 2nd-order ODE x'' = a(t, x, v), shared by the
+// drive loops of Simulation.cpp and the real-time stepper. A model is any
+// functor a(t, x, v); everything here is inlined into the caller's loop.
+
+// --- Butcher tableaus ---
+// An explicit Runge-Kutta method is only its coefficients:
+//   c[S]     stage times, as fractions of the step
+//   a[S][S]  stage weights (lower triangle)
+//   b[S]     solution weights over the common denominator b_den
+// Zero weights are left out of the sums at compile time and the others are
+// added in the order written, so a new method needs no new stepping code.
+
+// Classic 4th order Runge-Kutta (Simpson's rule weights).
+struct ClassicRK4{
+    static const int stages = 4;
+    static constexpr double c[4] = {0, 1.0/2.0, 1.0/2.0, 1};
+    static constexpr double a[4][4] = {{0}, {1.0/2.0}, {0, 1.0/2.0}, {0, 0, 1}};
+    static constexpr double b[4] = {1, 2, 2, 1};
+    static constexpr double b_den = 6;
+};
+
+// Dormand-Prince RK5(4). FSAL: the last row of a[][] is the 5th order
+// solution, and the last stage (taken there) is the first of the next step.
+// e[] = 5th minus 4th order weights, the error estimate.
+struct DormandPrince{
+    static const int stages = 7;
+    static const int error_order = 4;
+    static constexpr double c[7] = {0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1, 1};
+    static constexpr double a[7][7] = {
+        {0},
+        {1.0/5.0},
+        {3.0/40.0,       9.0/40.0},
+        {44.0/45.0,      -56.0/15.0,      32.0/9.0},
+        {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0},
+        {9017.0/3168.0,  -355.0/33.0,     46732.0/5247.0, 49.0/176.0,   -5103.0/18656.0},
+        {35.0/384.0,     0,               500.0/1113.0,   125.0/192.0,  -2187.0/6784.0,  11.0/84.0}};
+    static constexpr double e[7] = {71.0/57600.0, 0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0};
+};
+
+// Rows of a tableau as compile-time weights w(j).
+template<class T, int I> struct StageRow{ static constexpr double w(int j){ return T::a[I][j]; } };
+template<class T> struct SolutionRow{ static constexpr double w(int j){ return T::b[j]; } };
+template<class T> struct ErrorRow{ static constexpr double w(int j){ return T::e[j]; } };
+
+// Sum of w(j)*k[j] for j < N, left to right, without the zero weights.
+template<class W, int N, int J = 0, bool Started = false>
+inline double combine(const double* k, double sum = 0){
+    if constexpr (J == N) return sum;
+    else if constexpr (W::w(J) == 0) return combine<W, N, J + 1, Started>(k, sum);
+    else if constexpr (!Started) return combine<W, N, J + 1, true>(k, W::w(J)*k[J]);
+    else return combine<W, N, J + 1, true>(k, sum + W::w(J)*k[J]);
+}
+
+// Stages I..N-1 of tableau T from (x, v) at t, given the slopes of the earlier ones.
+template<class T, int I, int N, class Model>
+inline void rk_stages(double x, double v, double t, double h, double* kx, double* kv, const Model& accel){
+    if constexpr (I < N){
+        double xs = x + h*combine<StageRow<T, I>, I>(kx);
+        double vs = v + h*combine<StageRow<T, I>, I>(kv);
+        kx[I] = vs;
+        kv[I] = accel(t + T::c[I]*h, xs, vs);
+        rk_stages<T, I + 1, N>(x, v, t, h, kx, kv, accel);
+    }
+}
+
+// --- Fixed-step methods ---
+// step() advances (x, v) from t to t + h, given a = the acceleration at
+// (t, x, v), and returns the acceleration that goes into the output for this step.
+
+// Semi-Implicit Euler (a -> v -> x).
+// More stable for oscillators than explicit Euler.
+struct SemiImplicitEuler{
+    template<class Model>
+    static double step(double& x, double& v, double t, double h, double a, const Model& accel){
+        (void)t; (void)accel;
+        v = v + a*h; // new v uses a
+        x = x + v*h; // new x uses new v
+        return a;
+    }
+};
+
+// Velocity Verlet (half kick, drift, half kick): one model call per step,
+// symplectic and 2nd order for position forces. The damping term is taken
+// at the half-step velocity, which keeps the method explicit.
+struct VelocityVerlet{
+    template<class Model>
+    static double step(double& x, double& v, double t, double h, double a, const Model& accel){
+        double v_half = v + 0.5*h*a;
+        x = x + h*v_half;
+        double a_end = accel(t + h, x, v_half);
+        v = v_half + 0.5*h*a_end;
+        return a_end;
+    }
+};
+
+// Explicit Runge-Kutta method of tableau T for the 2nd-order ODE:
+// solves dx/dt = v AND dv/dt = a.
+template<class T>
+struct ExplicitRK{
+    template<class Model>
+    static double step(double& x, double& v, double t, double h, double a, const Model& accel){
+        double kx[T::stages], kv[T::stages];
+        kx[0] = v;
+        kv[0] = a;
+        rk_stages<T, 1, T::stages>(x, v, t, h, kx, kv, accel);
+        x = x + combine<SolutionRow<T>, T::stages>(kx) / T::b_den * h;
+        v = v + combine<SolutionRow<T>, T::stages>(kv) / T::b_den * h;
+        return accel(t + h, x, v);
+    }
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/**
+ * @class ThreadPool
+ * @brief Fixed-size work-stealing thread pool.
+ * Every worker owns a task deque: it pops its own work from the back and,
+ * when it runs dry, steals from the front of the other workers' deques.
+ */
+class ThreadPool{
+private:
+    struct Queue{
+        std::deque<std::function<void()>> tasks;
+        std::mutex lock;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // One per worker
+    std::vector<std::thread> workers;
+
+    std::mutex state_lock;
+    std::condition_variable wake; // Signalled when work is queued (or on shutdown)
+    std::condition_variable idle; // Signalled when the last pending task finishes
+
+    std::atomic<size_t> queued{0};  // Tasks sitting in some deque
+    std::atomic<size_t> pending{0}; // Tasks submitted but not finished yet
+    std::atomic<size_t> next_queue{0};
+    bool stopping = false;
+
+    bool pop_task(size_t id, std::function<void()>& task);
+    void worker_loop(size_t id);
+
+public:
+    // 0 threads = one per hardware thread.
+    explicit ThreadPool(unsigned n_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task. Tasks submitted from a worker go to that worker's own deque.
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished.
+    // Must not be called from inside a task.
+    void wait();
+
+    // Splits [0, n) into chunks of 'grain' indices, runs body(begin, end) on each
+    // chunk across the pool and waits for all of them.
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+    unsigned size() const { return unsigned(workers.size()); }
+};
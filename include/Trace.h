@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Simulation.h"
+
+// Tracing is compiled in with -DMSD_TRACE=ON (defines MSD_TRACE). Without it
+// every MSD_TRACE_* macro below expands to nothing: no clock reads, no
+// counters, no argument evaluation.
+#ifdef MSD_TRACE
+const bool TRACE_ENABLED = true;
+#else
+const bool TRACE_ENABLED = false;
+#endif
+
+// Totals kept per thread (plain integers, no atomics) and summed on demand.
+enum class TraceCounter { Runs, Steps, Rejected, BytesWritten, Reallocations, Count };
+
+const int STOP_REASONS = 4; // StopReason values
+
+// One finished scope: a Chrome "complete" event.
+struct TraceEvent{
+    const char* name;      // Phase: "integrate", "write", "export", ...
+    const char* detail;    // Solver, file kind, ... or nullptr
+    uint64_t start_ns;     // Since the first traced event of the process
+    uint64_t duration_ns;
+    uint64_t steps;        // 0 = none
+    uint64_t bytes;        // 0 = none
+    int stop;              // StopReason, -1 = none
+};
+
+// Everything one thread recorded. Events are in the order their scopes
+// ended (inner scopes before the one around them).
+struct TraceThreadLog{
+    int id;                // 0 = first thread that traced anything
+    std::string name;
+    std::vector<TraceEvent> events;
+    uint64_t counters[size_t(TraceCounter::Count)];
+    uint64_t stops[STOP_REASONS];
+    uint64_t dropped;      // Events past TRACE_EVENT_LIMIT (counters still include them)
+};
+
+// Events kept per thread; a sweep of millions of runs keeps its totals but
+// not one event per run.
+const size_t TRACE_EVENT_LIMIT = size_t(1) << 18;
+
+#ifdef MSD_TRACE
+/**
+ * @class TraceScope
+ * @brief Times the enclosing block and records it as one event of the
+ * calling thread's log. Runs, steps and bytes attached to it also go to the
+ * thread's counters. Use it through MSD_TRACE_SCOPE.
+ */
+class TraceScope{
+private:
+    TraceEvent event;
+
+public:
+    explicit TraceScope(const char* name, const char* detail = nullptr);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void record_run(const StepStats& stats);
+    void record_runs(uint64_t runs, uint64_t steps); // Kernels that don't report a stop reason
+    void record_bytes(uint64_t bytes);
+};
+
+void trace_count(TraceCounter counter, uint64_t n);
+
+#define MSD_TRACE_SCOPE(var, ...) TraceScope var(__VA_ARGS__)
+#define MSD_TRACE_RUN(var, stats) var.record_run(stats)
+#define MSD_TRACE_RUNS(var, runs, steps) var.record_runs(runs, steps)
+#define MSD_TRACE_BYTES(var, bytes) var.record_bytes(bytes)
+#define MSD_TRACE_COUNT(counter, n) trace_count(counter, n)
+#define MSD_TRACE_THREAD(name, index) trace_thread_name(name, index)
+#else
+#define MSD_TRACE_SCOPE(var, ...) ((void)0)
+#define MSD_TRACE_RUN(var, stats) ((void)0)
+#define MSD_TRACE_RUNS(var, runs, steps) ((void)0)
+#define MSD_TRACE_BYTES(var, bytes) ((void)0)
+#define MSD_TRACE_COUNT(counter, n) ((void)0)
+#define MSD_TRACE_THREAD(name, index) ((void)0)
+#endif
+
+// --- Trace Prototypes ---
+// These are cold (called once per command) and exist in every build; without
+// MSD_TRACE the logs are always empty.
+
+// Names the calling thread "<name> <index>" in the trace (index < 0: just name).
+void trace_thread_name(const char* name, int index = -1);
+
+// Copy of every thread's log. Call it while no traced work is running.
+std::vector<TraceThreadLog> trace_snapshot();
+
+// Drops every event and counter (thread names are kept).
+void trace_reset();
+
+// Name of a stop reason as it appears in the trace ("settled", "two periods", ...).
+const char* stop_reason_name(int reason);
+
+// One line with the totals and the exclusive time per phase, e.g.
+// "Trace: 3 runs, 1204 steps (stop: settled 3) | 0.1 MB written | integrate 0.2 ms, write 1.1 ms | 2 threads".
+std::string trace_summary();
@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+#include "Trace.h"
+
+/**
+ * @class TrajectorySink
+ * @brief Receives the samples of a simulation while it is running.
+ * The solvers call begin() once, write() once per stored step in time
+ * order, and close() after the last sample.
+ */
+class TrajectorySink{
+public:
+    virtual ~TrajectorySink() {}
+    // Describes the run that is about to start. dt = 0 for adaptive solvers.
+    virtual void begin(const MassSpringDamper& s, Solver solver, double dt) { (void)s; (void)solver; (void)dt; }
+    virtual void write(double t, double x, double v, double a) = 0;
+    virtual void close() {}
+};
+
+/**
+ * @class TrajectoryBuffer
+ * @brief Keeps the whole trajectory in memory (t, x, v, a columns).
+ */
+class TrajectoryBuffer : public TrajectorySink{
+public:
+    std::vector<double> t, x, v, a;
+
+    void write(double t_, double x_, double v_, double a_) override {
+        if(t.size() == t.capacity()) MSD_TRACE_COUNT(TraceCounter::Reallocations, 4); // All four columns grow
+        t.push_back(t_); x.push_back(x_); v.push_back(v_); a.push_back(a_);
+    }
+};
+
+/**
+ * @class StreamWriter
+ * @brief Base of the file sinks: streams samples to disk with constant memory.
+ * Samples go into a fixed ring of column chunks (t, x, v, a blocks); a
+ * background thread hands each full chunk to write_chunk() while the solver
+ * keeps filling the next one. If the writer falls behind, the solver waits
+ * for a free chunk.
+ * Derived classes open their file, call start(), and call close() in their
+ * own destructor (finish() is virtual).
+ */
+class StreamWriter : public TrajectorySink{
+public:
+    static const size_t CHUNK_SAMPLES = 4096;
+
+private:
+    static const size_t CHUNK_COUNT = 4;
+
+    std::vector<double> ring; // CHUNK_COUNT chunks of 4 columns, allocated once
+    size_t fill_chunk = 0;    // Chunk the solver is filling (counts up, used modulo CHUNK_COUNT)
+    size_t fill_size = 0;     // Samples already in it
+    size_t write_chunk_id = 0; // Next chunk the writer thread will flush
+    size_t ready_chunks = 0;  // Chunks handed over and not written yet
+    size_t last_size = 0;     // Size of the final, partial chunk
+    bool finishing = false;
+    bool started = false;
+    bool closed = false;
+
+    std::mutex lock;
+    std::condition_variable chunk_ready;
+    std::condition_variable chunk_free;
+    std::thread writer;
+
+    double* column(size_t chunk, int col) { return &ring[((chunk % CHUNK_COUNT)*4 + col)*CHUNK_SAMPLES]; }
+    void hand_over();
+    void writer_loop();
+
+protected:
+    std::atomic<size_t> bytes{0};
+
+    // Launches the writer thread. Not calling it turns the sink into a no-op.
+    void start();
+
+    // Writer thread: stores n samples given as four columns.
+    virtual void write_chunk(const double* t, const double* x, const double* v, const double* a, size_t n) = 0;
+
+    // Caller's thread, after the last chunk was written.
+    virtual void finish() {}
+
+public:
+    StreamWriter() {}
+    virtual ~StreamWriter();
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    void write(double t, double x, double v, double a) override;
+
+    // Flushes the remaining samples and joins the writer thread.
+    void close() override;
+
+    // Bytes written so far (header included). Exact once close() returns.
+    size_t bytes_written() const { return bytes; }
+};
+
+/**
+ * @class CsvStreamWriter
+ * @brief Streams samples as "time,position,velocity,acceleration" text rows,
+ * with enough digits to read every double back exactly.
+ */
+class CsvStreamWriter : public StreamWriter{
+private:
+    std::string filename;
+    std::ofstream file;
+    bool written = false;
+
+protected:
+    void write_chunk(const double* t, const double* x, const double* v, const double* a, size_t n) override;
+    void finish() override;
+
+public:
+    // Opens the file and writes the header. Prints an error if it can't.
+    explicit CsvStreamWriter(const std::string& filename = "results.csv");
+    ~CsvStreamWriter();
+
+    bool is_open() const { return file.is_open(); }
+    // True once close() has stored the whole file (false if it never opened or a write failed).
+    bool ok() const { return written; }
+};
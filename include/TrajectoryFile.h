@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include "Trajectory.h"
+
+/*
+ * Binary trajectory format (.msdt), native little-endian:
+ *
+ *   [TrajectoryHeader, 128 bytes]
+ *   [block 0] t[B] x[B] v[B] a[B]     B = header.block_size doubles per column
+ *   [block 1] ...
+ *   [last]    t[r] x[r] v[r] a[r]     r = samples % B (if not 0)
+ *
+ * Columns are contiguous inside each block, so a reader can map the file
+ * and hand out column pointers without copying or parsing anything.
+ */
+
+const char TRAJECTORY_MAGIC[8] = {'M','S','D','T','R','A','J','\0'};
+const uint32_t TRAJECTORY_VERSION = 1;
+
+struct TrajectoryHeader{
+    char magic[8];        // TRAJECTORY_MAGIC
+    uint32_t version;     // TRAJECTORY_VERSION
+    uint32_t solver;      // Solver enum value
+    uint64_t samples;     // Total samples (t = 0 included)
+    uint64_t block_size;  // Samples per full block
+    double m, c, k, xo, vo;
+    double dt;            // Fixed step [s], 0 for adaptive solvers
+    double reserved[6];   // Zero, room for later versions
+};
+static_assert(sizeof(TrajectoryHeader) == 128, "TrajectoryHeader must stay 128 bytes");
+
+/**
+ * @class BinaryStreamWriter
+ * @brief Streams samples to a .msdt file, one column block per ring chunk.
+ * The header is rewritten on close() with the final sample count; a failed
+ * write or close prints an error and leaves ok() false.
+ */
+class BinaryStreamWriter : public StreamWriter{
+private:
+    std::string filename;
+    std::ofstream file;
+    TrajectoryHeader header;
+    uint64_t samples = 0;
+    bool report;
+    bool written = false;
+
+protected:
+    void write_chunk(const double* t, const double* x, const double* v, const double* a, size_t n) override;
+    void finish() override;
+
+public:
+    // Opens the file and reserves the header. Prints an error if it can't.
+    // report = false skips the "exported" message (internal files such as the result cache).
+    explicit BinaryStreamWriter(const std::string& filename = "results.msdt", bool report = true);
+    ~BinaryStreamWriter();
+
+    bool is_open() const { return file.is_open(); }
+    // True once close() has stored the whole file (false if it never opened or a write failed).
+    bool ok() const { return written; }
+
+    void begin(const MassSpringDamper& s, Solver solver, double dt) override;
+};
+
+/**
+ * @class TrajectoryFile
+ * @brief Read-only, memory-mapped view of a .msdt file.
+ * Column pointers point straight into the mapping: nothing is copied.
+ */
+class TrajectoryFile{
+private:
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    const double* column(size_t block, int col) const;
+
+public:
+    TrajectoryFile() {}
+    ~TrajectoryFile();
+
+    TrajectoryFile(const TrajectoryFile&) = delete;
+    TrajectoryFile& operator=(const TrajectoryFile&) = delete;
+
+    // Maps the file and checks its header and size. Prints an error and returns false on failure.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return data != nullptr; }
+
+    const TrajectoryHeader& header() const { return *reinterpret_cast<const TrajectoryHeader*>(data); }
+    size_t size() const { return size_t(header().samples); }
+
+    // Blocks and the number of samples in block b.
+    size_t block_count() const;
+    size_t block_length(size_t b) const;
+
+    // Columns of block b.
+    const double* t(size_t b) const { return column(b, 0); }
+    const double* x(size_t b) const { return column(b, 1); }
+    const double* v(size_t b) const { return column(b, 2); }
+    const double* a(size_t b) const { return column(b, 3); }
+};
@@ -1,16 +1,68 @@
 #pragma once
 #include <vector>
+#include <string>
 
 // Forward-declaration to avoid including the full header.
 class MassSpringDamper; 
+struct BatchResult;
+struct FrequencyPoint;
+struct MonteCarloResult;
+struct FitResult;
+struct PararealResult;
+class LatencyHistogram;
 
 // --- Utility Function Prototypes ---
+// The export_* functions print an error and return false if the file can't be
+// created or a write to it fails.
 
-// Writes time-series data to "results.csv".
-void export_results(const std::vector<double>& t, const std::vector<double>& x, const std::vector<double>& v, const std::vector<double>& a);
+// Writes time-series data to 'filename'.
+bool export_results(const std::vector<double>& t, const std::vector<double>& x, const std::vector<double>& v, const std::vector<double>& a,
+                    const std::string& filename = "results.csv");
 
-// Writes system parameters to "system_parameters.csv".
-void export_parameters(const MassSpringDamper& s);
+// Converts a binary trajectory file (.msdt) to CSV, with full double precision.
+bool export_results_csv(const std::string& binary_file = "results.msdt", const std::string& csv_file = "results.csv");
+
+// Writes system parameters to 'filename'.
+bool export_parameters(const MassSpringDamper& s, const std::string& filename = "system_parameters.csv");
+
+// Damped frequency wd [rad/s], damped period Td [s], overshoot Mp [%] and
+// logarithmic decrement. Returns false (values untouched) unless zeta < 1.
+bool damped_parameters(const MassSpringDamper& s, double& wd, double& Td, double& Mp, double& delta);
+
+// Writes a frequency sweep (amplitude, dB, phase) to 'filename', preceded by
+// '#' lines with wn, zeta, wd, Mp and the resonance peak.
+bool export_frequency_response(const MassSpringDamper& s, const std::vector<FrequencyPoint>& points, const std::string& filename = "frequency_response.csv");
+
+// Writes the Monte Carlo metric distributions (count, mean, std, min, p5, p50,
+// p95, max per metric) to 'filename', preceded by '#' lines with the sample counts.
+bool export_monte_carlo(const MonteCarloResult& result, const std::string& filename = "monte_carlo.csv");
+
+// Writes one row per fit start (guess, estimate, standard errors, RMS residual),
+// best fit first, to 'filename'.
+bool export_fit_results(const FitResult& best, const std::vector<FitResult>& starts, const std::string& filename = "fit_results.csv");
+
+// Writes the slice boundary states of a Parareal run (t, x, v) to 'filename',
+// preceded by '#' lines with the iterations, their corrections and the speedup.
+bool export_parareal(const PararealResult& result, const std::string& filename = "parareal_results.csv");
+
+// Writes the non-empty buckets of the step latency and jitter histograms
+// (upper edge in ns and the count of each) to 'filename'.
+bool export_latency_histogram(const LatencyHistogram& latency, const LatencyHistogram& jitter,
+                              const std::string& filename = "soak_latency.csv");
+
+// Writes every thread's trace log (Trace.h) as Chrome trace-event JSON, which
+// chrome://tracing and ui.perfetto.dev open: one track per thread, one slice
+// per traced scope, plus counter tracks of the steps taken and bytes written.
+bool export_trace(const std::string& filename = "trace.json");
+
+// Writes one row of summary metrics per system to 'filename'.
+// precision_columns adds float_error and rerun (reduced-precision sweeps).
+bool export_batch_results(const std::vector<BatchResult>& results, const char* filename = "batch_results.csv",
+                          bool precision_columns = false);
+
+// Cross-platform screen clear. Uses ANSI escape codes outside Windows,
+// so no shell process is spawned.
+void clearScreen();
 
 // Cross-platform pause and screen clear.
 void pauseAndClear();
\ No newline at end of file
@@ -0,0 +1,25 @@
+import sys
+import numpy as np
+import matplotlib.pyplot as plt
+
+# Frequency response written by "msd bode" (see include/FrequencyResponse.h)
+path = sys.argv[1] if len(sys.argv) > 1 else "frequency_response.csv"
+# '#' lines hold the system summary, then one header row and the sweep.
+with open(path, encoding="utf-8") as f:
+    rows = [line for line in f if not line.startswith("#")]
+omega, hz, amplitude, magnitude_db, phase_deg = np.loadtxt(rows[1:], delimiter=",", unpack=True)
+
+fig, (ax_mag, ax_phase) = plt.subplots(2, 1, sharex=True, figsize=(10, 8))
+
+ax_mag.semilogx(omega, magnitude_db, color='b')
+ax_mag.set_title("Mass-Spring-Damper System - Frequency Response")
+ax_mag.set_ylabel("Magnitude (dB re 1 m/N)")
+ax_mag.grid(True, which="both")
+
+ax_phase.semilogx(omega, phase_deg, color='r')
+ax_phase.set_xlabel("Excitation frequency (rad/s)")
+ax_phase.set_ylabel("Phase (deg)")
+ax_phase.grid(True, which="both")
+
+plt.tight_layout()
+plt.show()
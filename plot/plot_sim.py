@@ -1,14 +1,44 @@
-import pandas as pd
+import os
+import numpy as np
 import matplotlib.pyplot as plt
 
-# Read CSV file
-data = pd.read_csv("results.csv")
+# Binary trajectory header (see include/TrajectoryFile.h), 128 bytes
+HEADER = np.dtype([
+    ("magic", "S8"), ("version", "<u4"), ("solver", "<u4"),
+    ("samples", "<u8"), ("block_size", "<u8"),
+    ("m", "<f8"), ("c", "<f8"), ("k", "<f8"), ("xo", "<f8"), ("vo", "<f8"),
+    ("dt", "<f8"), ("reserved", "<f8", 6),
+])
 
-# Extract columns
-t = data["time(s)"]
-x = data["position(m)"]
-v = data["velocity(m/s)"]
-a = data["acceleration(m/s^2)"]
+
+def load_trajectory(path):
+    """Maps a .msdt file and returns its t, x, v, a columns (no text parsing)."""
+    header = np.fromfile(path, dtype=HEADER, count=1)[0]
+    if header["magic"] != b"MSDTRAJ" or header["version"] != 1:
+        raise ValueError(path + " is not a trajectory file")
+
+    n, bs = int(header["samples"]), int(header["block_size"])
+    data = np.memmap(path, dtype="<f8", mode="r", offset=HEADER.itemsize, shape=(4 * n,))
+
+    # Full blocks are [t x v a] x block_size; the last one may be shorter.
+    full = n // bs
+    rest = n - full * bs
+    cols = data[:4 * full * bs].reshape(full, 4, bs).transpose(1, 0, 2).reshape(4, full * bs)
+    if rest:
+        cols = np.concatenate([cols, data[4 * full * bs:].reshape(4, rest)], axis=1)
+    return cols[0], cols[1], cols[2], cols[3]
+
+
+if os.path.exists("results.msdt"):
+    t, x, v, a = load_trajectory("results.msdt")
+else:
+    # Older runs / CSV export
+    import pandas as pd
+    data = pd.read_csv("results.csv")
+    t = data["time(s)"]
+    x = data["position(m)"]
+    v = data["velocity(m/s)"]
+    a = data["acceleration(m/s^2)"]
 
 # Plot position
 plt.figure(figsize=(10, 6))
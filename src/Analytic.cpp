@@ -0,0 +1,208 @@
+#include "Analytic.h"
+#include <cmath>
+
+using namespace std;
+
+// |zeta - 1| below this is treated as critical damping: the under/overdamped
+// formulas divide by wd or (r1 - r2), which vanish there.
+static const double CRITICAL_BAND = 1e-9;
+
+FreeResponse::FreeResponse(const MassSpringDamper& s){
+    double wn = s.get_wn(), zeta = s.get_zeta();
+    double xo = s.get_xo(), vo = s.get_vo();
+
+    sigma = zeta*wn;
+    wd = 0;
+    r1 = r2 = 0;
+
+    if(abs(zeta - 1) < CRITICAL_BAND){
+        regime = 1;
+        A = xo;
+        B = vo + sigma*xo;
+    }
+    else if(zeta < 1){
+        regime = 0;
+        wd = wn*sqrt(1 - zeta*zeta);
+        A = xo;
+        B = (vo + sigma*xo)/wd;
+    }
+    else {
+        regime = 2;
+        double root = wn*sqrt(zeta*zeta - 1);
+        r1 = -sigma + root;
+        r2 = -sigma - root;
+        A = (vo - r2*xo)/(r1 - r2);
+        B = xo - A;
+    }
+}
+
+void FreeResponse::state(double t, double& x, double& v) const{
+    if(regime == 0){
+        double decay = exp(-sigma*t), cs = cos(wd*t), sn = sin(wd*t);
+        x = decay*(A*cs + B*sn);
+        v = decay*((B*wd - sigma*A)*cs - (A*wd + sigma*B)*sn);
+    }
+    else if(regime == 1){
+        double decay = exp(-sigma*t);
+        x = decay*(A + B*t);
+        v = decay*(B - sigma*(A + B*t));
+    }
+    else {
+        double e1 = exp(r1*t), e2 = exp(r2*t);
+        x = A*e1 + B*e2;
+        v = A*r1*e1 + B*r2*e2;
+    }
+}
+
+double FreeResponse::x(double t) const{
+    double x_, v_;
+    state(t, x_, v_);
+    return x_;
+}
+
+double FreeResponse::v(double t) const{
+    double x_, v_;
+    state(t, x_, v_);
+    return v_;
+}
+
+void FreeResponse::evaluate(const double* t, size_t n, double* x, double* v) const{
+    // One branch-free loop per regime so the compiler can vectorize it
+    // (given a vector math library for exp/sin/cos).
+    if(regime == 0){
+        const double cv = B*wd - sigma*A, sv = A*wd + sigma*B;
+        for(size_t i = 0; i < n; i++){
+            double decay = exp(-sigma*t[i]), cs = cos(wd*t[i]), sn = sin(wd*t[i]);
+            x[i] = decay*(A*cs + B*sn);
+            v[i] = decay*(cv*cs - sv*sn);
+        }
+    }
+    else if(regime == 1){
+        for(size_t i = 0; i < n; i++){
+            double decay = exp(-sigma*t[i]);
+            x[i] = decay*(A + B*t[i]);
+            v[i] = decay*(B - sigma*(A + B*t[i]));
+        }
+    }
+    else {
+        for(size_t i = 0; i < n; i++){
+            double e1 = exp(r1*t[i]), e2 = exp(r2*t[i]);
+            x[i] = A*e1 + B*e2;
+            v[i] = A*r1*e1 + B*r2*e2;
+        }
+    }
+}
+
+ErrorReport global_error(const MassSpringDamper& s, const vector<double>& t, const vector<double>& x, const vector<double>& v){
+    ErrorReport r = {0, 0, 0};
+    if(t.empty()) return r;
+
+    FreeResponse exact(s);
+    vector<double> xe(t.size()), ve(t.size());
+    exact.evaluate(t.data(), t.size(), xe.data(), ve.data());
+
+    double sum = 0;
+    for(size_t i = 0; i < t.size(); i++){
+        double ex = abs(x[i] - xe[i]), ev = abs(v[i] - ve[i]);
+        if(ex > r.max_x_error) r.max_x_error = ex;
+        if(ev > r.max_v_error) r.max_v_error = ev;
+        sum += ex*ex;
+    }
+    r.rms_x_error = sqrt(sum/t.size());
+    return r;
+}
+
+ErrorTracker::ErrorTracker(const MassSpringDamper& s) : exact(s), r{0, 0, 0}, sum_sq(0), n(0) {}
+
+void ErrorTracker::add(double t, double x, double v){
+    double xe, ve;
+    exact.state(t, xe, ve);
+    double ex = abs(x - xe), ev = abs(v - ve);
+    if(ex > r.max_x_error) r.max_x_error = ex;
+    if(ev > r.max_v_error) r.max_v_error = ev;
+    sum_sq += ex*ex;
+    n++;
+}
+
+ErrorReport ErrorTracker::report() const{
+    ErrorReport out = r;
+    out.rms_x_error = (n > 0) ? sqrt(sum_sq/n) : 0;
+    return out;
+}
+
+// --- Exact discretization ---
+
+ExactStepMap exact_step_map(double wn, double zeta, double dt){
+    const double sigma = zeta*wn, wn2 = wn*wn;
+    ExactStepMap E;
+    StepMap& P = E.map;
+
+    // Phi = e^(-sigma dt) [[C + sigma S, S], [-wn^2 S, C - sigma S]] with
+    //   underdamped: C = cos(wd dt),    S = sin(wd dt)/wd
+    //   overdamped:  C = cosh(wa dt),   S = sinh(wa dt)/wa   (wa = wn sqrt(zeta^2 - 1))
+    // Both are the same series in q = (1 - zeta^2)(wn dt)^2, used for |q| < 1:
+    // it stays exact through critical damping, where wd and wa vanish.
+    const double q = (1 - zeta*zeta)*wn2*dt*dt;
+    if(abs(q) < 1){
+        double c = 1, s = 1, tc = 1, ts = 1;
+        for(int k = 1; k <= 10; k++){ // 1/(2k+1)! is below 1e-19 by k = 10
+            tc *= -q/((2*k - 1)*(2*k));
+            ts *= -q/((2*k)*(2*k + 1));
+            c += tc;
+            s += ts;
+        }
+        double decay = exp(-sigma*dt);
+        c *= decay;
+        s *= decay*dt;
+        P.xx = c + sigma*s;
+        P.xv = s;
+        P.vx = -wn2*s;
+        P.vv = c - sigma*s;
+    }
+    else if(q > 0){
+        double wd = wn*sqrt(1 - zeta*zeta);
+        double decay = exp(-sigma*dt), c = decay*cos(wd*dt), s = decay*sin(wd*dt)/wd;
+        P.xx = c + sigma*s;
+        P.xv = s;
+        P.vx = -wn2*s;
+        P.vv = c - sigma*s;
+    }
+    else {
+        // Written with the real poles (r1 without the cancellation of -sigma + wa),
+        // so no term loses digits however large zeta is.
+        double root = sqrt(zeta*zeta - 1);
+        double r1 = -wn/(zeta + root), r2 = -wn*(zeta + root);
+        double e1 = exp(r1*dt), e2 = exp(r2*dt), d = r1 - r2;
+        P.xx = (r1*e2 - r2*e1)/d;
+        P.xv = (e1 - e2)/d;
+        P.vx = -wn2*P.xv;
+        P.vv = (r1*e1 - r2*e2)/d;
+    }
+    P.ax = -wn2*P.xx - 2*sigma*P.vx;
+    P.av = -wn2*P.xv - 2*sigma*P.vv;
+
+    // Held input: vu = integral of Phi_vx/(-wn^2) = xv, and xu = integral of xv
+    // = (1 - xx)/wn^2, which cancels for short steps. There xu comes from the
+    // Taylor series of y'' + 2 sigma y' + wn^2 y = 1, y(0) = y'(0) = 0.
+    E.vu = P.xv;
+    if((sigma + wn)*dt < 1){
+        // b_k = y_k dt^k; (sigma + wn) dt < 1 makes the terms shrink at least geometrically
+        double b0 = 0, b1 = dt*dt/2, sum = b1; // b_(k-1), b_k
+        for(int k = 2; k < 30; k++){
+            double b2 = -(2*sigma*dt*k*b1 + wn2*dt*dt*b0)/(k*(k + 1));
+            sum += b2;
+            b0 = b1;
+            b1 = b2;
+        }
+        E.xu = sum;
+    }
+    else if(q < -1e-2){
+        double root = sqrt(zeta*zeta - 1);
+        double r1 = -wn/(zeta + root), r2 = -wn*(zeta + root);
+        E.xu = (expm1(r1*dt)/r1 - expm1(r2*dt)/r2)/(r1 - r2);
+    }
+    else {
+        E.xu = (1 - P.xx)/wn2;
+    }
+    return E;
+}
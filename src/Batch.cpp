@@ -0,0 +1,256 @@
+#include "Batch.h"
+#include "ThreadPool.h"
+#include "SoaRK4.h"
+#include "ResultCache.h"
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>    // std::sort
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// Systems per task. Small enough to balance uneven run lengths
+// (stiff or lightly damped systems take far more steps), large enough
+// to keep the per-task overhead negligible.
+static const size_t BATCH_GRAIN = 64;
+
+// Value of the i-th of n evenly spaced points.
+static double range_value(const SweepRange& r, int i){
+    if(r.n <= 1) return r.min;
+    return r.min + (r.max - r.min)*i/(r.n - 1);
+}
+
+// Validates and appends one system. Returns false if it was rejected.
+static bool add_system(vector<MassSpringDamper>& systems, double m_, double c_, double k_, double xo_, double vo_){
+    MassSpringDamper s;
+    int e[5] = {0,0,0,0,0};
+    s.validate_parameters(e, m_, c_, k_, xo_, vo_);
+    if(e[0]==1 && e[1]==1 && e[2]==1 && e[3]==1 && e[4]==1){
+        s.set_parameters(m_, c_, k_, xo_, vo_);
+        systems.push_back(s);
+        return true;
+    }
+    return false;
+}
+
+vector<MassSpringDamper> build_grid(const SweepRange& m, const SweepRange& c, const SweepRange& k, double xo, double vo, size_t* rejected){
+    vector<MassSpringDamper> systems;
+    size_t bad = 0;
+    if(m.n > 0 && c.n > 0 && k.n > 0){
+        systems.reserve(size_t(m.n)*c.n*k.n);
+    }
+
+    for(int i = 0; i < m.n; i++){
+        for(int j = 0; j < c.n; j++){
+            for(int l = 0; l < k.n; l++){
+                if(!add_system(systems, range_value(m, i), range_value(c, j), range_value(k, l), xo, vo)) bad++;
+            }
+        }
+    }
+
+    if(rejected) *rejected = bad;
+    return systems;
+}
+
+vector<MassSpringDamper> read_parameter_list(const string& filename, size_t* rejected){
+    vector<MassSpringDamper> systems;
+    size_t bad = 0;
+
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not open '" << filename << "'" << endl;
+        if(rejected) *rejected = 0;
+        return systems;
+    }
+
+    string line;
+    bool first_line = true;
+    while(getline(file, line)){
+        if(line.empty() || line[0] == '#') continue;
+        for(char& ch : line){ if(ch == ',') ch = ' '; }
+
+        istringstream in(line);
+        double m_, c_, k_, xo_, vo_;
+        if(!(in >> m_ >> c_ >> k_ >> xo_ >> vo_)){
+            if(!first_line) bad++; // The first line may be a header
+            first_line = false;
+            continue;
+        }
+        first_line = false;
+        if(!add_system(systems, m_, c_, k_, xo_, vo_)) bad++;
+    }
+
+    if(rejected) *rejected = bad;
+    return systems;
+}
+
+// Steps of n summaries, for the trace.
+[[maybe_unused]] static uint64_t total_steps(const SimSummary* summaries, size_t n){
+    uint64_t steps = 0;
+    for(size_t i = 0; i < n; i++) steps += uint64_t(summaries[i].steps);
+    return steps;
+}
+
+void simulate_summaries(const MassSpringDamper* systems, size_t n, Solver solver, SimSummary* out){
+    if(solver != Solver::RK4){
+        for(size_t i = 0; i < n; i++) out[i] = simulate_summary(systems[i], solver);
+        return;
+    }
+    // RK4 goes through the SIMD kernel, one system per lane
+    OscillatorSoA soa;
+    load_soa(soa, systems, n);
+    rk4_soa(soa, out);
+}
+
+// Simulates systems[i] for every i in 'todo' into results[i].
+static void simulate_all(const vector<MassSpringDamper>& systems, const vector<size_t>& todo, Solver solver,
+                         unsigned threads, vector<BatchResult>& results){
+    ThreadPool pool(threads);
+
+    // Each task writes a disjoint slice of 'results', so no locking is needed.
+    pool.parallel_for(todo.size(), BATCH_GRAIN, [&](size_t begin, size_t end){
+        MSD_TRACE_SCOPE(scope, "batch chunk");
+        SimSummary summaries[BATCH_GRAIN];
+        const MassSpringDamper* chunk = &systems[todo[begin]];
+        MassSpringDamper gathered[BATCH_GRAIN] = {};
+        if(todo[end - 1] - todo[begin] != end - 1 - begin){
+            // Cache hits left gaps: gather the misses
+            for(size_t i = begin; i < end; i++) gathered[i - begin] = systems[todo[i]];
+            chunk = gathered;
+        }
+        simulate_summaries(chunk, end - begin, solver, summaries);
+        if(solver == Solver::RK4){
+            MSD_TRACE_RUNS(scope, end - begin, total_steps(summaries, end - begin)); // The kernel reports no stop reasons
+        }
+        for(size_t i = begin; i < end; i++) results[todo[i]].summary = summaries[i - begin];
+    });
+}
+
+vector<BatchResult> run_batch(const vector<MassSpringDamper>& systems, Solver solver, unsigned threads, ResultCache* cache){
+    vector<BatchResult> results(systems.size());
+    vector<size_t> todo;
+    todo.reserve(systems.size());
+    for(size_t i = 0; i < systems.size(); i++){
+        results[i].system = systems[i];
+        if(!cache || !cache->find_summary(make_cache_key(systems[i], solver), results[i].summary)) todo.push_back(i);
+    }
+
+    simulate_all(systems, todo, solver, threads, results);
+
+    if(cache){
+        for(size_t i : todo) cache->store_summary(make_cache_key(systems[i], solver), results[i].summary);
+    }
+    return results;
+}
+
+// --- Reduced precision ---
+
+// P^n by repeated squaring: the double RK4 state after n steps in O(log n) products.
+static StepMap map_power(StepMap P, long long n){
+    StepMap R = {1, 0, 0, 1, 0, 0};
+    while(n > 0){
+        if(n & 1) R = {R.xx*P.xx + R.xv*P.vx, R.xx*P.xv + R.xv*P.vv, R.vx*P.xx + R.vv*P.vx, R.vx*P.xv + R.vv*P.vv, 0, 0};
+        P = {P.xx*P.xx + P.xv*P.vx, P.xx*P.xv + P.xv*P.vv, P.vx*P.xx + P.vv*P.vx, P.vx*P.xv + P.vv*P.vv, 0, 0};
+        n >>= 1;
+    }
+    return R;
+}
+
+// Error of a float run that ended in (x, v), as defined in PrecisionReport.
+static double float_error(const MassSpringDamper& s, const SimSummary& summary, double x, double v){
+    StepMap P = map_power(free_step_map(s, Solver::RK4, default_dt(s)), summary.steps);
+    double dx = x - (P.xx*s.get_xo() + P.xv*s.get_vo());
+    double dv = (v - (P.vx*s.get_xo() + P.vv*s.get_vo()))/s.get_wn();
+    return (summary.peak > 0) ? sqrt(dx*dx + dv*dv)/summary.peak : 0;
+}
+
+// Float sweep of systems[i] for every i in 'todo', with the error of each run.
+static void simulate_all_float(const vector<MassSpringDamper>& systems, const vector<size_t>& todo,
+                               unsigned threads, vector<BatchResult>& results){
+    ThreadPool pool(threads);
+
+    pool.parallel_for(todo.size(), BATCH_GRAIN, [&](size_t begin, size_t end){
+        MSD_TRACE_SCOPE(scope, "batch chunk float");
+        const size_t n = end - begin;
+        MassSpringDamper chunk[BATCH_GRAIN] = {};
+        SimSummary summaries[BATCH_GRAIN];
+        // A block of lanes runs as long as its longest run: pack runs of
+        // similar length together (2% settling time or the step limit).
+        size_t order[BATCH_GRAIN]; // Index into 'systems' of each lane
+        double length[BATCH_GRAIN];
+        for(size_t i = 0; i < n; i++){
+            const MassSpringDamper& s = systems[todo[begin + i]];
+            order[i] = i;
+            length[i] = min(s.get_Ts()/default_dt(s), rk4_soa_step_limit(s));
+        }
+        sort(order, order + n, [&](size_t a, size_t b){ return length[a] < length[b]; });
+        for(size_t i = 0; i < n; i++){
+            order[i] = todo[begin + order[i]];
+            chunk[i] = systems[order[i]];
+        }
+
+        FloatOscillatorSoA soa;
+        load_soa(soa, chunk, n);
+        rk4_soa(soa, summaries);
+        MSD_TRACE_RUNS(scope, n, total_steps(summaries, n));
+
+        for(size_t i = 0; i < n; i++){
+            BatchResult& r = results[order[i]];
+            r.summary = summaries[i];
+            r.float_error = float_error(chunk[i], summaries[i], soa.x[i], soa.v[i]);
+        }
+    });
+}
+
+vector<BatchResult> run_batch_precision(const vector<MassSpringDamper>& systems, const PrecisionOptions& opt,
+                                        unsigned threads, PrecisionReport* report){
+    PrecisionReport rep;
+    if(opt.precision == Precision::Double){
+        if(report) *report = rep;
+        return run_batch(systems, Solver::RK4, threads);
+    }
+
+    vector<BatchResult> results(systems.size());
+    vector<size_t> single, twice; // Float runs; double runs (too long for float, then the re-runs)
+    for(size_t i = 0; i < systems.size(); i++){
+        results[i].system = systems[i];
+        if(rk4_soa_step_limit(systems[i]) <= SOA_FLOAT_MAX_STEPS) single.push_back(i);
+        else twice.push_back(i);
+    }
+    rep.single = single.size();
+    rep.too_long = twice.size();
+
+    auto start = Clock::now();
+    simulate_all_float(systems, single, threads, results);
+    rep.seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    for(size_t i : single){
+        const double e = results[i].float_error;
+        if(e > rep.max_error){
+            rep.max_error = e;
+            rep.worst = i;
+        }
+        if(e > opt.tolerance){
+            rep.flagged++;
+            if(opt.precision == Precision::Mixed){
+                results[i].rerun = true;
+                twice.push_back(i);
+            }
+        }
+    }
+    rep.rerun = twice.size() - rep.too_long;
+
+    // simulate_all() expects ascending indices (it takes runs of them in place)
+    sort(twice.begin(), twice.end());
+    start = Clock::now();
+    if(!twice.empty()) simulate_all(systems, twice, Solver::RK4, threads, results);
+    rep.rerun_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    if(report) *report = rep;
+    return results;
+}
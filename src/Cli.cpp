@@ -0,0 +1,1170 @@
+#include "Cli.h"
+#include "MassSpringDamper.h"
+#include "Simulation.h"
+#include "OutputPolicy.h"
+#include "Batch.h"
+#include "Network.h"
+#include "Forcing.h"
+#include "FrequencyResponse.h"
+#include "MonteCarlo.h"
+#include "Identification.h"
+#include "ResultCache.h"
+#include "RealTime.h"
+#include "Nonlinear.h"
+#include "Parareal.h"
+#include "Server.h"
+#include "TrajectoryFile.h"
+#include "Trace.h"
+#include "utils.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <climits>      // For INT_MAX
+#include <cerrno>
+#include <cctype>       // For isdigit
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <csignal>
+
+using namespace std;
+
+// Option name (without "--") -> raw value. Filled from the config file first, then argv.
+typedef map<string, string> RunConfig;
+
+static void print_usage(const char* prog){
+    cout << "Usage:" << endl
+         << "  " << prog << "                       interactive menu" << endl
+         << "  " << prog << " run [options]         single headless simulation" << endl
+         << "  " << prog << " batch list <file> [euler|rk4|rk45|verlet|exact] [threads] [--out <file>] [--cache <dir>] [--cache_mb <N>] [batch options]" << endl
+         << "  " << prog << " batch grid <m_min> <m_max> <m_n> <c_min> <c_max> <c_n> <k_min> <k_max> <k_n> <x0> <v0>"
+         << " [euler|rk4|rk45|verlet|exact] [threads] [--out <file>] [--cache <dir>] [--cache_mb <N>] [batch options]" << endl
+         << "  " << prog << " bode [options]        frequency response sweep" << endl
+         << "  " << prog << " montecarlo [options]  uncertainty propagation over toleranced parameters" << endl
+         << "  " << prog << " fit [options]         estimate c and k from a measured displacement log" << endl
+         << "  " << prog << " soak [options]        real-time stepper at a fixed rate, with latency statistics" << endl
+         << "  " << prog << " parareal [options]    parallel-in-time RK4 of one long run, with speedup over the serial run" << endl
+         << "  " << prog << " serve [options]       simulation server on a Unix domain socket" << endl
+         << "  " << prog << " request [options]     one request to a running server" << endl
+         << "  " << prog << " network chain <n> <m> <k> <c> <x0> <t_end> [euler|rk4] [threads] [network options]" << endl
+         << "  " << prog << " network mesh <rows> <cols> <m> <k> <c> <x0> <t_end> [euler|rk4] [threads] [network options]" << endl
+         << "  " << prog << " network file <file> <t_end> [euler|rk4] [threads] [network options]" << endl
+         << endl
+         << "run options:" << endl
+         << "  --config <file>     'key = value' lines using the option names below (without --)" << endl
+         << "  --m <kg> --c <N.s/m> --k <N/m> --x0 <m> --v0 <m/s>" << endl
+         << "  --solver <euler|rk4|rk45|verlet|exact>   default rk4" << endl
+         << "  --dt <s>                             fixed step, default 1/(10 wn) up to 0.01 s; with exact, any" << endl
+         << "                                       step (e.g. the output rate) is free of error" << endl
+         << "  --out <file.msdt>                    default results.msdt" << endl
+         << "  --csv <file.csv>                     also write a CSV copy" << endl
+         << "  --params <file.csv>                  also export the parameter table" << endl
+         << "  --output <every|nth:N|interval:DT|events>   default every" << endl
+         << "  --force <harmonic:A:w[:phase]|step:A[:t0]|impulse:J[:t0]|sampled:file.csv>   external force F(t) [N]" << endl
+         << "  --t_end <s>                          forced / nonlinear runs: duration, default 100 natural periods" << endl
+         << "  --k3 <N/m^3>                         cubic (Duffing) stiffness" << endl
+         << "  --friction <N> [--static_friction <N>]   Coulomb friction, break-away force default = friction" << endl
+         << "  --x_min <m> --x_max <m> [--restitution <0..1>]   hard stops, restitution default 0.5" << endl
+         << "                                       (any of these makes a nonlinear run: euler, rk4 or verlet)" << endl << endl
+         << "  --cache <dir>                        reuse / keep free-response trajectories in a result cache" << endl
+         << "  --cache_mb <N>                       cache size limit on disk, default 1024"
+         << endl << endl
+         << "batch options:" << endl
+         << "  --precision <double|single|mixed>    rk4 only, default double. single: float kernel (twice the SIMD lanes)" << endl
+         << "                                       with an error estimate per system; mixed: single, then the flagged" << endl
+         << "                                       systems again in double. Reduced precision is not cached." << endl
+         << "  --tolerance <e>                      float error, relative to the peak, above which a system is flagged, default 1e-3" << endl
+         << "bode options:" << endl
+         << "  --m --c --k (and --config) as for run" << endl
+         << "  --w_min <rad/s> --w_max <rad/s>      default wn/100 .. 100*wn" << endl
+         << "  --points <N>                         default 1000 (at most 1e6), log-spaced" << endl
+         << "  --method <analytic|simulated>        default analytic (transfer function)" << endl
+         << "  --solver <euler|rk4|verlet|exact>    simulated method, default rk4" << endl
+         << "  --threads <N>                        default one per hardware thread" << endl
+         << "  --out <file.csv>                     default frequency_response.csv" << endl
+         << endl
+         << "montecarlo options:" << endl
+         << "  --m --c --k --x0 --v0 <dist>         dist: <value> | uniform:min:max | normal:mean:sd" << endl
+         << "                                       | lognormal:median:sigma | tol:nominal:percent (x0, v0 default 0, not both)" << endl
+         << "  --samples <N>                        default 10000" << endl
+         << "  --seed <S>                           default 1; same seed, same result for any thread count" << endl
+         << "  --solver <euler|rk4|rk45|verlet|exact>   default rk4" << endl
+         << "  --threads <N>                        default one per hardware thread" << endl
+         << "  --out <file.csv>                     default monte_carlo.csv" << endl
+         << endl
+         << "fit options:" << endl
+         << "  --data <file.csv>                    log in the results.csv layout (time, position[, velocity, ...])" << endl
+         << "  --m <kg>                             known mass" << endl
+         << "  --starts <N>                         initial guesses, default 8 (at most 1e6)" << endl
+         << "  --threads <N>                        default one per hardware thread" << endl
+         << "  --out <file.csv>                     default fit_results.csv" << endl
+         << endl
+         << "soak options:" << endl
+         << "  --m --c --k --x0 --v0 (and --config) as for run" << endl
+         << "  --solver <euler|rk4|verlet|exact>    default rk4" << endl
+         << "  --force <spec>                       as for run, held over each step (impulses ignored)" << endl
+         << "  --rate <Hz>                          steps per second, default 10000 (0 = back to back, at most 1e9)" << endl
+         << "  --duration <s>                       default 10" << endl
+         << "  --report <s>                         progress line interval, default 10 (0 = none)" << endl
+         << "  --budget_us <us>                     step time budget, default one period" << endl
+         << "  --out <file.csv>                     latency histogram, default soak_latency.csv" << endl
+         << endl
+         << "parareal options:" << endl
+         << "  --m --c --k --x0 --v0 (and --config) as for run" << endl
+         << "  --t_end <s>                          default 100000 natural periods" << endl
+         << "  --force <spec>                       as for run (impulses ignored)" << endl
+         << "  --coarse <exact|euler>               coarse propagator, default exact" << endl
+         << "  --coarse_ratio <N>                   coarse step / fine step, default one step per slice (exact), 10 (euler)" << endl
+         << "  --slices <N>                         time slices, default one per thread" << endl
+         << "  --iterations <N>                     at most, default the slice count" << endl
+         << "  --tol <relative>                     convergence tolerance, default 1e-10" << endl
+         << "  --serial <yes|no>                    also time the serial RK4 run, default yes" << endl
+         << "  --threads <N>                        default one per hardware thread" << endl
+         << "  --out <file.csv>                     slice boundary states, default parareal_results.csv" << endl
+         << endl
+         << "serve options:" << endl
+         << "  --socket <path>                      default msd.sock" << endl
+         << "  --threads <N>                        default one per hardware thread" << endl
+         << "  --batch_max <N>                      summary requests per batch at most (1 to 1e6), default 4096" << endl
+         << "  --batch_window_us <us>               wait for more requests after the first, default 200" << endl
+         << "  --report <s>                         queue depth / throughput line interval, default 10 (0 = none)" << endl
+         << "  (runs until SIGINT or SIGTERM)" << endl
+         << endl
+         << "request options:" << endl
+         << "  --socket <path>                      default msd.sock" << endl
+         << "  --kind <summary|trajectory|stats>    default summary" << endl
+         << "  --m --c --k --x0 --v0 --solver --dt --output (and --config) as for run" << endl
+         << "  --out <file.msdt>                    trajectory: where the streamed samples go, default results.msdt" << endl
+         << endl
+         << "network options:" << endl
+         << "  --out <file.csv>                     default network_results.csv" << endl
+         << "  --probes <i,j,...>                   masses written to the CSV, default first, middle and last" << endl
+         << "  --every <N>                          write every N-th step, default 1" << endl
+         << "  (chain/mesh: x0 is the initial displacement of mass 0)" << endl
+         << endl
+         << "any command:" << endl
+         << "  --trace <file.json>                  builds with -DMSD_TRACE=ON: write a Chrome trace file" << endl
+         << endl
+         << "Exit codes: " << CLI_OK << " ok, " << CLI_USAGE_ERROR << " usage error, "
+         << CLI_INVALID_PARAMETERS << " invalid parameters, " << CLI_IO_ERROR << " file error" << endl;
+}
+
+static bool parse_solver(const string& name, Solver& solver){
+    if(name == "euler") solver = Solver::Euler;
+    else if(name == "rk4") solver = Solver::RK4;
+    else if(name == "rk45") solver = Solver::RK45;
+    else if(name == "verlet") solver = Solver::Verlet;
+    else if(name == "exact") solver = Solver::Exact;
+    else return false;
+    return true;
+}
+
+// every | nth:N | interval:DT | events
+// The argument must parse completely ("nth:5x" or "interval:1e-3junk" is an error).
+static bool parse_output(const string& spec, OutputPolicy& policy){
+    size_t colon = spec.find(':');
+    string kind = spec.substr(0, colon);
+    string arg = (colon == string::npos) ? "" : spec.substr(colon + 1);
+    const char* text = arg.c_str();
+    char* end = nullptr;
+
+    if(kind == "every" && colon == string::npos){ policy.mode = OutputMode::EveryStep; return true; }
+    if(kind == "events" && colon == string::npos){ policy.mode = OutputMode::Events; return true; }
+    if(kind == "nth"){
+        errno = 0;
+        long every = strtol(text, &end, 10);
+        if(end == text || *end != '\0' || errno == ERANGE || every < 1 || every > INT_MAX) return false;
+        policy.mode = OutputMode::EveryNth;
+        policy.every = int(every);
+        return true;
+    }
+    if(kind == "interval"){
+        double interval = strtod(text, &end);
+        if(end == text || *end != '\0' || !isfinite(interval) || interval <= 0) return false;
+        policy.mode = OutputMode::FixedInterval;
+        policy.interval = interval;
+        return true;
+    }
+    return false;
+}
+
+static bool parse_number(const string& text, double& value){
+    istringstream in(text);
+    char extra;
+    return (in >> value) && !(in >> extra);
+}
+
+// Whole number in [lo, hi] (counts of points, masses, threads).
+static bool parse_count(const string& text, double lo, double hi, double& value){
+    return parse_number(text, value) && value == floor(value) && value >= lo && value <= hi;
+}
+
+// Any 64-bit unsigned integer, exactly (RNG seeds: a double would round those above 2^53).
+static bool parse_u64(const string& text, uint64_t& value){
+    if(text.empty() || !isdigit((unsigned char)text[0])) return false; // strtoull would take "-1" and " 1"
+    char* end;
+    errno = 0;
+    unsigned long long v = strtoull(text.c_str(), &end, 10);
+    if(*end != '\0' || errno == ERANGE) return false;
+    value = uint64_t(v);
+    return true;
+}
+
+// Positional thread counts: 0 = one per hardware thread.
+const double MAX_THREADS = 1024;
+
+// Reads "key = value" (or "key value") lines; '#' starts a comment.
+static bool read_config(const string& filename, RunConfig& config){
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not open '" << filename << "'" << endl;
+        return false;
+    }
+    string line;
+    while(getline(file, line)){
+        line = line.substr(0, line.find('#'));
+        for(char& ch : line){ if(ch == '=' || ch == '\r') ch = ' '; }
+        istringstream in(line);
+        string key, value;
+        if(in >> key >> value) config[key] = value;
+    }
+    return true;
+}
+
+// Prints the same limits the interactive wizard shows for every failed flag.
+static void print_validation_errors(const int* e){
+    const char* limits[5] = {
+        "1e-6 <= m <= 1e+3", "0 <= c <= 1e+5", "0 <= k <= 1e+7", "|x0| <= 5", "|v0| <= 20"
+    };
+    for(int i = 0; i < 5; i++){
+        if(e[i] == 0) cout << "(INVALID PARAMETER) Be aware: " << limits[i] << endl;
+    }
+}
+
+static void print_cache_stats(const CacheStats& c){
+    cout << "Cache: " << (c.memory_hits + c.disk_hits) << " hits (" << c.memory_hits << " memory, " << c.disk_hits << " disk), "
+         << c.misses << " misses, " << c.evictions << " evicted; " << c.disk_entries << " entries, "
+         << fixed << setprecision(1) << c.disk_bytes/1048576.0 << " MB on disk" << defaultfloat << setprecision(6) << endl;
+}
+
+static bool allowed_option(const string& key, const vector<string>& allowed){
+    return find(allowed.begin(), allowed.end(), key) != allowed.end();
+}
+
+// Reads "--key value" pairs (after an optional --config file) into 'config'.
+// Only the option names in 'allowed' are accepted, on the command line
+// and in the config file alike, so a misspelt option is not silently dropped.
+// Returns CLI_OK or the exit code to stop with.
+static int read_options(int argc, char* argv[], RunConfig& config, const vector<string>& allowed){
+    // The config file goes first so command-line values override it.
+    for(int i = 2; i + 1 < argc; i++){
+        if(string(argv[i]) != "--config") continue;
+        RunConfig file;
+        if(!read_config(argv[i + 1], file)) return CLI_IO_ERROR;
+        for(const auto& entry : file){
+            if(!allowed_option(entry.first, allowed)){
+                cout << "Error: unknown option '" << entry.first << "' in '" << argv[i + 1] << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+            config[entry.first] = entry.second;
+        }
+    }
+    for(int i = 2; i < argc; i++){
+        string opt = argv[i];
+        if(opt.compare(0, 2, "--") != 0 || i + 1 >= argc){
+            cout << "Error: unexpected argument '" << opt << "'" << endl;
+            return CLI_USAGE_ERROR;
+        }
+        if(opt != "--config"){
+            if(!allowed_option(opt.substr(2), allowed)){
+                cout << "Error: unknown option '" << opt << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+            config[opt.substr(2)] = argv[i + 1];
+        }
+        i++;
+    }
+    return CLI_OK;
+}
+
+// Builds the system from m, c, k, x0, v0 (x0/v0 default to 0 when not required).
+// Returns CLI_OK or the exit code to stop with.
+static int read_system(RunConfig& config, bool need_initial_state, MassSpringDamper& s){
+    const char* names[5] = {"m", "c", "k", "x0", "v0"};
+    double p[5] = {0, 0, 0, 0, 0};
+    for(int i = 0; i < 5; i++){
+        auto it = config.find(names[i]);
+        if(it == config.end()){
+            if(i >= 3 && !need_initial_state) continue;
+            cout << "Error: missing parameter '" << names[i] << "'" << endl;
+            return CLI_USAGE_ERROR;
+        }
+        if(!parse_number(it->second, p[i])){
+            cout << "Error: '" << names[i] << "' is not a number: " << it->second << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+
+    int e[5] = {0,0,0,0,0};
+    s.validate_parameters(e, p[0], p[1], p[2], p[3], p[4]);
+    if(!(e[0]==1 && e[1]==1 && e[2]==1 && e[3]==1 && e[4]==1)){
+        print_validation_errors(e);
+        return CLI_INVALID_PARAMETERS;
+    }
+    s.set_parameters(p[0], p[1], p[2], p[3], p[4]);
+    return CLI_OK;
+}
+
+static int run_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"m", "c", "k", "x0", "v0", "solver", "output", "force", "t_end", "dt",
+                                                 "k3", "friction", "static_friction", "x_min", "x_max", "restitution",
+                                                 "out", "csv", "params", "cache", "cache_mb"});
+    if(code != CLI_OK) return code;
+
+    // --- Parameters ---
+    MassSpringDamper s;
+    code = read_system(config, true, s);
+    if(code != CLI_OK) return code;
+
+    // --- Solver and output ---
+    Solver solver = Solver::RK4;
+    if(config.count("solver") && !parse_solver(config["solver"], solver)){
+        cout << "Error: unknown solver '" << config["solver"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    OutputPolicy policy;
+    if(config.count("output") && !parse_output(config["output"], policy)){
+        cout << "Error: bad output policy '" << config["output"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    Forcing force;
+    if(config.count("force") && !parse_forcing(config["force"], force)){
+        cout << "Error: bad force '" << config["force"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    double t_end = 100 * s.get_T();
+    if(config.count("t_end") && !(parse_number(config["t_end"], t_end) && t_end > 0)){
+        cout << "Error: bad t_end '" << config["t_end"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    double dt = 0; // 0 = default_dt() / nonlinear_dt()
+    if(config.count("dt") && !(parse_number(config["dt"], dt) && dt > 0)){
+        cout << "Error: bad dt '" << config["dt"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    // Nonlinear forces: any of their options switches to simulate_nonlinear()
+    NonlinearForces forces;
+    bool nonlinear = false;
+    const char* nl_names[6] = {"k3", "friction", "static_friction", "x_min", "x_max", "restitution"};
+    double* nl_values[6] = {&forces.k3, &forces.friction, &forces.static_friction, &forces.x_min, &forces.x_max, &forces.restitution};
+    for(int i = 0; i < 6; i++){
+        if(!config.count(nl_names[i])) continue;
+        if(!parse_number(config[nl_names[i]], *nl_values[i])){
+            cout << "Error: '" << nl_names[i] << "' is not a number: " << config[nl_names[i]] << endl;
+            return CLI_USAGE_ERROR;
+        }
+        nonlinear = true;
+    }
+    if(nonlinear){
+        if(solver == Solver::RK45 || solver == Solver::Exact){
+            cout << "Error: nonlinear runs use euler, rk4 or verlet" << endl;
+            return CLI_USAGE_ERROR;
+        }
+        if(!validate_nonlinear(s, forces)) return CLI_INVALID_PARAMETERS;
+    }
+    // The fixed-step loops count steps in an int: refuse a run they would cut short.
+    if(solver != Solver::RK45 || nonlinear){
+        bool timed = nonlinear || force.type != ForceType::None || config.count("t_end");
+        double step = (dt > 0) ? dt : nonlinear ? nonlinear_dt(s, forces) : default_dt(s);
+        double steps = fixed_step_count(s, step, timed ? t_end : 0);
+        if(steps > MAX_FIXED_STEPS){
+            cout << "Error: dt = " << step << " s needs " << steps << " steps, more than a run can take ("
+                 << (long long)MAX_FIXED_STEPS << ")" << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+    string out = config.count("out") ? config["out"] : "results.msdt";
+
+    {
+        // Fail early (and with the right code) if the output can't be created.
+        ofstream probe(out, ios::binary);
+        if(!probe.is_open()){
+            cout << "Error: could not create '" << out << "'" << endl;
+            return CLI_IO_ERROR;
+        }
+    }
+
+    double cache_mb = 1024;
+    if(config.count("cache_mb") && !(parse_number(config["cache_mb"], cache_mb) && cache_mb > 0)){
+        cout << "Error: bad cache size '" << config["cache_mb"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+
+    // Without a force the stop logic decides when to end, as in the menu.
+    // Only those full-resolution free runs go through the cache.
+    bool free_run = force.type == ForceType::None && !config.count("t_end") && !nonlinear;
+    bool cached_run = config.count("cache") && free_run && policy.mode == OutputMode::EveryStep;
+    if(config.count("cache") && !cached_run){
+        cout << "Note: forced, nonlinear, t_end and decimated runs are not cached" << endl;
+    }
+
+    if(nonlinear){
+        EventStats events;
+        StepStats stats = simulate_nonlinear_to_file(s, forces, solver, &force, t_end, out, policy, &events, dt);
+        if(!stats.written) return CLI_IO_ERROR;
+        cout << "Events: " << events.impacts << " impacts, " << events.contacts << " contacts, " << events.sticks << " sticks, "
+             << events.slips << " slips, " << events.reversals << " reversals (" << events.resteps << " root-finding steps)" << endl;
+        if(stats.stop == StopReason::Settled){
+            cout << "Held at rest after " << stats.accepted << " steps" << endl;
+        }
+    } else if(cached_run){
+        ResultCache cache(config["cache"], 0, uint64_t(cache_mb*1048576));
+        CacheKey key = make_cache_key(s, solver, dt);
+        string cached;
+        if(cache.find_trajectory(key, cached)){
+            error_code ec;
+            filesystem::copy_file(cached, out, filesystem::copy_options::overwrite_existing, ec);
+            if(ec){
+                cout << "Error: could not create '" << out << "'" << endl;
+                return CLI_IO_ERROR;
+            }
+            cout << "'" << out << "' loaded from the cache" << endl;
+        } else {
+            StepStats stats = simulate_to_file(s, solver, out, policy, dt);
+            if(!stats.written) return CLI_IO_ERROR;
+            if(solver == Solver::RK45){
+                cout << "Accepted steps: " << stats.accepted << ", rejected steps: " << stats.rejected << endl;
+            }
+            cache.store_trajectory(key, out);
+        }
+        print_cache_stats(cache.stats());
+    } else {
+        StepStats stats = free_run ? simulate_to_file(s, solver, out, policy, dt)
+                                   : simulate_forced_to_file(s, solver, force, t_end, out, policy, dt);
+        if(!stats.written) return CLI_IO_ERROR;
+        if(solver == Solver::RK45){
+            cout << "Accepted steps: " << stats.accepted << ", rejected steps: " << stats.rejected << endl;
+        }
+    }
+
+    if(config.count("csv") && !export_results_csv(out, config["csv"])) return CLI_IO_ERROR;
+    if(config.count("params") && !export_parameters(s, config["params"])) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+static bool parse_precision(const string& name, Precision& precision){
+    if(name == "double") precision = Precision::Double;
+    else if(name == "single") precision = Precision::Single;
+    else if(name == "mixed") precision = Precision::Mixed;
+    else return false;
+    return true;
+}
+
+static void print_precision_report(const PrecisionReport& p, const vector<BatchResult>& results, double tolerance){
+    cout << p.single << " systems in single precision (" << fixed << setprecision(3) << p.seconds << " s)";
+    if(p.too_long) cout << ", " << p.too_long << " too long for float run in double";
+    cout << endl << defaultfloat << setprecision(3)
+         << p.flagged << " above the error tolerance " << tolerance << " (largest " << p.max_error;
+    if(p.single){
+        const MassSpringDamper& s = results[p.worst].system;
+        cout << ": m = " << s.get_m() << ", c = " << s.get_c() << ", k = " << s.get_k() << ", zeta = " << s.get_zeta();
+    }
+    cout << ")" << endl;
+    if(p.rerun) cout << p.rerun << " re-run in double (" << fixed << setprecision(3) << p.rerun_seconds << " s)" << endl;
+    cout << defaultfloat << setprecision(6);
+}
+
+// Headless parameter sweep:
+//   batch list <file> [euler|rk4|rk45|verlet|exact] [threads] [--out <file>]
+//   batch grid <m_min> <m_max> <m_n> <c_min> <c_max> <c_n> <k_min> <k_max> <k_n> <x0> <v0> [euler|rk4|rk45|verlet|exact] [threads] [--out <file>]
+// with [--cache <dir>] [--cache_mb <N>] [--precision double|single|mixed] [--tolerance <e>] anywhere
+static int batch_mode(int argc, char* argv[]){
+    // Pull the optional --out first; the rest is positional.
+    string out = "batch_results.csv", cache_dir;
+    double cache_mb = 1024;
+    PrecisionOptions precision;
+    precision.precision = Precision::Double;
+    vector<string> args;
+    for(int i = 2; i < argc; i++){
+        if(string(argv[i]) == "--out" && i + 1 < argc){ out = argv[++i]; }
+        else if(string(argv[i]) == "--cache" && i + 1 < argc){ cache_dir = argv[++i]; }
+        else if(string(argv[i]) == "--precision" && i + 1 < argc){
+            if(!parse_precision(argv[++i], precision.precision)){
+                cout << "Error: unknown precision '" << argv[i] << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+        }
+        else if(string(argv[i]) == "--tolerance" && i + 1 < argc){
+            if(!(parse_number(argv[++i], precision.tolerance) && precision.tolerance > 0)){
+                cout << "Error: bad tolerance '" << argv[i] << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+        }
+        else if(string(argv[i]) == "--cache_mb" && i + 1 < argc){
+            if(!(parse_number(argv[++i], cache_mb) && cache_mb > 0)){
+                cout << "Error: bad cache size '" << argv[i] << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+        }
+        else args.push_back(argv[i]);
+    }
+
+    vector<MassSpringDamper> systems;
+    size_t rejected = 0;
+    size_t next_arg;
+
+    if(args.size() >= 2 && args[0] == "list"){
+        ifstream probe(args[1]);
+        if(!probe.is_open()){
+            cout << "Error: could not open '" << args[1] << "'" << endl;
+            return CLI_IO_ERROR;
+        }
+        systems = read_parameter_list(args[1], &rejected);
+        next_arg = 2;
+    }
+    else if(args.size() >= 12 && args[0] == "grid"){
+        // min, max, n for m, c and k, then x0 and v0
+        double g[11];
+        for(int i = 0; i < 11; i++){
+            bool ok = (i == 2 || i == 5 || i == 8) ? parse_count(args[i + 1], 1, 1e6, g[i]) : parse_number(args[i + 1], g[i]);
+            if(!ok){
+                cout << "Error: bad grid value '" << args[i + 1] << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+        }
+        SweepRange m = { g[0], g[1], int(g[2]) };
+        SweepRange c = { g[3], g[4], int(g[5]) };
+        SweepRange k = { g[6], g[7], int(g[8]) };
+        systems = build_grid(m, c, k, g[9], g[10], &rejected);
+        next_arg = 12;
+    }
+    else{
+        print_usage(argv[0]);
+        return CLI_USAGE_ERROR;
+    }
+
+    Solver solver = Solver::RK4;
+    if(args.size() > next_arg && !parse_solver(args[next_arg], solver)){
+        cout << "Error: unknown solver '" << args[next_arg] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    double threads = 0;
+    if(args.size() > next_arg + 1 && !parse_count(args[next_arg + 1], 0, MAX_THREADS, threads)){
+        cout << "Error: bad thread count '" << args[next_arg + 1] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    if(args.size() > next_arg + 2){
+        cout << "Error: unexpected argument '" << args[next_arg + 2] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    const bool reduced = precision.precision != Precision::Double;
+    if(reduced && solver != Solver::RK4){
+        cout << "Error: single and mixed precision sweeps are rk4 only" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    if(reduced && !cache_dir.empty()){
+        cout << "Note: reduced-precision results are not cached" << endl;
+        cache_dir.clear();
+    }
+
+    cout << systems.size() << " valid systems, " << rejected << " rejected" << endl;
+    if(systems.empty()) return CLI_INVALID_PARAMETERS;
+
+    unique_ptr<ResultCache> cache;
+    if(!cache_dir.empty()) cache.reset(new ResultCache(cache_dir, systems.size(), uint64_t(cache_mb*1048576)));
+
+    auto start = chrono::steady_clock::now();
+    PrecisionReport report;
+    vector<BatchResult> results = reduced ? run_batch_precision(systems, precision, unsigned(threads), &report)
+                                          : run_batch(systems, solver, unsigned(threads), cache.get());
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Simulated in " << fixed << setprecision(3) << elapsed << " s ("
+         << setprecision(0) << results.size()/elapsed << " systems/s)" << defaultfloat << setprecision(6) << endl;
+    if(cache) print_cache_stats(cache->stats());
+    if(reduced) print_precision_report(report, results, precision.tolerance);
+    if(!export_batch_results(results, out.c_str(), reduced)) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+// Frequency response sweep: bode --m <kg> --c <N.s/m> --k <N/m> [--w_min] [--w_max] [--points]
+// [--method analytic|simulated] [--solver euler|rk4|verlet|exact] [--threads] [--out <file>]
+static int bode_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"m", "c", "k", "x0", "v0", "w_min", "w_max", "points", "method", "solver", "threads", "out"});
+    if(code != CLI_OK) return code;
+
+    MassSpringDamper s;
+    code = read_system(config, false, s);
+    if(code != CLI_OK) return code;
+
+    double w_min = s.get_wn() / 100, w_max = s.get_wn() * 100, points = 1000, threads = 0;
+    bool numbers_ok = (!config.count("w_min") || parse_number(config["w_min"], w_min))
+                   && (!config.count("w_max") || parse_number(config["w_max"], w_max))
+                   && (!config.count("points") || parse_count(config["points"], 1, 1e6, points))
+                   && (!config.count("threads") || parse_count(config["threads"], 0, MAX_THREADS, threads));
+    if(!numbers_ok || w_min <= 0 || w_max < w_min){
+        cout << "Error: bad frequency range, point count or thread count" << endl;
+        return CLI_USAGE_ERROR;
+    }
+
+    ResponseMethod method = ResponseMethod::Analytic;
+    if(config.count("method")){
+        if(config["method"] == "simulated") method = ResponseMethod::Simulated;
+        else if(config["method"] != "analytic"){
+            cout << "Error: unknown method '" << config["method"] << "'" << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+    Solver solver = Solver::RK4;
+    if(config.count("solver") && (!parse_solver(config["solver"], solver) || solver == Solver::RK45)){
+        cout << "Error: unknown sweep solver '" << config["solver"] << "' (euler, rk4, verlet or exact)" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    string out = config.count("out") ? config["out"] : "frequency_response.csv";
+
+    vector<double> omegas = log_frequencies(w_min, w_max, int(points));
+    auto start = chrono::steady_clock::now();
+    vector<FrequencyPoint> response = frequency_sweep(s, omegas, method, solver, unsigned(threads));
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << response.size() << " frequencies in " << fixed << setprecision(3) << elapsed << " s"
+         << defaultfloat << setprecision(6) << endl;
+    if(!export_frequency_response(s, response, out)) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+// Uncertainty propagation: montecarlo --m <dist> --c <dist> --k <dist> [--x0 <dist>] [--v0 <dist>]
+// [--samples N] [--seed S] [--solver euler|rk4|rk45|verlet|exact] [--threads N] [--out <file>]
+static int montecarlo_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"m", "c", "k", "x0", "v0", "samples", "seed", "solver", "threads", "out"});
+    if(code != CLI_OK) return code;
+
+    MonteCarloSpec spec;
+    const char* names[5] = {"m", "c", "k", "x0", "v0"};
+    Distribution* dists[5] = {&spec.m, &spec.c, &spec.k, &spec.xo, &spec.vo};
+    for(int i = 0; i < 5; i++){
+        if(!config.count(names[i])){
+            if(i >= 3) continue; // x0, v0 default to 0
+            cout << "Error: missing parameter '" << names[i] << "'" << endl;
+            return CLI_USAGE_ERROR;
+        }
+        if(!parse_distribution(config[names[i]], *dists[i])){
+            cout << "Error: bad distribution for '" << names[i] << "': " << config[names[i]] << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+    auto always_zero = [](const Distribution& d){ return d.type == DistributionType::Fixed && d.a == 0; };
+    if(always_zero(spec.xo) && always_zero(spec.vo)){
+        cout << "Error: montecarlo needs a nonzero --x0 or --v0 (from rest the free response is zero)" << endl;
+        return CLI_USAGE_ERROR;
+    }
+
+    double samples = double(spec.samples), threads = 0;
+    bool numbers_ok = (!config.count("samples") || parse_count(config["samples"], 1, 1e12, samples))
+                   && (!config.count("seed") || parse_u64(config["seed"], spec.seed))
+                   && (!config.count("threads") || parse_count(config["threads"], 0, MAX_THREADS, threads));
+    if(!numbers_ok){
+        cout << "Error: bad sample count, seed (a whole number, 0 to 2^64-1) or thread count" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    spec.samples = size_t(samples);
+    if(config.count("solver") && !parse_solver(config["solver"], spec.solver)){
+        cout << "Error: unknown solver '" << config["solver"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    string out = config.count("out") ? config["out"] : "monte_carlo.csv";
+
+    auto start = chrono::steady_clock::now();
+    MonteCarloResult result = run_monte_carlo(spec, unsigned(threads));
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << result.accepted << " samples simulated, " << result.rejected << " rejected, in "
+         << fixed << setprecision(3) << elapsed << " s" << defaultfloat << setprecision(6) << endl;
+    if(result.accepted == 0) return CLI_INVALID_PARAMETERS;
+    // Dropped samples truncate the distributions: the statistics are no longer those of the given tolerances.
+    double rejected_share = double(result.rejected)/double(spec.samples);
+    if(rejected_share > 0.5){
+        cout << "Error: " << 100*rejected_share << "% of the samples are outside the valid parameter ranges; "
+             << "narrow the distributions" << endl;
+        return CLI_INVALID_PARAMETERS;
+    }
+    if(rejected_share > 0.01){
+        cout << "Warning: " << 100*rejected_share << "% of the samples were dropped as invalid; "
+             << "the statistics describe the truncated distributions" << endl;
+    }
+    cout << "Settling time: " << result.settling_time.mean << " +- " << result.settling_time.stddev() << " s" << endl;
+    cout << "Overshoot:     " << result.overshoot.mean << " +- " << result.overshoot.stddev() << " %" << endl;
+    cout << "Peak:          " << result.peak.mean << " +- " << result.peak.stddev() << " m" << endl;
+    if(!export_monte_carlo(result, out)) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+// Parameter identification: fit --data <file> --m <kg> [--starts N] [--threads N] [--out <file>]
+static int fit_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"data", "m", "starts", "threads", "out"});
+    if(code != CLI_OK) return code;
+
+    if(!config.count("data") || !config.count("m")){
+        cout << "Error: fit needs --data <file> and --m <kg>" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    double m = 0, starts = 8, threads = 0;
+    bool numbers_ok = parse_number(config["m"], m)
+                   && (!config.count("starts") || parse_count(config["starts"], 1, 1e6, starts))
+                   && (!config.count("threads") || parse_count(config["threads"], 0, MAX_THREADS, threads));
+    if(!numbers_ok){
+        cout << "Error: bad mass, start count or thread count" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    if(!(m >= 1e-6 && m <= 1e3)){
+        cout << "(INVALID PARAMETER) Be aware: 1e-6 <= m <= 1e+3" << endl;
+        return CLI_INVALID_PARAMETERS;
+    }
+    string out = config.count("out") ? config["out"] : "fit_results.csv";
+
+    Measurement data;
+    if(!read_measurement(config["data"], data)) return CLI_IO_ERROR;
+
+    FitOptions opt;
+    opt.starts = int(starts);
+    opt.threads = unsigned(threads);
+    vector<FitResult> all;
+    auto start = chrono::steady_clock::now();
+    FitResult best = fit_parameters(data, m, opt, &all);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << data.t.size() << " samples, " << all.size() << " starts, fitted in "
+         << fixed << setprecision(3) << elapsed << " s" << defaultfloat << setprecision(6) << endl;
+    cout << "c = " << best.c << " +- " << best.c_error << " N.s/m" << endl;
+    cout << "k = " << best.k << " +- " << best.k_error << " N/m" << endl;
+    cout << "RMS residual: " << best.rms << " m (" << best.iterations << " iterations"
+         << (best.converged ? "" : ", not converged") << ")" << endl;
+    if(!export_fit_results(best, all, out)) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+// Real-time soak test: soak --m --c --k --x0 --v0 [--solver] [--force <spec>] [--rate Hz]
+// [--duration s] [--report s] [--budget_us us] [--out <file>]
+static int soak_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"m", "c", "k", "x0", "v0", "solver", "force", "rate", "duration", "report", "budget_us", "out"});
+    if(code != CLI_OK) return code;
+
+    MassSpringDamper s;
+    code = read_system(config, true, s);
+    if(code != CLI_OK) return code;
+
+    Solver solver = Solver::RK4;
+    if(config.count("solver") && (!parse_solver(config["solver"], solver) || solver == Solver::RK45)){
+        cout << "Error: soak needs a fixed-step solver (euler, rk4, verlet or exact)" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    Forcing force;
+    if(config.count("force") && !parse_forcing(config["force"], force)){
+        cout << "Error: bad force '" << config["force"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    SoakOptions opts;
+    bool numbers_ok = (!config.count("rate") || parse_number(config["rate"], opts.rate))
+                   && (!config.count("duration") || parse_number(config["duration"], opts.duration))
+                   && (!config.count("report") || parse_number(config["report"], opts.report_every))
+                   && (!config.count("budget_us") || parse_number(config["budget_us"], opts.budget_us));
+    if(!numbers_ok || opts.rate < 0 || opts.duration <= 0 || opts.report_every < 0 || opts.budget_us < 0){
+        cout << "Error: bad rate, duration, report interval or budget" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    if(opts.rate > 1e9){
+        cout << "Error: --rate " << opts.rate << " needs a period under 1 ns; the most is 1e9 steps/s" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    string out = config.count("out") ? config["out"] : "soak_latency.csv";
+
+    RealTimeStepper stepper(s, solver);
+    SoakResult result = soak_test(stepper, opts, (force.type == ForceType::None) ? nullptr : &force);
+    print_soak_report(stepper, result);
+    if(!export_latency_histogram(stepper.latency(), stepper.jitter(), out)) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+// Parallel-in-time run: parareal --m --c --k --x0 --v0 [--t_end s] [--force <spec>] [--coarse exact|euler]
+// [--coarse_ratio N] [--slices N] [--iterations N] [--tol r] [--serial yes|no] [--threads N] [--out <file>]
+static int parareal_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"m", "c", "k", "x0", "v0", "t_end", "force", "coarse", "coarse_ratio",
+                                                 "slices", "iterations", "tol", "serial", "threads", "out"});
+    if(code != CLI_OK) return code;
+
+    MassSpringDamper s;
+    code = read_system(config, true, s);
+    if(code != CLI_OK) return code;
+
+    Forcing force;
+    if(config.count("force") && !parse_forcing(config["force"], force)){
+        cout << "Error: bad force '" << config["force"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    PararealOptions opt;
+    if(config.count("coarse")){
+        if(config["coarse"] == "euler") opt.coarse = CoarseMethod::Euler;
+        else if(config["coarse"] != "exact"){
+            cout << "Error: unknown coarse propagator '" << config["coarse"] << "' (exact or euler)" << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+    if(config.count("serial")){
+        if(config["serial"] == "no") opt.serial_reference = false;
+        else if(config["serial"] != "yes"){
+            cout << "Error: --serial takes yes or no" << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+    double t_end = 100000 * s.get_T(), ratio = 0, slices = 0, iterations = 0, threads = 0;
+    bool numbers_ok = (!config.count("t_end") || parse_number(config["t_end"], t_end))
+                   && (!config.count("coarse_ratio") || parse_count(config["coarse_ratio"], 0, INT_MAX, ratio))
+                   && (!config.count("slices") || parse_count(config["slices"], 0, INT_MAX, slices))
+                   && (!config.count("iterations") || parse_count(config["iterations"], 0, INT_MAX, iterations))
+                   && (!config.count("tol") || parse_number(config["tol"], opt.tolerance))
+                   && (!config.count("threads") || parse_count(config["threads"], 0, MAX_THREADS, threads));
+    if(!numbers_ok || !(t_end > 0) || !isfinite(t_end) || !(opt.tolerance >= 0)){
+        cout << "Error: bad t_end, coarse ratio, slice or iteration count, tolerance or thread count" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    opt.coarse_ratio = int(ratio);
+    opt.slices = int(slices);
+    opt.max_iterations = int(iterations);
+    opt.threads = unsigned(threads);
+    string out = config.count("out") ? config["out"] : "parareal_results.csv";
+
+    PararealResult result = parareal(s, (force.type == ForceType::None) ? nullptr : &force, t_end, opt);
+
+    cout << result.steps << " steps in " << (result.t.size() - 1) << " slices, " << result.iterations << " iterations"
+         << (result.converged ? "" : result.serial_fallback ? " (not converged, fell back to serial)" : " (not converged)")
+         << ", " << result.fine_steps << " fine steps taken" << endl;
+    cout << scientific << setprecision(3);
+    for(size_t i = 0; i < result.corrections.size(); i++){
+        cout << "  iteration " << (i + 1) << ": largest correction " << result.corrections[i] << endl;
+    }
+    cout << fixed << setprecision(3) << "Parareal: " << result.seconds << " s";
+    if(opt.serial_reference){
+        cout << ", serial rk4: " << result.serial_seconds << " s, speedup " << setprecision(2) << result.speedup << "x" << endl;
+        cout << scientific << setprecision(3) << "Largest deviation from the serial run: " << result.max_deviation << " m";
+    }
+    cout << defaultfloat << setprecision(6) << endl;
+    if(!export_parareal(result, out)) return CLI_IO_ERROR;
+    return CLI_OK;
+}
+
+// Set by SIGINT / SIGTERM to end serve_mode().
+static volatile sig_atomic_t serve_interrupted = 0;
+static void on_serve_signal(int){ serve_interrupted = 1; }
+
+static void print_server_stats(const ServerStats& st){
+    cout << fixed << setprecision(0) << st.requests << " requests, " << st.completed << " answered ("
+         << (st.seconds > 0 ? st.completed/st.seconds : 0) << "/s), queue " << st.queued << ", in flight " << st.in_flight
+         << ", " << st.batches << " batches (" << setprecision(1) << (st.batches > 0 ? st.batched/st.batches : 0)
+         << " per batch), " << setprecision(0) << st.samples << " samples streamed" << defaultfloat << setprecision(6) << endl;
+}
+
+// Simulation server: serve [--socket <path>] [--threads N] [--batch_max N] [--batch_window_us us] [--report s]
+static int serve_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"socket", "threads", "batch_max", "batch_window_us", "report"});
+    if(code != CLI_OK) return code;
+
+    ServerOptions opt;
+    if(config.count("socket")) opt.socket_path = config["socket"];
+    double threads = 0, batch_max = double(opt.batch_max), report = 10;
+    bool numbers_ok = (!config.count("threads") || parse_count(config["threads"], 0, MAX_THREADS, threads))
+                   && (!config.count("batch_max") || parse_count(config["batch_max"], 1, 1e6, batch_max))
+                   && (!config.count("batch_window_us") || parse_number(config["batch_window_us"], opt.batch_window_us))
+                   && (!config.count("report") || parse_number(config["report"], report));
+    if(!numbers_ok || opt.batch_window_us < 0 || report < 0){
+        cout << "Error: bad thread count, batch size, batch window or report interval" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    opt.threads = unsigned(threads);
+    opt.batch_max = size_t(batch_max);
+
+    SimulationServer server(opt);
+    if(!server.start()) return CLI_IO_ERROR;
+    cout << "Listening on '" << opt.socket_path << "' (Ctrl+C to stop)" << endl;
+
+    serve_interrupted = 0;
+    signal(SIGINT, on_serve_signal);
+    signal(SIGTERM, on_serve_signal);
+    auto next_report = chrono::steady_clock::now() + chrono::duration<double>(report);
+    while(!serve_interrupted){
+        this_thread::sleep_for(chrono::milliseconds(100));
+        if(report > 0 && chrono::steady_clock::now() >= next_report){
+            print_server_stats(server.stats());
+            next_report += chrono::duration<double>(report);
+        }
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    server.stop();
+    print_server_stats(server.stats());
+    return CLI_OK;
+}
+
+// One request to a running server: request [--socket <path>] [--kind summary|trajectory|stats]
+// [--m --c --k --x0 --v0] [--solver] [--dt] [--output] [--out <file>]
+static int request_mode(int argc, char* argv[]){
+    RunConfig config;
+    int code = read_options(argc, argv, config, {"m", "c", "k", "x0", "v0", "socket", "kind", "solver", "dt", "output", "out"});
+    if(code != CLI_OK) return code;
+
+    string socket_path = config.count("socket") ? config["socket"] : "msd.sock";
+    string kind = config.count("kind") ? config["kind"] : "summary";
+    if(kind != "summary" && kind != "trajectory" && kind != "stats"){
+        cout << "Error: unknown request kind '" << kind << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+
+    ServerClient client;
+    if(kind == "stats"){
+        ServerStats st;
+        if(!client.connect(socket_path) || !client.stats(st)) return CLI_IO_ERROR;
+        print_server_stats(st);
+        return CLI_OK;
+    }
+
+    MassSpringDamper s;
+    code = read_system(config, true, s);
+    if(code != CLI_OK) return code;
+    Solver solver = Solver::RK4;
+    if(config.count("solver") && !parse_solver(config["solver"], solver)){
+        cout << "Error: unknown solver '" << config["solver"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    OutputPolicy policy;
+    if(config.count("output") && !parse_output(config["output"], policy)){
+        cout << "Error: bad output policy '" << config["output"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    double dt = 0;
+    if(config.count("dt") && !(parse_number(config["dt"], dt) && dt > 0)){
+        cout << "Error: bad dt '" << config["dt"] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    if(!client.connect(socket_path)) return CLI_IO_ERROR;
+
+    ReplyStatus status = ReplyStatus::Ok;
+    if(kind == "summary"){
+        SimSummary sum;
+        if(!client.summary(s, solver, sum, &status)){
+            cout << "Error: the server " << (status == ReplyStatus::Ok ? "did not answer" : "rejected the request") << endl;
+            return (status == ReplyStatus::InvalidParameters) ? CLI_INVALID_PARAMETERS : CLI_IO_ERROR;
+        }
+        cout << "Peak: " << sum.peak << " m, settling time: " << sum.settling_time << " s, final amplitude: "
+             << sum.final_amplitude << " m, " << sum.steps << " steps" << endl;
+        return CLI_OK;
+    }
+
+    string out = config.count("out") ? config["out"] : "results.msdt";
+    StepStats stats;
+    bool ok;
+    {
+        BinaryStreamWriter file(out);
+        if(!file.is_open()) return CLI_IO_ERROR;
+        ok = client.trajectory(s, solver, policy, dt, file, &stats, &status);
+        file.close();
+        if(ok && !file.ok()) return CLI_IO_ERROR;
+    }
+    if(!ok){
+        cout << "Error: the server " << (status == ReplyStatus::Ok ? "did not answer" : "rejected the request") << endl;
+        return (status == ReplyStatus::InvalidParameters) ? CLI_INVALID_PARAMETERS : CLI_IO_ERROR;
+    }
+    cout << stats.accepted << " steps streamed to '" << out << "'" << endl;
+    return CLI_OK;
+}
+
+// Headless N-DOF run:
+//   network chain <n> <m> <k> <c> <x0> <t_end> [euler|rk4] [threads] [--out <file>] [--probes <i,j,...>] [--every <N>]
+//   network mesh <rows> <cols> <m> <k> <c> <x0> <t_end> [...]
+//   network file <file> <t_end> [...]
+static int network_mode(int argc, char* argv[]){
+    string out = "network_results.csv";
+    string probe_list;
+    double every = 1;
+    vector<string> args;
+    for(int i = 2; i < argc; i++){
+        string opt = argv[i];
+        if(opt == "--out" && i + 1 < argc) out = argv[++i];
+        else if(opt == "--probes" && i + 1 < argc) probe_list = argv[++i];
+        else if(opt == "--every" && i + 1 < argc){
+            if(!parse_count(argv[++i], 1, INT_MAX, every)){
+                cout << "Error: --every needs a whole number >= 1, not '" << argv[i] << "'" << endl;
+                return CLI_USAGE_ERROR;
+            }
+        }
+        else args.push_back(opt);
+    }
+
+    // Mass counts (chain length, mesh rows and columns), then the real values
+    const double MAX_MASSES = 1e8;
+    size_t counts = 0, values = 0;
+    if(args.size() >= 7 && args[0] == "chain"){ counts = 1; values = 5; }
+    else if(args.size() >= 8 && args[0] == "mesh"){ counts = 2; values = 5; }
+    else if(args.size() >= 3 && args[0] == "file"){ counts = 0; values = 1; }
+    else{
+        print_usage(argv[0]);
+        return CLI_USAGE_ERROR;
+    }
+    size_t first = (args[0] == "file") ? 2 : 1;
+    double g[7];
+    for(size_t i = 0; i < counts + values; i++){
+        const string& text = args[first + i];
+        if(i < counts ? !parse_count(text, 0, MAX_MASSES, g[i]) : !parse_number(text, g[i])){
+            cout << "Error: bad network " << (i < counts ? "mass count" : "value") << " '" << text << "'" << endl;
+            return CLI_USAGE_ERROR;
+        }
+    }
+
+    SpringNetwork net;
+    double t_end = g[counts + values - 1];
+    size_t next_arg = first + counts + values;
+    bool built;
+
+    if(args[0] == "chain"){
+        size_t n = size_t(g[0]);
+        built = build_chain(net, n, g[1], g[2], g[3], true);
+        if(built && n > 0) net.x[0] = g[4];
+    }
+    else if(args[0] == "mesh"){
+        size_t rows = size_t(g[0]), cols = size_t(g[1]);
+        if(g[0]*g[1] > MAX_MASSES){
+            cout << "Error: a " << rows << " x " << cols << " mesh has more than " << MAX_MASSES << " masses" << endl;
+            return CLI_USAGE_ERROR;
+        }
+        built = build_mesh(net, rows, cols, g[2], g[3], g[4]);
+        if(built && rows*cols > 0) net.x[0] = g[5];
+    }
+    else{
+        ifstream probe(args[1]);
+        if(!probe.is_open()){
+            cout << "Error: could not open '" << args[1] << "'" << endl;
+            return CLI_IO_ERROR;
+        }
+        built = read_network(args[1], net);
+    }
+    if(!built || net.size() == 0 || !(t_end > 0)){
+        if(built) cout << "Error: the network needs at least one mass and t_end > 0" << endl;
+        return CLI_INVALID_PARAMETERS;
+    }
+
+    Solver solver = Solver::RK4;
+    if(args.size() > next_arg && (!parse_solver(args[next_arg], solver) || (solver != Solver::Euler && solver != Solver::RK4))){
+        cout << "Error: unknown network solver '" << args[next_arg] << "' (euler or rk4)" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    double threads = 0;
+    if(args.size() > next_arg + 1 && !parse_count(args[next_arg + 1], 0, MAX_THREADS, threads)){
+        cout << "Error: bad thread count '" << args[next_arg + 1] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+    if(args.size() > next_arg + 2){
+        cout << "Error: unexpected argument '" << args[next_arg + 2] << "'" << endl;
+        return CLI_USAGE_ERROR;
+    }
+
+    vector<int> probes;
+    if(probe_list.empty()){
+        probes = {0, int(net.size()/2), int(net.size() - 1)};
+        probes.erase(unique(probes.begin(), probes.end()), probes.end());
+    } else {
+        for(char& ch : probe_list){ if(ch == ',') ch = ' '; }
+        istringstream in(probe_list);
+        string item;
+        while(in >> item){
+            double p;
+            if(!parse_count(item, 0, double(net.size()) - 1, p)){
+                cout << "Error: probe '" << item << "' is not a mass of the network" << endl;
+                return CLI_USAGE_ERROR;
+            }
+            probes.push_back(int(p));
+        }
+    }
+
+    NetworkCsvWriter writer(out, probes, int(every));
+    if(!writer.is_open()) return CLI_IO_ERROR;
+
+    cout << net.size() << " masses, " << net.spring_count() << " springs, dt = " << net.stable_dt() << " s" << endl;
+    double e0 = net.energy();
+    auto start = chrono::steady_clock::now();
+    simulate_network(net, solver, t_end, &writer, unsigned(threads));
+    if(!writer.ok()) return CLI_IO_ERROR;
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double steps = max(1.0, double(llround(t_end/net.stable_dt())));
+    cout << "Simulated in " << fixed << setprecision(3) << elapsed << " s ("
+         << setprecision(1) << 1e9*elapsed/steps << " ns/step)" << defaultfloat << setprecision(6) << endl;
+    cout << "Energy: " << e0 << " J -> " << net.energy() << " J" << endl;
+    return CLI_OK;
+}
+
+// Runs one command. Returns -1 if argv[1] is not one.
+static int run_command(const string& cmd, int argc, char* argv[]){
+    if(cmd == "run") return run_mode(argc, argv);
+    if(cmd == "batch" || cmd == "--batch") return batch_mode(argc, argv);
+    if(cmd == "network") return network_mode(argc, argv);
+    if(cmd == "bode") return bode_mode(argc, argv);
+    if(cmd == "montecarlo") return montecarlo_mode(argc, argv);
+    if(cmd == "fit") return fit_mode(argc, argv);
+    if(cmd == "soak") return soak_mode(argc, argv);
+    if(cmd == "parareal") return parareal_mode(argc, argv);
+    if(cmd == "serve") return serve_mode(argc, argv);
+    if(cmd == "request") return request_mode(argc, argv);
+    return -1;
+}
+
+int run_cli(int argc, char* argv[]){
+    string cmd = (argc > 1) ? argv[1] : "";
+
+    // --trace is taken out here, so every command accepts it.
+    string trace_file;
+    vector<char*> args;
+    for(int i = 0; i < argc; i++){
+        if(i > 1 && string(argv[i]) == "--trace" && i + 1 < argc){
+            if(!TRACE_ENABLED){
+                cout << "Error: --trace needs a build with tracing (cmake -DMSD_TRACE=ON)" << endl;
+                return CLI_USAGE_ERROR;
+            }
+            trace_file = argv[++i];
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    args.push_back(nullptr);
+
+    MSD_TRACE_THREAD("main", -1);
+    int code = run_command(cmd, int(args.size()) - 1, args.data());
+    if(code >= 0){
+        if(TRACE_ENABLED){
+            cout << trace_summary() << endl;
+            if(!trace_file.empty() && !export_trace(trace_file) && code == CLI_OK) code = CLI_IO_ERROR;
+            trace_reset();
+        }
+        return code;
+    }
+    if(cmd == "--help" || cmd == "-h"){
+        print_usage(argv[0]);
+        return CLI_OK;
+    }
+    cout << "Error: unknown command '" << cmd << "'" << endl;
+    print_usage(argv[0]);
+    return CLI_USAGE_ERROR;
+}
@@ -0,0 +1,137 @@
+#include "Forcing.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>    // std::upper_bound
+#include <cmath>
+#include <cstdlib>      // For strtod
+
+using namespace std;
+
+double Forcing::value(double time) const{
+    switch(type){
+        case ForceType::Harmonic:
+            return amplitude * sin(omega*time + phase);
+        case ForceType::Step:
+            return (time >= t0) ? amplitude : 0.0;
+        case ForceType::Sampled: {
+            if(t.empty() || time < t.front() || time > t.back()) return 0.0;
+            // First sample after 'time'; the one before it starts the segment.
+            size_t hi = size_t(upper_bound(t.begin(), t.end(), time) - t.begin());
+            if(hi >= t.size()) return f.back();
+            size_t lo = hi - 1;
+            double w = (time - t[lo]) / (t[hi] - t[lo]);
+            return f[lo] + w*(f[hi] - f[lo]);
+        }
+        default:
+            return 0.0;
+    }
+}
+
+Forcing harmonic_force(double amplitude, double omega, double phase){
+    Forcing force;
+    force.type = ForceType::Harmonic;
+    force.amplitude = amplitude;
+    force.omega = omega;
+    force.phase = phase;
+    return force;
+}
+
+Forcing step_force(double amplitude, double t0){
+    Forcing force;
+    force.type = ForceType::Step;
+    force.amplitude = amplitude;
+    force.t0 = t0;
+    return force;
+}
+
+Forcing impulse_force(double impulse, double t0){
+    Forcing force;
+    force.type = ForceType::Impulse;
+    force.amplitude = impulse;
+    force.t0 = t0;
+    return force;
+}
+
+bool read_force_samples(const string& filename, Forcing& force){
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not open '" << filename << "'" << endl;
+        return false;
+    }
+
+    Forcing sampled;
+    sampled.type = ForceType::Sampled;
+    string line;
+    bool first_line = true;
+    while(getline(file, line)){
+        if(line.empty() || line[0] == '#') continue;
+        for(char& ch : line){ if(ch == ',' || ch == ';') ch = ' '; }
+
+        istringstream in(line);
+        double t_, f_;
+        if(!(in >> t_ >> f_)){
+            if(!first_line){
+                cout << "Error: '" << filename << "' has a malformed line: " << line << endl;
+                return false;
+            }
+            first_line = false; // The first line may be a header
+            continue;
+        }
+        first_line = false;
+        if(!sampled.t.empty() && t_ <= sampled.t.back()){
+            cout << "Error: '" << filename << "' times must increase (" << t_ << " after " << sampled.t.back() << ")" << endl;
+            return false;
+        }
+        sampled.t.push_back(t_);
+        sampled.f.push_back(f_);
+    }
+    if(sampled.t.size() < 2){
+        cout << "Error: '" << filename << "' needs at least two samples" << endl;
+        return false;
+    }
+    force = sampled;
+    return true;
+}
+
+bool parse_forcing(const string& spec, Forcing& force){
+    // Split on ':'
+    vector<string> parts;
+    size_t start = 0;
+    while(true){
+        size_t colon = spec.find(':', start);
+        parts.push_back(spec.substr(start, colon - start));
+        if(colon == string::npos) break;
+        start = colon + 1;
+    }
+    const string& kind = parts[0];
+    if(kind == "sampled" && parts.size() >= 2){
+        // The file name may itself contain ':' (e.g. a Windows drive letter)
+        return read_force_samples(spec.substr(spec.find(':') + 1), force);
+    }
+
+    // Each field after the kind must parse completely as a finite number ("abc" or "2x" is an error, not 0)
+    vector<double> values;
+    for(size_t i = 1; i < parts.size(); i++){
+        const char* text = parts[i].c_str();
+        char* end = nullptr;
+        double value = strtod(text, &end);
+        if(end == text || *end != '\0' || !isfinite(value)) return false;
+        values.push_back(value);
+    }
+    auto number = [&](size_t i){ return (values.size() >= i) ? values[i - 1] : 0.0; };
+
+    if(kind == "harmonic" && values.size() >= 2 && values.size() <= 3){
+        force = harmonic_force(number(1), number(2), number(3));
+        return force.omega > 0;
+    }
+    if(kind == "step" && values.size() >= 1 && values.size() <= 2){
+        force = step_force(number(1), number(2));
+        return force.t0 >= 0;
+    }
+    if(kind == "impulse" && values.size() >= 1 && values.size() <= 2){
+        force = impulse_force(number(1), number(2));
+        return force.t0 >= 0;
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#include "FrequencyResponse.h"
+#include "Forcing.h"
+#include "Trajectory.h"     // For TrajectorySink
+#include "ThreadPool.h"
+#include "constants.h"      // For 'pi'
+#include <cmath>
+#include <algorithm>    // std::min, std::max
+
+using namespace std;
+
+// Points per task. Analytic points cost a few ns, so they go in large chunks;
+// a simulated point is a whole run, so each one is its own task.
+static const size_t ANALYTIC_GRAIN = 4096;
+static const size_t SIMULATED_GRAIN = 1;
+
+static const int RESPONSE_PERIODS = 8;          // Forcing periods correlated
+static const int MIN_STEPS_PER_PERIOD = 64;
+static const double MAX_TRANSIENT_PERIODS = 2000; // Cap of the wait, in natural periods
+
+FrequencyPoint transfer_function(const MassSpringDamper& s, double omega){
+    double re = s.get_k() - s.get_m()*omega*omega;
+    double im = s.get_c()*omega;
+    FrequencyPoint p;
+    p.omega = omega;
+    p.amplitude = 1.0 / sqrt(re*re + im*im);
+    p.phase = -atan2(im, re);
+    return p;
+}
+
+// Correlates x(t) with sin(wt) and cos(wt) (trapezoidal rule) from t_start on.
+class Correlator : public TrajectorySink{
+private:
+    double omega, t_start, t_prev = 0, fs_prev = 0, fc_prev = 0;
+    bool started = false;
+
+public:
+    double sum_sin = 0, sum_cos = 0, span = 0;
+
+    Correlator(double omega_, double t_start_) : omega(omega_), t_start(t_start_) {}
+
+    void write(double t, double x, double v, double a) override {
+        (void)v; (void)a;
+        if(t < t_start) return;
+        double fs = x*sin(omega*t), fc = x*cos(omega*t);
+        if(started){
+            double h = t - t_prev;
+            sum_sin += 0.5*h*(fs + fs_prev);
+            sum_cos += 0.5*h*(fc + fc_prev);
+            span += h;
+        }
+        started = true;
+        t_prev = t;
+        fs_prev = fs;
+        fc_prev = fc;
+    }
+};
+
+FrequencyPoint simulated_response(const MassSpringDamper& s, double omega, Solver solver){
+    if(solver == Solver::RK45) solver = Solver::RK4;
+
+    // Slowest decay rate of the free response (overdamped: the slow real pole).
+    const double zeta = s.get_zeta(), wn = s.get_wn();
+    const double sigma = (zeta < 1) ? zeta*wn : wn*(zeta - sqrt(zeta*zeta - 1));
+
+    const double period = 2*pi/omega;
+    double transient = min(8/sigma, MAX_TRANSIENT_PERIODS*s.get_T()); // e^-8 left
+    int steps_per_period = max(MIN_STEPS_PER_PERIOD, int(ceil(period / min(0.1 / s.get_wn(), 0.01))));
+    double dt = period / steps_per_period;
+
+    // Whole periods, so both the start and the end fall on a step.
+    double t_start = ceil(transient/period)*period;
+    double t_end = t_start + RESPONSE_PERIODS*period;
+
+    MassSpringDamper rest;
+    rest.set_parameters(s.get_m(), s.get_c(), s.get_k(), 0, 0);
+    Correlator corr(omega, t_start - dt/2);
+    simulate_forced(rest, solver, harmonic_force(1.0, omega), t_end, corr, dt);
+
+    // x = X sin(wt + phi) -> (2/span) * integral of x*sin = X cos(phi), x*cos = X sin(phi)
+    double a = 2*corr.sum_sin/corr.span, b = 2*corr.sum_cos/corr.span;
+    FrequencyPoint p;
+    p.omega = omega;
+    p.amplitude = sqrt(a*a + b*b);
+    p.phase = atan2(b, a);
+    return p;
+}
+
+vector<double> log_frequencies(double w_min, double w_max, int n){
+    vector<double> omegas;
+    if(n <= 0 || w_min <= 0 || w_max <= 0) return omegas;
+    omegas.reserve(n);
+    double lo = log(w_min), hi = log(w_max);
+    for(int i = 0; i < n; i++){
+        omegas.push_back((n == 1) ? w_min : exp(lo + (hi - lo)*i/(n - 1)));
+    }
+    return omegas;
+}
+
+vector<FrequencyPoint> frequency_sweep(const MassSpringDamper& s, const vector<double>& omegas, ResponseMethod method,
+                                       Solver solver, unsigned threads){
+    vector<FrequencyPoint> points(omegas.size());
+    ThreadPool pool(threads);
+
+    // Each task writes a disjoint slice of 'points', so no locking is needed.
+    size_t grain = (method == ResponseMethod::Analytic) ? ANALYTIC_GRAIN : SIMULATED_GRAIN;
+    pool.parallel_for(omegas.size(), grain, [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; i++){
+            points[i] = (method == ResponseMethod::Analytic) ? transfer_function(s, omegas[i])
+                                                             : simulated_response(s, omegas[i], solver);
+        }
+    });
+    return points;
+}
@@ -0,0 +1,342 @@
+#include "Identification.h"
+#include "ThreadPool.h"
+#include "constants.h"      // For 'pi'
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstdlib>      // For strtod
+#include <algorithm>    // std::min, std::max
+
+using namespace std;
+
+// Bounds of the search: the validation limits of c and k, and the largest
+// log-parameter change accepted in one iteration (a factor of e^2).
+static const double C_MAX = 1e5, K_MAX = 1e7, K_MIN = 1e-12;
+static const double MAX_LOG_STEP = 2.0;
+
+bool read_measurement(const string& filename, Measurement& data){
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not open '" << filename << "'" << endl;
+        return false;
+    }
+
+    Measurement log;
+    string line;
+    bool first_line = true, has_velocity = false;
+    while(getline(file, line)){
+        if(line.empty() || line[0] == '#') continue;
+        // strtod instead of a stream: a 10^6-line log reads in well under a second
+        const char* p = line.c_str();
+        char* end;
+        double value[3];
+        int n = 0;
+        while(n < 3){
+            value[n] = strtod(p, &end);
+            if(end == p) break;
+            n++;
+            p = end;
+            while(*p == ',' || *p == ';' || *p == ' ' || *p == '\t') p++;
+        }
+        if(n < 2){
+            if(!first_line){
+                cout << "Error: '" << filename << "' has a malformed line: " << line << endl;
+                return false;
+            }
+            first_line = false; // The first line may be a header
+            continue;
+        }
+        if(!log.t.empty() && value[0] <= log.t.back()){
+            cout << "Error: '" << filename << "' times must increase (" << value[0] << " after " << log.t.back() << ")" << endl;
+            return false;
+        }
+        if(log.t.empty() && n == 3){
+            has_velocity = true;
+            log.v0 = value[2];
+        }
+        first_line = false;
+        log.t.push_back(value[0]);
+        log.x.push_back(value[1]);
+    }
+    if(log.t.size() < 3){
+        cout << "Error: '" << filename << "' needs at least three samples" << endl;
+        return false;
+    }
+    if(!has_velocity) log.v0 = (log.x[1] - log.x[0]) / (log.t[1] - log.t[0]);
+    data = log;
+    return true;
+}
+
+// Fitted parameters: ln c, ln k (so c and k stay positive), x0 and v0. The
+// initial state is fitted too: a velocity differenced from noisy samples is
+// far too rough to start the model from.
+static const int NP = 4;
+
+// State and sensitivities: x, v, dx/dc, dv/dc, dx/dk, dv/dk.
+struct SensState{
+    double x, v, xc, vc, xk, vk;
+};
+
+// m x'' + c x' + k x = 0, differentiated with respect to c and to k.
+static inline SensState sens_derivative(const SensState& s, double m, double c, double k){
+    SensState d;
+    d.x = s.v;
+    d.v = -(c*s.v + k*s.x) / m;
+    d.xc = s.vc;
+    d.vc = -(s.v + c*s.vc + k*s.xc) / m;
+    d.xk = s.vk;
+    d.vk = -(s.x + c*s.vk + k*s.xk) / m;
+    return d;
+}
+
+static inline SensState axpy(const SensState& s, double h, const SensState& d){
+    return { s.x + h*d.x, s.v + h*d.v, s.xc + h*d.xc, s.vc + h*d.vc, s.xk + h*d.xk, s.vk + h*d.vk };
+}
+
+static SensState rk4_sens_step(const SensState& s, double h, double m, double c, double k){
+    SensState k1 = sens_derivative(s, m, c, k);
+    SensState k2 = sens_derivative(axpy(s, h/2, k1), m, c, k);
+    SensState k3 = sens_derivative(axpy(s, h/2, k2), m, c, k);
+    SensState k4 = sens_derivative(axpy(s, h, k3), m, c, k);
+    return { s.x  + h/6*(k1.x  + 2*k2.x  + 2*k3.x  + k4.x),
+             s.v  + h/6*(k1.v  + 2*k2.v  + 2*k3.v  + k4.v),
+             s.xc + h/6*(k1.xc + 2*k2.xc + 2*k3.xc + k4.xc),
+             s.vc + h/6*(k1.vc + 2*k2.vc + 2*k3.vc + k4.vc),
+             s.xk + h/6*(k1.xk + 2*k2.xk + 2*k3.xk + k4.xk),
+             s.vk + h/6*(k1.vk + 2*k2.vk + 2*k3.vk + k4.vk) };
+}
+
+// The model is linear, so the RK4 steps over one sampling interval are a fixed
+// linear map of (state, sensitivities):
+//   y <- phi*y,  s_c <- phi*s_c + qc*y,  s_k <- phi*s_k + qk*y
+// Its columns come from stepping the two unit states through rk4_sens_step.
+struct IntervalMap{
+    double phi[2][2], qc[2][2], qk[2][2];
+};
+
+static IntervalMap interval_map(double span, double h_max, double m, double c, double k){
+    IntervalMap map;
+    int n = int(ceil(span / h_max));
+    double h = span / n;
+    for(int col = 0; col < 2; col++){
+        SensState s = { double(col == 0), double(col == 1), 0, 0, 0, 0 };
+        for(int j = 0; j < n; j++) s = rk4_sens_step(s, h, m, c, k);
+        map.phi[0][col] = s.x;  map.phi[1][col] = s.v;
+        map.qc[0][col]  = s.xc; map.qc[1][col]  = s.vc;
+        map.qk[0][col]  = s.xk; map.qk[1][col]  = s.vk;
+    }
+    return map;
+}
+
+static inline void apply(const double a[2][2], double& x, double& v){
+    double x_ = a[0][0]*x + a[0][1]*v;
+    v = a[1][0]*x + a[1][1]*v;
+    x = x_;
+}
+
+// One pass over the log: runs the RK4 model and accumulates the Gauss-Newton
+// system JtJ, Jtr on the fly, so nothing per sample is stored.
+// Returns the sum of squared residuals.
+static double sensitivity_pass(const Measurement& data, double m, const double p[NP], double JtJ[NP][NP], double Jtr[NP]){
+    const double c = exp(p[0]), k = exp(p[1]);
+    // Same step rule as the simulator: at most 1/10 of 1/wn, and 0.01 s
+    const double h_max = min(0.1 / sqrt(k/m), 0.01);
+
+    double x = p[2], v = p[3];                 // State
+    double xc = 0, vc = 0, xk = 0, vk = 0;     // d/dc, d/dk
+    double xa = 1, va = 0, xb = 0, vb = 1;     // d/dx0, d/dv0
+    double cost = 0;
+    for(int i = 0; i < NP; i++){
+        Jtr[i] = 0;
+        for(int j = 0; j < NP; j++) JtJ[i][j] = 0;
+    }
+
+    IntervalMap map = {};
+    double mapped_span = -1;
+    for(size_t i = 0; i < data.t.size(); i++){
+        if(i > 0){
+            // Sampled logs have (nearly) one interval; the map is rebuilt only when
+            // it changes by more than rounding in the printed times.
+            double span = data.t[i] - data.t[i - 1];
+            if(abs(span - mapped_span) > 1e-9*span){
+                map = interval_map(span, h_max, m, c, k);
+                mapped_span = span;
+            }
+            double fx = map.qc[0][0]*x + map.qc[0][1]*v, fv = map.qc[1][0]*x + map.qc[1][1]*v;
+            double gx = map.qk[0][0]*x + map.qk[0][1]*v, gv = map.qk[1][0]*x + map.qk[1][1]*v;
+            apply(map.phi, x, v);
+            apply(map.phi, xc, vc); xc += fx; vc += fv;
+            apply(map.phi, xk, vk); xk += gx; vk += gv;
+            apply(map.phi, xa, va);
+            apply(map.phi, xb, vb);
+            // A heavily damped guess decays into subnormal numbers, which are
+            // orders of magnitude slower to compute with: flush them to zero.
+            if(abs(x) + abs(v) + abs(xc) + abs(vc) + abs(xk) + abs(vk) + abs(xa) + abs(va) + abs(xb) + abs(vb) < 1e-250){
+                x = v = xc = vc = xk = vk = xa = va = xb = vb = 0;
+            }
+        }
+        double r = x - data.x[i];
+        const double J[NP] = { c*xc, k*xk, xa, xb }; // dx/d(ln c), dx/d(ln k), dx/dx0, dx/dv0
+        cost += r*r;
+        for(int a = 0; a < NP; a++){
+            Jtr[a] += J[a]*r;
+            for(int b = a; b < NP; b++) JtJ[a][b] += J[a]*J[b];
+        }
+    }
+    for(int a = 0; a < NP; a++){
+        for(int b = 0; b < a; b++) JtJ[a][b] = JtJ[b][a];
+    }
+    return cost;
+}
+
+// Solves A x = b for a symmetric positive definite A (Cholesky, in place).
+// Returns false if A is not positive definite.
+static bool cholesky_solve(double A[NP][NP], const double b[NP], double x[NP]){
+    for(int j = 0; j < NP; j++){
+        double d = A[j][j];
+        for(int q = 0; q < j; q++) d -= A[j][q]*A[j][q];
+        if(!(d > 0)) return false;
+        A[j][j] = sqrt(d);
+        for(int i = j + 1; i < NP; i++){
+            double s = A[i][j];
+            for(int q = 0; q < j; q++) s -= A[i][q]*A[j][q];
+            A[i][j] = s / A[j][j];
+        }
+    }
+    for(int i = 0; i < NP; i++){
+        double s = b[i];
+        for(int q = 0; q < i; q++) s -= A[i][q]*x[q];
+        x[i] = s / A[i][i];
+    }
+    for(int i = NP - 1; i >= 0; i--){
+        double s = x[i];
+        for(int q = i + 1; q < NP; q++) s -= A[q][i]*x[q];
+        x[i] = s / A[i][i];
+    }
+    return true;
+}
+
+// Levenberg-Marquardt from one start.
+static FitResult fit_from(const Measurement& data, double m, double c0, double k0, const FitOptions& opt){
+    FitResult fit;
+    fit.c0 = c0;
+    fit.k0 = k0;
+    double p[NP] = { log(c0), log(k0), data.x[0], data.v0 };
+    double JtJ[NP][NP], Jtr[NP];
+    double cost = sensitivity_pass(data, m, p, JtJ, Jtr);
+    double lambda = 1e-3;
+
+    while(fit.iterations < opt.max_iterations && cost > 0){
+        fit.iterations++;
+        // (JtJ + lambda*diag(JtJ)) step = -Jtr
+        double A[NP][NP], rhs[NP], step[NP];
+        for(int i = 0; i < NP; i++){
+            for(int j = 0; j < NP; j++) A[i][j] = JtJ[i][j];
+            A[i][i] *= 1 + lambda;
+            rhs[i] = -Jtr[i];
+        }
+        if(!cholesky_solve(A, rhs, step)) break;
+        double scale = max(abs(step[0]), abs(step[1])) / MAX_LOG_STEP;
+        if(scale > 1){ for(double& d : step) d /= scale; }
+
+        double p_try[NP];
+        for(int i = 0; i < NP; i++) p_try[i] = p[i] + step[i];
+        double c_try = exp(p_try[0]), k_try = exp(p_try[1]);
+        double JtJ_try[NP][NP], Jtr_try[NP];
+        double cost_try = (c_try <= C_MAX && k_try <= K_MAX && k_try >= K_MIN)
+                        ? sensitivity_pass(data, m, p_try, JtJ_try, Jtr_try)
+                        : HUGE_VAL;
+
+        if(cost_try < cost){
+            // Converged when the cost stalls or c and k move by less than 1e-12 relative
+            bool small = (cost - cost_try) <= opt.tolerance*cost || max(abs(step[0]), abs(step[1])) < 1e-12;
+            copy(p_try, p_try + NP, p);
+            cost = cost_try;
+            copy(&JtJ_try[0][0], &JtJ_try[0][0] + NP*NP, &JtJ[0][0]);
+            copy(Jtr_try, Jtr_try + NP, Jtr);
+            lambda = max(lambda/3, 1e-12);
+            if(small){
+                fit.converged = true;
+                break;
+            }
+        } else {
+            lambda *= 4;
+            if(lambda > 1e12){
+                fit.converged = true; // No downhill step left: a minimum to working precision
+                break;
+            }
+        }
+    }
+    if(cost == 0) fit.converged = true;
+
+    fit.c = exp(p[0]);
+    fit.k = exp(p[1]);
+    fit.x0 = p[2];
+    fit.v0 = p[3];
+    size_t n = data.t.size();
+    fit.rms = sqrt(cost / double(n));
+
+    // Standard errors: sigma^2 * (JtJ)^-1, scaled back from log-parameters
+    double sigma2 = (n > NP) ? cost / double(n - NP) : 0.0;
+    double var[2] = {0, 0}; // Diagonal of (JtJ)^-1 for ln c, ln k
+    for(int i = 0; i < 2; i++){
+        double A[NP][NP], unit[NP] = {0, 0, 0, 0}, column[NP];
+        copy(&JtJ[0][0], &JtJ[0][0] + NP*NP, &A[0][0]);
+        unit[i] = 1;
+        if(cholesky_solve(A, unit, column)) var[i] = column[i];
+    }
+    fit.c_error = fit.c*sqrt(sigma2*var[0]);
+    fit.k_error = fit.k*sqrt(sigma2*var[1]);
+    return fit;
+}
+
+// Natural frequency guess from the zero crossings of x (lightly damped: wd ~ wn).
+// A crossing only counts once x gets past 10% of its peak on the other side,
+// so noise around a decayed signal is ignored. Records with fewer than two
+// crossings are taken to decay over their length.
+static double guess_wn(const Measurement& data){
+    double peak = 0;
+    for(double x : data.x) peak = max(peak, abs(x));
+    const double band = 0.1*peak;
+
+    double first = 0, last = 0;
+    int crossings = 0, side = 0;
+    for(size_t i = 0; i < data.x.size(); i++){
+        int now = (data.x[i] > band) ? 1 : (data.x[i] < -band) ? -1 : 0;
+        if(now == 0) continue;
+        if(side != 0 && now != side){
+            if(crossings == 0) first = data.t[i];
+            last = data.t[i];
+            crossings++;
+        }
+        side = now;
+    }
+    if(crossings >= 2) return pi*(crossings - 1) / (last - first);
+    return 8 / (data.t.back() - data.t.front());
+}
+
+FitResult fit_parameters(const Measurement& data, double m, const FitOptions& opt, vector<FitResult>* all){
+    // Starts: damping ratios log-spaced over [0.01, 2], stiffness around the guess
+    const int n = max(1, opt.starts);
+    const double wn = guess_wn(data);
+    const double k_factor[3] = {1.0, 0.8, 1.25};
+    vector<FitResult> fits(n);
+    ThreadPool pool(opt.threads);
+
+    // One task per start; each writes only its own slot of 'fits'.
+    pool.parallel_for(size_t(n), 1, [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; i++){
+            double zeta = (n == 1) ? 0.1 : 0.01*pow(200.0, double(i)/(n - 1));
+            double k0 = min(max(m*wn*wn*k_factor[i % 3], K_MIN), K_MAX);
+            fits[i] = fit_from(data, m, min(2*zeta*sqrt(k0*m), C_MAX), k0, opt);
+        }
+    });
+
+    // Lowest residual wins; ties go to the earlier start, so the choice is deterministic.
+    size_t best = 0;
+    for(size_t i = 1; i < fits.size(); i++){
+        if(fits[i].rms < fits[best].rms) best = i;
+    }
+    if(all) *all = fits;
+    return fits[best];
+}
@@ -0,0 +1,243 @@
+#include "MonteCarlo.h"
+#include "Trajectory.h"     // For TrajectorySink
+#include "ThreadPool.h"
+#include "constants.h"      // For 'pi'
+#include <cmath>
+#include <cstdlib>      // For strtod
+#include <vector>
+#include <algorithm>    // std::min, std::max
+
+using namespace std;
+
+// --- RandomStream ---
+
+static uint64_t splitmix64(uint64_t& state){
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k){
+    return (x << k) | (x >> (64 - k));
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream){
+    // Hash the seed, then offset by the stream id, so neighbouring seeds and
+    // neighbouring streams start from unrelated states.
+    uint64_t state = seed;
+    state = splitmix64(state) ^ (stream * 0xD1B54A32D192ED03ULL);
+    for(int i = 0; i < 4; i++) s[i] = splitmix64(state);
+}
+
+uint64_t RandomStream::next(){
+    uint64_t result = rotl(s[1]*5, 7)*9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+double RandomStream::uniform(){
+    return double(next() >> 11) * (1.0/9007199254740992.0); // 2^-53
+}
+
+double RandomStream::normal(){
+    double u1 = 1.0 - uniform(); // (0, 1], so the log is finite
+    double u2 = uniform();
+    return sqrt(-2.0*log(u1)) * cos(2*pi*u2);
+}
+
+// --- Distribution ---
+
+double Distribution::sample(RandomStream& rng) const{
+    switch(type){
+        case DistributionType::Uniform:   return a + (b - a)*rng.uniform();
+        case DistributionType::Normal:    return a + b*rng.normal();
+        case DistributionType::LogNormal: return a*exp(b*rng.normal());
+        default:                          return a;
+    }
+}
+
+// The whole of 'text' as a finite number ("abc" or "2x" is an error, not 0).
+static bool parse_value(const string& text, double& value){
+    char* end;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && isfinite(value);
+}
+
+bool parse_distribution(const string& spec, Distribution& d){
+    vector<string> parts;
+    size_t start = 0;
+    while(true){
+        size_t colon = spec.find(':', start);
+        parts.push_back(spec.substr(start, colon - start));
+        if(colon == string::npos) break;
+        start = colon + 1;
+    }
+
+    if(parts.size() == 1){
+        d.type = DistributionType::Fixed;
+        return parse_value(parts[0], d.a);
+    }
+    double a, b;
+    if(parts.size() != 3 || !parse_value(parts[1], a) || !parse_value(parts[2], b)) return false;
+
+    if(parts[0] == "uniform" && b >= a){ d.type = DistributionType::Uniform; d.a = a; d.b = b; return true; }
+    if(parts[0] == "normal" && b >= 0){ d.type = DistributionType::Normal; d.a = a; d.b = b; return true; }
+    if(parts[0] == "lognormal" && a > 0 && b >= 0){ d.type = DistributionType::LogNormal; d.a = a; d.b = b; return true; }
+    if(parts[0] == "tol" && b >= 0){
+        d.type = DistributionType::Uniform;
+        d.a = a*(1 - b/100);
+        d.b = a*(1 + b/100);
+        if(d.a > d.b) swap(d.a, d.b);
+        return true;
+    }
+    return false;
+}
+
+// --- RunningStats ---
+
+static const double BUCKET_GROWTH = 1.01;
+
+void RunningStats::add(double value){
+    count++;
+    double delta = value - mean;
+    mean += delta / double(count);
+    m2 += delta*(value - mean);
+    if(count == 1 || value < min) min = value;
+    if(count == 1 || value > max) max = value;
+
+    if(value > 0) buckets[int(floor(log(value)/log(BUCKET_GROWTH)))]++;
+    else zeros++;
+}
+
+void RunningStats::merge(const RunningStats& other){
+    if(other.count == 0) return;
+    if(count == 0){
+        *this = other;
+        return;
+    }
+    double n = double(count + other.count);
+    double delta = other.mean - mean;
+    mean += delta*double(other.count)/n;
+    m2 += other.m2 + delta*delta*double(count)*double(other.count)/n;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+
+    zeros += other.zeros;
+    for(const auto& b : other.buckets) buckets[b.first] += b.second;
+}
+
+double RunningStats::stddev() const{
+    return (count > 1) ? sqrt(m2 / double(count - 1)) : 0.0;
+}
+
+double RunningStats::percentile(double p) const{
+    if(count == 0) return 0.0;
+    if(p <= 0) return min;
+    if(p >= 100) return max;
+
+    // Nearest-rank: the value with (p/100)*(count-1) values below it
+    uint64_t rank = uint64_t(p/100 * double(count - 1));
+    if(rank < zeros) return std::max(min, std::min(0.0, max));
+    uint64_t seen = zeros;
+    for(const auto& b : buckets){
+        seen += b.second;
+        if(rank < seen){
+            double center = pow(BUCKET_GROWTH, b.first + 0.5);
+            return std::max(min, std::min(center, max));
+        }
+    }
+    return max;
+}
+
+// --- Monte Carlo run ---
+
+// Summary metrics of one run, computed while it streams.
+class MetricsSink : public TrajectorySink{
+private:
+    double ref = 0;       // First extreme of x (x0, or the first turning point)
+    double opposite = 0;  // Largest |x| on the other side of equilibrium
+    double v_prev = 0;
+    bool first = true;
+
+public:
+    double peak = 0, settling_time = 0;
+
+    void write(double t, double x, double v, double a) override {
+        (void)a;
+        // Same running-peak rule as simulate_summary()
+        if(abs(x) > peak) peak = abs(x);
+        if(abs(x) > 0.02*peak) settling_time = t;
+
+        if(ref == 0){
+            // x0 is the first extreme unless the mass starts moving away from equilibrium
+            if(first){ if(x != 0 && x*v <= 0) ref = x; }
+            else if(v_prev != 0 && v_prev*v <= 0) ref = x;
+        }
+        else if(x*ref < 0){
+            opposite = std::max(opposite, abs(x));
+        }
+        v_prev = v;
+        first = false;
+    }
+
+    double overshoot() const { return (ref != 0) ? 100*opposite/abs(ref) : 0.0; }
+};
+
+// Simulates samples [begin, end) of one RNG stream.
+static void run_block(const MonteCarloSpec& spec, size_t block, MonteCarloResult& out){
+    RandomStream rng(spec.seed, block);
+    size_t begin = block*MONTE_CARLO_BLOCK;
+    size_t end = std::min(spec.samples, begin + MONTE_CARLO_BLOCK);
+
+    for(size_t i = begin; i < end; i++){
+        // Always draw all five, so sample i+1 does not depend on whether i was rejected
+        double m_ = spec.m.sample(rng), c_ = spec.c.sample(rng), k_ = spec.k.sample(rng);
+        double xo_ = spec.xo.sample(rng), vo_ = spec.vo.sample(rng);
+
+        MassSpringDamper s;
+        int e[5] = {0,0,0,0,0};
+        s.validate_parameters(e, m_, c_, k_, xo_, vo_);
+        if(!(e[0]==1 && e[1]==1 && e[2]==1 && e[3]==1 && e[4]==1)){
+            out.rejected++;
+            continue;
+        }
+        s.set_parameters(m_, c_, k_, xo_, vo_);
+
+        MetricsSink metrics;
+        simulate(s, spec.solver, metrics);
+        out.accepted++;
+        out.settling_time.add(metrics.settling_time);
+        out.overshoot.add(metrics.overshoot());
+        out.peak.add(metrics.peak);
+    }
+}
+
+MonteCarloResult run_monte_carlo(const MonteCarloSpec& spec, unsigned threads){
+    size_t blocks = (spec.samples + MONTE_CARLO_BLOCK - 1) / MONTE_CARLO_BLOCK;
+    vector<MonteCarloResult> partial(blocks);
+    ThreadPool pool(threads);
+
+    // One task per block; each writes only its own slot of 'partial'.
+    pool.parallel_for(blocks, 1, [&](size_t begin, size_t end){
+        for(size_t b = begin; b < end; b++) run_block(spec, b, partial[b]);
+    });
+
+    // Merge in block order: the floating-point sums come out the same for any thread count.
+    MonteCarloResult total;
+    for(const MonteCarloResult& r : partial){
+        total.accepted += r.accepted;
+        total.rejected += r.rejected;
+        total.settling_time.merge(r.settling_time);
+        total.overshoot.merge(r.overshoot);
+        total.peak.merge(r.peak);
+    }
+    return total;
+}
@@ -0,0 +1,353 @@
+#include "Network.h"
+#include "ThreadPool.h"
+#include <iostream>
+#include <iomanip>      // For setprecision
+#include <sstream>
+#include <limits>       // For numeric_limits
+#include <algorithm>    // std::sort, std::min, std::max
+#include <memory>       // std::unique_ptr
+#include <cmath>
+#include <cstdlib>      // For strtod, strtol
+#include <climits>      // For INT_MAX
+#include <cerrno>
+
+using namespace std;
+
+// Rows per task of the parallel sweeps. Small networks stay on one thread,
+// where a sweep is only a few microseconds.
+static const size_t NETWORK_GRAIN = 4096;
+
+// --- SpringNetwork ---
+
+bool SpringNetwork::build(const vector<double>& masses, const vector<Spring>& springs){
+    const size_t n = masses.size();
+    for(size_t i = 0; i < n; i++){
+        if(!(masses[i] > 0)){
+            cout << "Error: mass " << i << " must be positive" << endl;
+            return false;
+        }
+    }
+
+    // Per-row (column, k, c) triplets; duplicates are merged after sorting.
+    struct Entry{ int col; double k, c; };
+    vector<vector<Entry>> rows(n);
+    for(size_t s = 0; s < springs.size(); s++){
+        const Spring& sp = springs[s];
+        bool bad_i = sp.i < 0 || size_t(sp.i) >= n;
+        bool bad_j = sp.j != GROUND && (sp.j < 0 || size_t(sp.j) >= n);
+        if(bad_i || bad_j || sp.i == sp.j || sp.k < 0 || sp.c < 0){
+            cout << "Error: spring " << s << " (" << sp.i << ", " << sp.j << ") is invalid" << endl;
+            return false;
+        }
+        rows[sp.i].push_back({sp.i, sp.k, sp.c});
+        if(sp.j != GROUND){
+            rows[sp.j].push_back({sp.j, sp.k, sp.c});
+            rows[sp.i].push_back({sp.j, -sp.k, -sp.c});
+            rows[sp.j].push_back({sp.i, -sp.k, -sp.c});
+        }
+    }
+
+    inv_m.resize(n);
+    row_start.assign(1, 0);
+    col.clear();
+    kval.clear();
+    cval.clear();
+    w_max = 0;
+    for(size_t i = 0; i < n; i++){
+        vector<Entry>& r = rows[i];
+        sort(r.begin(), r.end(), [](const Entry& a, const Entry& b){ return a.col < b.col; });
+        double row_sum = 0; // sum |K_ij| for the Gershgorin bound
+        for(size_t e = 0; e < r.size(); e++){
+            if(!col.empty() && row_start.back() < col.size() && col.back() == r[e].col){
+                kval.back() += r[e].k;
+                cval.back() += r[e].c;
+            } else {
+                col.push_back(r[e].col);
+                kval.push_back(r[e].k);
+                cval.push_back(r[e].c);
+            }
+        }
+        for(size_t e = row_start.back(); e < col.size(); e++) row_sum += abs(kval[e]);
+        row_start.push_back(col.size());
+        vector<Entry>().swap(r);
+
+        inv_m[i] = 1.0 / masses[i];
+        w_max = max(w_max, sqrt(row_sum * inv_m[i]));
+    }
+    n_springs = springs.size();
+
+    x.assign(n, 0.0);
+    v.assign(n, 0.0);
+    return true;
+}
+
+double SpringNetwork::stable_dt() const{
+    return (w_max > 0) ? min(0.1 / w_max, 0.01) : 0.01;
+}
+
+void SpringNetwork::acceleration(const double* x_, const double* v_, double* a, size_t begin, size_t end) const{
+    const size_t* rs = row_start.data();
+    const int* cl = col.data();
+    const double* kv = kval.data();
+    const double* cv = cval.data();
+    for(size_t i = begin; i < end; i++){
+        double f = 0;
+        for(size_t e = rs[i]; e < rs[i + 1]; e++){
+            f -= kv[e]*x_[cl[e]] + cv[e]*v_[cl[e]];
+        }
+        a[i] = f * inv_m[i];
+    }
+}
+
+double SpringNetwork::energy() const{
+    // 0.5 v'Mv + 0.5 x'Kx
+    double e = 0;
+    for(size_t i = 0; i < size(); i++){
+        double kx = 0;
+        for(size_t p = row_start[i]; p < row_start[i + 1]; p++) kx += kval[p]*x[col[p]];
+        e += 0.5*v[i]*v[i]/inv_m[i] + 0.5*x[i]*kx;
+    }
+    return e;
+}
+
+// --- NetworkCsvWriter ---
+
+NetworkCsvWriter::NetworkCsvWriter(const string& filename_, const vector<int>& probes_, int every_)
+    : filename(filename_), file(filename_), probes(probes_), every(max(every_, 1)){
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return;
+    }
+    file << setprecision(numeric_limits<double>::max_digits10);
+    file << "time(s)";
+    for(int p : probes) file << ",x" << p << "(m)";
+    file << "\n";
+}
+
+NetworkCsvWriter::~NetworkCsvWriter(){
+    close();
+}
+
+void NetworkCsvWriter::write(double t, const double* x, const double* v, size_t n){
+    (void)v;
+    if(!file.is_open() || (calls++ % every) != 0) return;
+    file << t;
+    for(int p : probes){
+        file << ",";
+        if(p >= 0 && size_t(p) < n) file << x[p];
+    }
+    file << "\n";
+}
+
+void NetworkCsvWriter::close(){
+    if(!file.is_open()) return;
+    file.close();
+    written = !file.fail();
+    if(!written) cout << "Error: could not write '" << filename << "'" << endl;
+    else cout << "'" << filename << "' file successfully exported!" << endl;
+}
+
+// --- Builders ---
+
+bool build_chain(SpringNetwork& net, size_t n, double m, double k, double c, bool fixed_ends){
+    vector<Spring> springs;
+    springs.reserve(n + 1);
+    for(size_t i = 0; i + 1 < n; i++) springs.push_back({int(i), int(i + 1), k, c});
+    if(fixed_ends && n > 0){
+        springs.push_back({0, GROUND, k, c});
+        if(n > 1) springs.push_back({int(n - 1), GROUND, k, c});
+    }
+    return net.build(vector<double>(n, m), springs);
+}
+
+bool build_mesh(SpringNetwork& net, size_t rows, size_t cols, double m, double k, double c){
+    vector<Spring> springs;
+    springs.reserve(3*rows*cols);
+    for(size_t r = 0; r < rows; r++){
+        for(size_t q = 0; q < cols; q++){
+            int id = int(r*cols + q);
+            if(q + 1 < cols) springs.push_back({id, id + 1, k, c});
+            if(r + 1 < rows) springs.push_back({id, id + int(cols), k, c});
+            if(r == 0 || q == 0 || r + 1 == rows || q + 1 == cols) springs.push_back({id, GROUND, k, c});
+        }
+    }
+    return net.build(vector<double>(rows*cols, m), springs);
+}
+
+// Whole field as a finite number ("1x" or "abc" is an error, not 1 or 0).
+static bool parse_field(const string& text, double& value){
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' && isfinite(value);
+}
+
+// Whole field as a mass index, or "ground" for the frame when allowed.
+static bool parse_index(const string& text, bool ground_ok, int& index){
+    if(ground_ok && text == "ground"){
+        index = GROUND;
+        return true;
+    }
+    char* end = nullptr;
+    errno = 0;
+    long value = strtol(text.c_str(), &end, 10);
+    if(end == text.c_str() || *end != '\0' || errno == ERANGE || value < 0 || value > INT_MAX) return false;
+    index = int(value);
+    return true;
+}
+
+bool read_network(const string& filename, SpringNetwork& net){
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not open '" << filename << "'" << endl;
+        return false;
+    }
+
+    vector<double> masses, x0, v0;
+    vector<Spring> springs;
+    string line;
+    int line_no = 0;
+    while(getline(file, line)){
+        line_no++;
+        line = line.substr(0, line.find('#'));
+        for(char& ch : line){ if(ch == ',' || ch == '\r') ch = ' '; }
+        istringstream in(line);
+        vector<string> fields;
+        string field;
+        while(in >> field) fields.push_back(field);
+        if(fields.empty()) continue;
+        const string& kind = fields[0];
+
+        // Every field must parse completely and none may be left over
+        if(kind == "mass"){
+            double m, xo = 0, vo = 0;
+            if(fields.size() < 2 || fields.size() > 4 || !parse_field(fields[1], m)
+               || (fields.size() > 2 && !parse_field(fields[2], xo)) || (fields.size() > 3 && !parse_field(fields[3], vo))){
+                cout << "Error: '" << filename << "' line " << line_no << ": expected 'mass <m> [x0] [v0]'" << endl;
+                return false;
+            }
+            masses.push_back(m);
+            x0.push_back(xo);
+            v0.push_back(vo);
+        }
+        else if(kind == "spring"){
+            Spring sp;
+            if(fields.size() != 5 || !parse_index(fields[1], false, sp.i) || !parse_index(fields[2], true, sp.j)
+               || !parse_field(fields[3], sp.k) || !parse_field(fields[4], sp.c)){
+                cout << "Error: '" << filename << "' line " << line_no << ": expected 'spring <i> <j|ground> <k> <c>'" << endl;
+                return false;
+            }
+            springs.push_back(sp);
+        }
+        else {
+            cout << "Error: '" << filename << "' line " << line_no << ": unknown item '" << kind << "'" << endl;
+            return false;
+        }
+    }
+
+    if(!net.build(masses, springs)) return false;
+    net.x = x0;
+    net.v = v0;
+    return true;
+}
+
+// --- Integration ---
+
+// Runs sweep(begin, end) over all rows, on the pool when there is one.
+template<class Sweep>
+static void for_rows(ThreadPool* pool, size_t n, size_t grain, Sweep&& sweep){
+    if(pool) pool->parallel_for(n, grain, sweep);
+    else sweep(0, n);
+}
+
+bool simulate_network(SpringNetwork& net, Solver solver, double t_end, NetworkSink* out, unsigned threads){
+    if(solver != Solver::Euler && solver != Solver::RK4){
+        cout << "Error: only euler and rk4 have a network version (use one of them)" << endl;
+        return false;
+    }
+
+    const size_t n = net.size();
+    const double dt = net.stable_dt();
+    const long steps = (t_end > 0) ? long(llround(t_end/dt)) : 0;
+
+    // Every sweep below only writes rows [begin, end) and reads buffers that
+    // no other task writes in the same sweep, so rows can run in any order.
+    unique_ptr<ThreadPool> pool;
+    if(n >= NETWORK_PARALLEL_MIN && threads != 1){
+        pool.reset(new ThreadPool(threads));
+        if(pool->size() < 2) pool.reset();
+    }
+    const size_t grain = pool ? max(NETWORK_GRAIN, n / (4*pool->size()) + 1) : n;
+
+    double* x = net.x.data();
+    double* v = net.v.data();
+    if(out) out->write(0, x, v, n);
+
+    if(solver == Solver::Euler){
+        // Semi-implicit Euler: v and x go to a second buffer, then swap.
+        vector<double> xb(n), vb(n);
+        for(long step = 1; step <= steps; step++){
+            const double* xr = x;
+            const double* vr = v;
+            double* xw = xb.data();
+            double* vw = vb.data();
+            for_rows(pool.get(), n, grain, [&](size_t begin, size_t end){
+                net.acceleration(xr, vr, vw, begin, end);
+                for(size_t i = begin; i < end; i++){
+                    vw[i] = vr[i] + vw[i]*dt; // new v uses a
+                    xw[i] = xr[i] + vw[i]*dt; // new x uses new v
+                }
+            });
+            net.x.swap(xb);
+            net.v.swap(vb);
+            x = net.x.data();
+            v = net.v.data();
+            if(out) out->write(step*dt, x, v, n);
+        }
+    }
+    else {
+        // RK4, one sweep per stage. Stage s reads the stage state of the
+        // previous sweep, writes its own, and adds its slopes to (sx, sv).
+        vector<double> xa(n), va(n), xb(n), vb(n), sx(n), sv(n), acc(n);
+        const double h2 = dt/2.0, h6 = dt/6.0;
+        for(long step = 1; step <= steps; step++){
+            for_rows(pool.get(), n, grain, [&](size_t begin, size_t end){
+                net.acceleration(x, v, acc.data(), begin, end);
+                for(size_t i = begin; i < end; i++){
+                    sx[i] = v[i];
+                    sv[i] = acc[i];
+                    xa[i] = x[i] + v[i]*h2;
+                    va[i] = v[i] + acc[i]*h2;
+                }
+            });
+            for_rows(pool.get(), n, grain, [&](size_t begin, size_t end){
+                net.acceleration(xa.data(), va.data(), acc.data(), begin, end);
+                for(size_t i = begin; i < end; i++){
+                    sx[i] += 2.0*va[i];
+                    sv[i] += 2.0*acc[i];
+                    xb[i] = x[i] + va[i]*h2;
+                    vb[i] = v[i] + acc[i]*h2;
+                }
+            });
+            for_rows(pool.get(), n, grain, [&](size_t begin, size_t end){
+                net.acceleration(xb.data(), vb.data(), acc.data(), begin, end);
+                for(size_t i = begin; i < end; i++){
+                    sx[i] += 2.0*vb[i];
+                    sv[i] += 2.0*acc[i];
+                    xa[i] = x[i] + vb[i]*dt;
+                    va[i] = v[i] + acc[i]*dt;
+                }
+            });
+            for_rows(pool.get(), n, grain, [&](size_t begin, size_t end){
+                net.acceleration(xa.data(), va.data(), acc.data(), begin, end);
+                for(size_t i = begin; i < end; i++){
+                    x[i] += (sx[i] + va[i]) * h6;
+                    v[i] += (sv[i] + acc[i]) * h6;
+                }
+            });
+            if(out) out->write(step*dt, x, v, n);
+        }
+    }
+
+    if(out) out->close();
+    return true;
+}
@@ -0,0 +1,329 @@
+#include "Nonlinear.h"
+#include "Trajectory.h"     // For TrajectorySink
+#include "TrajectoryFile.h" // For BinaryStreamWriter
+#include "OutputPolicy.h"   // For DecimatingSink
+#include "Forcing.h"    // For Forcing
+#include "Steppers.h"   // Methods
+#include "Trace.h"      // MSD_TRACE_*
+#include <iostream>
+#include <cmath>
+#include <algorithm>    // std::min / std::max
+#include <limits>       // For numeric_limits
+
+using namespace std;
+
+// The root finder stops once an event time is known to EVENT_TOL*dt.
+static const double EVENT_TOL = 1e-10;
+
+// A bounce that would come back to the wall within this fraction of dt ends
+// the bouncing: the mass rests against the wall instead (no Zeno cascade of
+// ever shorter bounces).
+static const double CONTACT_FLIGHT = 1e-3;
+
+// --- Force laws ---
+// Picked once per run, so every combination gets its own inlined loop.
+
+struct LinearSpring{
+    static double a(double km, double, double x){ return -km*x; }
+};
+struct DuffingSpring{
+    static double a(double km, double k3m, double x){ return -(km + k3m*x*x)*x; }
+};
+
+struct NoExternal{
+    static const bool varying = false;
+    double value(double) const { return 0; }
+};
+struct ExternalForce{
+    static const bool varying = true;
+    const Forcing& f;
+    double value(double t) const { return f.value(t); }
+};
+
+// a(t, x, v) of the sliding mass. Within a sliding segment friction is a
+// constant force (its direction only changes at a velocity event), so the
+// methods of Steppers.h see a smooth model.
+template<class Spring, class External>
+struct NonlinearModel{
+    double cm, km, k3m, inv_m;
+    External ext;
+    double friction_a;  // -direction*friction/m of the current segment
+
+    // Every force but friction, / m.
+    double free_a(double t, double x, double v) const { return -cm*v + Spring::a(km, k3m, x) + inv_m*ext.value(t); }
+    double operator()(double t, double x, double v) const { return free_a(t, x, v) + friction_a; }
+};
+
+// --- Event location ---
+
+// Where g crosses zero in (0, h]: g(0) = g0 > 0 and g(h) = g_end < 0, with
+// g(h') evaluated by a trial step of size h'. Illinois (regula falsi that
+// halves the weight of a stale end), so a smooth g takes a handful of trial
+// steps. Returns a step just past the root (g <= 0 there).
+template<class G>
+static double event_root(G&& g, double g0, double h, double g_end, double tol, int& resteps){
+    double lo = 0, hi = h, g_lo = g0, g_hi = g_end;
+    int side = 0;
+    for(int k = 0; k < 100 && hi - lo > tol; k++){
+        double mid = (g_lo*hi - g_hi*lo) / (g_lo - g_hi);
+        if(!(mid > lo && mid < hi)) mid = 0.5*(lo + hi);
+        double g_mid = g(mid);
+        resteps++;
+        if(g_mid > 0){
+            lo = mid; g_lo = g_mid;
+            if(side == 1) g_hi *= 0.5;
+            side = 1;
+        } else {
+            hi = mid; g_hi = g_mid;
+            if(side == -1) g_lo *= 0.5;
+            side = -1;
+        }
+    }
+    return hi;
+}
+
+static double sign(double a){ return (a > 0) ? 1.0 : (a < 0) ? -1.0 : 0.0; }
+
+// Fixed-step loop with events. One sample per step of dt; inside a step the
+// state is advanced segment by segment, each one ending at the step end, at
+// the force discontinuity or at the first event:
+//   velocity (friction only): v reaches 0 -> stick, or slide the other way
+//   wall: x reaches x_min / x_max  -> bounce, or rest against it
+//   release (held mass):  the other forces exceed the break-away force
+template<class Method, class Spring, class External, class Sample>
+static StepStats nonlinear_loop(const MassSpringDamper& s, const NonlinearForces& nf, NonlinearModel<Spring, External> model,
+                                double dt, double t_end, double t_jump, double dv_jump, EventStats& ev, Sample&& sample){
+    const double fk = nf.friction*model.inv_m;      // Kinetic friction / m
+    const double fs = nf.break_away()*model.inv_m;  // Break-away force / m
+    const bool friction = fk > 0 || fs > 0;
+    const double tol = EVENT_TOL*dt;
+
+    double t = 0, x = s.get_xo(), v = s.get_vo();
+    double dir = 0;     // Sliding direction, sign of v
+    bool held = false;  // Stuck by friction or resting against a wall: v = 0, x fixed
+    int wall = 0;       // Wall the held mass rests on: -1 x_min, +1 x_max, 0 none
+
+    // How far the other forces are past breaking the held mass away (> 0 = it moves).
+    auto release_margin = [&](double tq, double& a_other){
+        a_other = model.free_a(tq, x, 0);
+        if(wall != 0) return -wall*a_other - fs;  // Only a pull away from the wall counts
+        return abs(a_other) - fs;
+    };
+    // Mass at rest at time tq (v = 0): held, or sliding the way the forces push.
+    auto come_to_rest = [&](double tq){
+        double a_other;
+        v = 0;
+        if(release_margin(tq, a_other) > 0){
+            dir = sign(a_other);
+            held = false;
+            wall = 0;
+        } else {
+            held = true;
+        }
+    };
+
+    if(v != 0) dir = sign(v);
+    else come_to_rest(0);
+    model.friction_a = -dir*fk;
+    sample(0, x, v, held ? 0 : model(0, x, v));
+
+    StepStats stats = {0, 0, StopReason::EndTime};
+    const int n = int(min(round(t_end/dt), MAX_FIXED_STEPS));
+    for(int i = 1; i <= n; i++){
+        const double t_next = i*dt;
+        double a_out = 0;
+        bool smooth = true; // No event in this step: the method's output acceleration holds
+
+        while(t < t_next){
+            const bool to_jump = t_jump > t && t_jump <= t_next;
+            const double t_to = to_jump ? t_jump : t_next;
+            const double h = t_to - t;
+
+            if(held){
+                double a_other;
+                if(External::varying && release_margin(t_to, a_other) > 0){
+                    double h_rel = event_root([&](double hh){ double a; return -release_margin(t + hh, a); },
+                                              -release_margin(t, a_other), h, -release_margin(t_to, a_other), tol, ev.resteps);
+                    t += h_rel;
+                    release_margin(t, a_other);
+                    held = false;
+                    wall = 0;
+                    dir = sign(a_other);
+                    ev.slips++;
+                    smooth = false;
+                    continue;
+                }
+                t = t_to;
+            } else {
+                model.friction_a = -dir*fk;
+                const double a0 = model(t, x, v);
+                double xn = x, vn = v;
+                const double a_end = Method::step(xn, vn, t, h, a0, model);
+
+                // Event functions, positive until the event happens
+                auto trial = [&](double hh, double& xs, double& vs){ xs = x; vs = v; Method::step(xs, vs, t, hh, a0, model); };
+                int event = 0; // 1 velocity, 2 upper wall, 3 lower wall
+                double h_ev = h;
+                if(friction && dir*vn < 0){
+                    h_ev = event_root([&](double hh){ double xs, vs; trial(hh, xs, vs); return dir*vs; },
+                                      dir*v, h, dir*vn, tol, ev.resteps);
+                    event = 1;
+                }
+                if(xn > nf.x_max){
+                    double he = event_root([&](double hh){ double xs, vs; trial(hh, xs, vs); return nf.x_max - xs; },
+                                           nf.x_max - x, h, nf.x_max - xn, tol, ev.resteps);
+                    if(event == 0 || he < h_ev) { h_ev = he; event = 2; }
+                }
+                if(xn < nf.x_min){
+                    double he = event_root([&](double hh){ double xs, vs; trial(hh, xs, vs); return xs - nf.x_min; },
+                                           x - nf.x_min, h, xn - nf.x_min, tol, ev.resteps);
+                    if(event == 0 || he < h_ev) { h_ev = he; event = 3; }
+                }
+
+                if(event == 0){
+                    x = xn;
+                    v = vn;
+                    t = t_to;
+                    a_out = a_end;
+                } else {
+                    trial(h_ev, x, v);
+                    t += h_ev;
+                    smooth = false;
+                    if(event == 1){
+                        // Snap to the event and let the forces decide: stick or reverse
+                        double old_dir = dir;
+                        come_to_rest(t);
+                        if(held) ev.sticks++;
+                        else if(dir != old_dir) ev.reversals++;
+                    } else {
+                        const int w = (event == 2) ? 1 : -1;
+                        x = (w > 0) ? nf.x_max : nf.x_min;
+                        v = -nf.restitution*v;
+                        ev.impacts++;
+                        // Acceleration back toward the wall; rest there if the next bounce would be negligible
+                        model.friction_a = -sign(v)*fk;
+                        double a_w = w*model(t, x, v);
+                        if(v == 0 || (a_w > 0 && 2*abs(v)/a_w < CONTACT_FLIGHT*dt)){
+                            wall = w;
+                            come_to_rest(t);
+                            if(held) ev.contacts++;
+                        } else {
+                            dir = sign(v);
+                        }
+                    }
+                    continue;
+                }
+            }
+
+            if(to_jump){
+                // Landed on the force discontinuity: kick v for an impulse
+                t_jump = numeric_limits<double>::infinity();
+                if(dv_jump != 0){
+                    v += dv_jump;
+                    if(held) ev.slips++;
+                    held = false;
+                    wall = 0;
+                    dir = sign(v);
+                }
+                smooth = false;
+            }
+        }
+
+        if(held) a_out = 0;
+        else if(!smooth){
+            model.friction_a = -dir*fk;
+            a_out = model(t, x, v);
+        }
+        sample(t_next, x, v, a_out);
+        stats.accepted = i;
+        if(held && !External::varying){
+            stats.stop = StopReason::Settled; // Nothing can move it any more
+            break;
+        }
+    }
+    return stats;
+}
+
+// Picks the method.
+template<class Spring, class External, class Sample>
+static StepStats nonlinear_drive(const MassSpringDamper& s, const NonlinearForces& nf, Solver solver, External ext, double dt,
+                                 double t_end, double t_jump, double dv_jump, EventStats& ev, Sample&& sample){
+    NonlinearModel<Spring, External> model = {s.get_c()/s.get_m(), s.get_k()/s.get_m(), nf.k3/s.get_m(), 1.0/s.get_m(), ext, 0};
+    switch(solver){
+        case Solver::Euler:  return nonlinear_loop<SemiImplicitEuler>(s, nf, model, dt, t_end, t_jump, dv_jump, ev, sample);
+        case Solver::Verlet: return nonlinear_loop<VelocityVerlet>(s, nf, model, dt, t_end, t_jump, dv_jump, ev, sample);
+        default:             return nonlinear_loop<ExplicitRK<ClassicRK4>>(s, nf, model, dt, t_end, t_jump, dv_jump, ev, sample);
+    }
+}
+
+// Picks the spring law.
+template<class External, class Sample>
+static StepStats nonlinear_spring(const MassSpringDamper& s, const NonlinearForces& nf, Solver solver, External ext, double dt,
+                                  double t_end, double t_jump, double dv_jump, EventStats& ev, Sample&& sample){
+    if(nf.k3 != 0) return nonlinear_drive<DuffingSpring>(s, nf, solver, ext, dt, t_end, t_jump, dv_jump, ev, sample);
+    return nonlinear_drive<LinearSpring>(s, nf, solver, ext, dt, t_end, t_jump, dv_jump, ev, sample);
+}
+
+// --- Public API ---
+
+bool validate_nonlinear(const MassSpringDamper& s, const NonlinearForces& forces){
+    bool ok = true;
+    if(!(forces.k3 >= 0)) { cout << "Error: k3 must be >= 0 (stiffening spring)" << endl; ok = false; }
+    if(!(forces.friction >= 0)) { cout << "Error: friction must be >= 0" << endl; ok = false; }
+    if(forces.static_friction >= 0 && forces.static_friction < forces.friction){
+        cout << "Error: static friction must be >= the kinetic friction" << endl;
+        ok = false;
+    }
+    if(!(forces.restitution >= 0 && forces.restitution <= 1)) { cout << "Error: restitution must be in [0, 1]" << endl; ok = false; }
+    if(!(forces.x_min < forces.x_max)) { cout << "Error: x_min must be below x_max" << endl; ok = false; }
+    else if(s.get_xo() < forces.x_min || s.get_xo() > forces.x_max){
+        cout << "Error: x0 must lie between the stops" << endl;
+        ok = false;
+    }
+    return ok;
+}
+
+double nonlinear_dt(const MassSpringDamper& s, const NonlinearForces& forces){
+    double wn = s.get_wn();
+    double amplitude = sqrt(s.get_xo()*s.get_xo() + (s.get_vo()/wn)*(s.get_vo()/wn));
+    if(forces.has_stops()) amplitude = min(amplitude, max(abs(forces.x_min), abs(forces.x_max)));
+    // Tangent stiffness k + 3*k3*x^2 at the largest expected |x|
+    double wn_eff = sqrt((s.get_k() + 3*forces.k3*amplitude*amplitude) / s.get_m());
+    return min(0.1 / wn_eff, 0.01);
+}
+
+StepStats simulate_nonlinear(const MassSpringDamper& s, const NonlinearForces& forces, Solver solver, const Forcing* force,
+                             double t_end, TrajectorySink& out, EventStats* events, double dt){
+    MSD_TRACE_SCOPE(scope, "integrate", "nonlinear");
+    if(dt <= 0) dt = nonlinear_dt(s, forces);
+    EventStats local;
+    EventStats& ev = events ? *events : local;
+    ev = EventStats();
+
+    out.begin(s, (solver == Solver::RK45 || solver == Solver::Exact) ? Solver::RK4 : solver, dt);
+    auto sample = [&](double t, double x, double v, double a){ out.write(t, x, v, a); };
+    StepStats stats;
+    if(force && force->type != ForceType::None){
+        double dv_jump = (force->type == ForceType::Impulse) ? force->amplitude/s.get_m() : 0;
+        ExternalForce ext = {*force};
+        stats = nonlinear_spring(s, forces, solver, ext, dt, t_end, force->discontinuity(), dv_jump, ev, sample);
+    } else {
+        stats = nonlinear_spring(s, forces, solver, NoExternal(), dt, t_end, numeric_limits<double>::infinity(), 0.0, ev, sample);
+    }
+    out.close();
+    MSD_TRACE_RUN(scope, stats);
+    return stats;
+}
+
+StepStats simulate_nonlinear_to_file(const MassSpringDamper& s, const NonlinearForces& forces, Solver solver, const Forcing* force,
+                                     double t_end, const string& filename, const OutputPolicy& policy, EventStats* events,
+                                     double dt){
+    BinaryStreamWriter file(filename);
+    DecimatingSink out(file, policy);
+    StepStats stats = simulate_nonlinear(s, forces, solver, force, t_end, out, events, dt);
+    stats.written = file.ok();
+    if(stats.written && policy.mode != OutputMode::EveryStep){
+        cout << out.samples_forwarded() << " of " << out.steps_seen() << " samples stored" << endl;
+    }
+    return stats;
+}
@@ -0,0 +1,136 @@
+#include "OutputPolicy.h"
+#include <cmath>
+#include <algorithm>    // std::sort
+
+using namespace std;
+
+DecimatingSink::DecimatingSink(TrajectorySink& out_, const OutputPolicy& policy_) : out(out_), policy(policy_){
+    if(policy.every < 1) policy.every = 1;
+}
+
+void DecimatingSink::begin(const MassSpringDamper& s, Solver solver, double dt){
+    wn = s.get_wn();
+    out.begin(s, solver, dt);
+}
+
+void DecimatingSink::emit(double t, double x, double v, double a){
+    out.write(t, x, v, a);
+    forwarded++;
+}
+
+void DecimatingSink::interpolate(double theta, double t, double x, double v, double a,
+                                 double& xi, double& vi, double& ai) const{
+    // Cubic Hermite on both x (slope v) and v (slope a, as sampled by the
+    // solver: forces and nonlinear terms included). a itself is linear.
+    double h = t - pt;
+    double t2 = theta*theta, t3 = t2*theta;
+    double h00 = 2*t3 - 3*t2 + 1, h10 = t3 - 2*t2 + theta, h01 = -2*t3 + 3*t2, h11 = t3 - t2;
+    xi = h00*px + h10*h*pv + h01*x + h11*h*v;
+    vi = h00*pv + h10*h*pa + h01*v + h11*h*a;
+    ai = pa + theta*(a - pa);
+}
+
+double DecimatingSink::locate(bool want_v, double t, double x, double v, double a) const{
+    // Bisection on the interpolant: the sign change is already known,
+    // and 40 halvings are far below the step's own error.
+    double lo = 0, hi = 1;
+    double f_lo = want_v ? pv : px;
+    for(int i = 0; i < 40; i++){
+        double mid = 0.5*(lo + hi), xm, vm, am;
+        interpolate(mid, t, x, v, a, xm, vm, am);
+        double f_mid = want_v ? vm : xm;
+        if((f_mid < 0) == (f_lo < 0)){ lo = mid; f_lo = f_mid; }
+        else { hi = mid; }
+    }
+    return 0.5*(lo + hi);
+}
+
+void DecimatingSink::write_events(double t, double x, double v, double a){
+    // Up to three events can fall inside one step; emit them in time order.
+    double thetas[3];
+    int n = 0;
+
+    if((policy.events & EVENT_PEAK) && ((pv < 0 && v >= 0) || (pv > 0 && v <= 0))){
+        thetas[n++] = (v == 0) ? 1.0 : locate(true, t, x, v, a);
+    }
+    if((policy.events & EVENT_ZERO_CROSSING) && ((px < 0 && x >= 0) || (px > 0 && x <= 0))){
+        thetas[n++] = (x == 0) ? 1.0 : locate(false, t, x, v, a);
+    }
+    if((policy.events & EVENT_SETTLED) && !settled){
+        double amp = sqrt(x*x + (v/wn)*(v/wn));
+        if(amp > amp_max) amp_max = amp;
+        if(amp < 0.02*amp_max){
+            settled = true;
+            thetas[n++] = 1.0; // Reported at the first step below the threshold
+        }
+    }
+    sort(thetas, thetas + n);
+
+    for(int i = 0; i < n; i++){
+        if(thetas[i] >= 1.0){
+            emit(t, x, v, a);
+            prev_written = true;
+            // Several events at the step itself are written once.
+            break;
+        }
+        double xi, vi, ai;
+        interpolate(thetas[i], t, x, v, a, xi, vi, ai);
+        emit(pt + thetas[i]*(t - pt), xi, vi, ai);
+    }
+}
+
+void DecimatingSink::write(double t, double x, double v, double a){
+    bool written = false;
+
+    if(!have_prev){
+        // First sample (t = 0) always goes out.
+        emit(t, x, v, a);
+        written = true;
+        amp_max = sqrt(x*x + (v/wn)*(v/wn));
+        next_t = t + policy.interval;
+    }
+    else if(policy.mode == OutputMode::EveryStep){
+        emit(t, x, v, a);
+        written = true;
+    }
+    else if(policy.mode == OutputMode::EveryNth){
+        if(step % size_t(policy.every) == 0){
+            emit(t, x, v, a);
+            written = true;
+        }
+    }
+    else if(policy.mode == OutputMode::FixedInterval){
+        if(policy.interval > 0){
+            while(next_t <= t){
+                double xi, vi, ai;
+                if(next_t == t){
+                    emit(t, x, v, a);
+                    written = true;
+                } else {
+                    interpolate((next_t - pt)/(t - pt), t, x, v, a, xi, vi, ai);
+                    emit(next_t, xi, vi, ai);
+                }
+                next_t += policy.interval;
+            }
+        }
+    }
+    else {
+        prev_written = false;
+        write_events(t, x, v, a);
+        written = prev_written;
+    }
+
+    have_prev = true;
+    prev_written = written;
+    pt = t; px = x; pv = v; pa = a;
+    step++;
+}
+
+void DecimatingSink::close(){
+    // The final state always ends up in the output.
+    if(have_prev && !prev_written){
+        emit(pt, px, pv, pa);
+        prev_written = true;
+    }
+    out.close();
+}
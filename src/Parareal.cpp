@@ -0,0 +1,201 @@
+#include "Parareal.h"
+#include "Simulation.h"     // For default_dt, free_step_map
+#include "Analytic.h"       // For exact_step_map
+#include "Forcing.h"        // For Forcing
+#include "Steppers.h"       // ExplicitRK, ClassicRK4
+#include "ThreadPool.h"
+#include "Trace.h"          // MSD_TRACE_* (empty unless built with MSD_TRACE)
+#include <cmath>
+#include <chrono>
+#include <algorithm>    // std::min, std::max
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// --- Fine propagators ---
+// run(x, v, k0, n) advances (x, v) by the n RK4 steps that start at step k0.
+// The state is copied to locals so it stays in registers (x, v may alias the map).
+
+// Free response: the precomputed step map of rk4().
+struct FreeFine{
+    StepMap P;
+    void run(double& x_io, double& v_io, long long, long long n) const{
+        const StepMap M = P;
+        double x = x_io, v = v_io;
+        for(long long i = 0; i < n; i++){
+            double xn = M.xx*x + M.xv*v;
+            v = M.vx*x + M.vv*v;
+            x = xn;
+        }
+        x_io = x;
+        v_io = v;
+    }
+};
+
+// Forced response: RK4 steps at t = k*dt, as in simulate_forced().
+struct ForcedFine{
+    double cm, km, inv_m, dt;
+    const Forcing* force;
+    double operator()(double t, double x, double v) const { return -cm*v - km*x + inv_m*force->value(t); }
+    void run(double& x_io, double& v_io, long long k0, long long n) const{
+        const ForcedFine model = *this;
+        double x = x_io, v = v_io;
+        for(long long k = k0; k < k0 + n; k++){
+            const double t = double(k)*model.dt;
+            ExplicitRK<ClassicRK4>::step(x, v, t, model.dt, model(t, x, v), model);
+        }
+        x_io = x;
+        v_io = v;
+    }
+};
+
+// --- Coarse propagator ---
+
+// 'steps' steps of size h over one slice: an affine map with the input
+// u = F/m held over each step (ExactStepMap layout, for Euler too).
+struct CoarseSlice{
+    ExactStepMap map;
+    int steps;
+    double h;
+};
+
+static CoarseSlice coarse_slice(const MassSpringDamper& s, CoarseMethod method, double span, int steps){
+    CoarseSlice c;
+    c.steps = steps;
+    c.h = span/steps;
+    if(method == CoarseMethod::Exact){
+        c.map = exact_step_map(s.get_wn(), s.get_zeta(), c.h);
+    } else {
+        // Semi-implicit Euler with a + u: v' = v + h*(a + u), x' = x + h*v'
+        c.map.map = free_step_map(s, Solver::Euler, c.h);
+        c.map.vu = c.h;
+        c.map.xu = c.h*c.h;
+    }
+    return c;
+}
+
+static void coarse_run(const CoarseSlice& c, const Forcing* force, double inv_m, double t0, double& x, double& v){
+    const StepMap& P = c.map.map;
+    for(int i = 0; i < c.steps; i++){
+        const double u = force ? inv_m*force->value(t0 + i*c.h) : 0;
+        double xn = P.xx*x + P.xv*v + c.map.xu*u;
+        v = P.vx*x + P.vv*v + c.map.vu*u;
+        x = xn;
+    }
+}
+
+// --- Parareal iteration ---
+
+template<class Fine>
+static void run_parareal(const MassSpringDamper& s, const Fine& fine, const Forcing* force, const vector<long long>& k,
+                         double dt, const PararealOptions& opt, ThreadPool& pool, PararealResult& out){
+    const int N = int(k.size()) - 1;
+    const double inv_m = 1.0/s.get_m(), wn = s.get_wn();
+    const int ratio = (opt.coarse_ratio > 0) ? opt.coarse_ratio : (opt.coarse == CoarseMethod::Euler) ? 10 : 0;
+    const int max_iterations = (opt.max_iterations > 0) ? min(opt.max_iterations, N) : N;
+
+    vector<CoarseSlice> coarse(N);
+    for(int j = 0; j < N; j++){
+        long long n = k[j + 1] - k[j];
+        int steps = (ratio > 0) ? int((n + ratio - 1)/ratio) : 1;
+        coarse[j] = coarse_slice(s, opt.coarse, double(n)*dt, steps);
+    }
+
+    // Initial prediction: the coarse propagator alone.
+    vector<double>& x = out.x;
+    vector<double>& v = out.v;
+    vector<double> gx(N), gv(N), fx(N), fv(N); // G(U[j]) of the last sweep, F(U[j])
+    x[0] = s.get_xo();
+    v[0] = s.get_vo();
+    for(int j = 0; j < N; j++){
+        gx[j] = x[j];
+        gv[j] = v[j];
+        coarse_run(coarse[j], force, inv_m, k[j]*dt, gx[j], gv[j]);
+        x[j + 1] = gx[j];
+        v[j + 1] = gv[j];
+    }
+
+    for(int iter = 1; iter <= max_iterations; iter++){
+        // Slices before 'first' start from exact states and were integrated already.
+        const int first = iter - 1;
+        pool.parallel_for(size_t(N - first), 1, [&](size_t begin, size_t end){
+            for(size_t i = begin; i < end; i++){
+                const int j = first + int(i);
+                MSD_TRACE_SCOPE(scope, "parareal fine");
+                fx[j] = x[j];
+                fv[j] = v[j];
+                fine.run(fx[j], fv[j], k[j], k[j + 1] - k[j]);
+                MSD_TRACE_RUNS(scope, 1, uint64_t(k[j + 1] - k[j]));
+            }
+        });
+        out.fine_steps += k[N] - k[first];
+
+        // Serial correction sweep: U[j+1] = G(U[j]) + F(U[j]) - G_old(U[j]).
+        double change = 0, scale = 0;
+        {
+            MSD_TRACE_SCOPE(scope, "parareal coarse");
+            for(int j = first; j < N; j++){
+                double cx = x[j], cv = v[j];
+                coarse_run(coarse[j], force, inv_m, k[j]*dt, cx, cv);
+                double xn = cx + fx[j] - gx[j], vn = cv + fv[j] - gv[j];
+                change = max(change, abs(xn - x[j + 1]) + abs(vn - v[j + 1])/wn);
+                scale = max(scale, abs(xn) + abs(vn)/wn);
+                gx[j] = cx;
+                gv[j] = cv;
+                x[j + 1] = xn;
+                v[j + 1] = vn;
+            }
+        }
+        out.iterations = iter;
+        out.corrections.push_back((scale > 0) ? change/scale : 0);
+        if(change <= opt.tolerance*scale){
+            out.converged = true;
+            break;
+        }
+    }
+    // After N iterations every slice started from an exact state, so the
+    // boundaries are right, but nothing was gained over the serial run.
+    out.serial_fallback = !out.converged && out.iterations == N;
+}
+
+PararealResult parareal(const MassSpringDamper& s, const Forcing* force, double t_end, const PararealOptions& opt){
+    if(force && force->type == ForceType::None) force = nullptr;
+    const double dt = default_dt(s);
+    PararealResult out;
+    out.steps = max(1LL, llround(t_end/dt));
+
+    ThreadPool pool(opt.threads);
+    const long long N = min<long long>((opt.slices > 0) ? opt.slices : pool.size(), out.steps);
+    vector<long long> k(size_t(N) + 1);
+    for(long long j = 0; j <= N; j++) k[j] = out.steps*j/N;
+
+    out.t.resize(k.size());
+    out.x.resize(k.size());
+    out.v.resize(k.size());
+    for(size_t j = 0; j < k.size(); j++) out.t[j] = k[j]*dt;
+
+    FreeFine free_fine = {free_step_map(s, Solver::RK4, dt)};
+    ForcedFine forced_fine = {s.get_c()/s.get_m(), s.get_k()/s.get_m(), 1.0/s.get_m(), dt, force};
+
+    auto start = Clock::now();
+    if(force) run_parareal(s, forced_fine, force, k, dt, opt, pool, out);
+    else run_parareal(s, free_fine, force, k, dt, opt, pool, out);
+    out.seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    if(opt.serial_reference){
+        // The same fine steps one slice after the other on this thread: the rk4() loop.
+        MSD_TRACE_SCOPE(scope, "integrate", "rk4 serial");
+        double x = s.get_xo(), v = s.get_vo();
+        start = Clock::now();
+        for(size_t j = 0; j + 1 < k.size(); j++){
+            if(force) forced_fine.run(x, v, k[j], k[j + 1] - k[j]);
+            else free_fine.run(x, v, k[j], k[j + 1] - k[j]);
+            out.max_deviation = max(out.max_deviation, abs(out.x[j + 1] - x));
+        }
+        out.serial_seconds = chrono::duration<double>(Clock::now() - start).count();
+        out.speedup = (out.seconds > 0) ? out.serial_seconds/out.seconds : 0;
+        MSD_TRACE_RUNS(scope, 1, uint64_t(out.steps));
+    }
+    return out;
+}
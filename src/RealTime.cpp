@@ -0,0 +1,268 @@
+#include "RealTime.h"
+#include "Steppers.h"   // Methods
+#include "Forcing.h"    // For Forcing
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <chrono>
+#include <algorithm>    // For max
+#if defined(__x86_64__) || defined(_M_X64)
+#define MSD_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// Below this |x| + |v| the state is flushed to zero: a free decay left
+// running for hours would otherwise end in subnormal numbers, which make
+// every step many times slower on most CPUs.
+static const double FLUSH_LEVEL = 1e-250;
+
+// --- Timestamps ---
+
+// Raw timestamp: the TSC on x86-64 (a few ns to read, against tens of ns for
+// steady_clock in many VMs), steady_clock ticks elsewhere.
+static inline uint64_t ticks(){
+#ifdef MSD_HAS_TSC
+    return __rdtsc();
+#else
+    return uint64_t(Clock::now().time_since_epoch().count());
+#endif
+}
+
+// ns per tick, measured once (5 ms against steady_clock) for the TSC.
+static double tick_length(){
+#ifdef MSD_HAS_TSC
+    static const double ns = []{
+        Clock::time_point t0 = Clock::now();
+        uint64_t c0 = ticks();
+        Clock::time_point t1 = t0;
+        while(t1 - t0 < chrono::milliseconds(5)) t1 = Clock::now();
+        uint64_t c1 = ticks();
+        return chrono::duration<double, nano>(t1 - t0).count() / double(c1 - c0);
+    }();
+    return ns;
+#else
+    return double(Clock::period::num) * 1e9 / double(Clock::period::den);
+#endif
+}
+
+// --- Latency histogram ---
+
+// Index of the highest set bit (v > 0).
+static int high_bit(uint64_t v){
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int e = 0;
+    while(v >>= 1) e++;
+    return e;
+#endif
+}
+
+static int bucket_index(uint64_t ns){
+    if(ns < uint64_t(LATENCY_SUB_BUCKETS)) return int(ns);
+    int shift = high_bit(ns) - 4; // 16 sub-buckets = the 4 bits under the top one
+    return LATENCY_SUB_BUCKETS + shift*LATENCY_SUB_BUCKETS + int((ns >> shift) - LATENCY_SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucket_upper(int i){
+    if(i < LATENCY_SUB_BUCKETS) return uint64_t(i);
+    int shift = (i - LATENCY_SUB_BUCKETS) / LATENCY_SUB_BUCKETS;
+    int sub = (i - LATENCY_SUB_BUCKETS) % LATENCY_SUB_BUCKETS;
+    return (uint64_t(LATENCY_SUB_BUCKETS + sub + 1) << shift) - 1; // Wraps to 2^64-1 for the last one
+}
+
+LatencyHistogram::LatencyHistogram(){
+    clear();
+}
+
+void LatencyHistogram::clear(){
+    for(int i = 0; i < LATENCY_BUCKETS; i++) buckets[i] = 0;
+    n = 0;
+    min_ns = UINT64_MAX;
+    max_ns = 0;
+    sum_ns = 0;
+}
+
+void LatencyHistogram::add(uint64_t ns){
+    buckets[bucket_index(ns)]++;
+    n++;
+    sum_ns += double(ns);
+    if(ns < min_ns) min_ns = ns;
+    if(ns > max_ns) max_ns = ns;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other){
+    for(int i = 0; i < LATENCY_BUCKETS; i++) buckets[i] += other.buckets[i];
+    n += other.n;
+    sum_ns += other.sum_ns;
+    if(other.min_ns < min_ns) min_ns = other.min_ns;
+    if(other.max_ns > max_ns) max_ns = other.max_ns;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const{
+    if(n == 0) return 0;
+    double target = std::max(1.0, ceil(p / 100.0 * double(n)));
+    uint64_t seen = 0;
+    for(int i = 0; i < LATENCY_BUCKETS; i++){
+        seen += buckets[i];
+        if(double(seen) >= target) return std::min(bucket_upper(i), max_ns);
+    }
+    return max_ns;
+}
+
+// --- Real-time stepper ---
+
+// a = -c/m*v - k/m*x + F/m, with F held over the step.
+struct HeldForceModel{
+    double cm, km, fm;
+    double operator()(double t, double x, double v) const { (void)t; return -cm*v - km*x + fm; }
+};
+
+RealTimeStepper::RealTimeStepper(const MassSpringDamper& s, Solver solver_, bool timing_)
+    : solver(solver_ == Solver::RK45 ? Solver::RK4 : solver_),
+      cm(s.get_c()/s.get_m()), km(s.get_k()/s.get_m()), inv_m(1.0/s.get_m()),
+      x(s.get_xo()), v(s.get_vo()), t(0), force(0), n(0), exact(), map_dt(0),
+      timing(timing_), ns_per_tick(tick_length()), last_ns(0), last_start(0) {}
+
+double RealTimeStepper::step(double dt, double f){
+    uint64_t start = timing ? ticks() : 0;
+
+    force = f;
+    HeldForceModel accel = {cm, km, inv_m*f};
+    double a = accel(t, x, v);
+    switch(solver){
+        case Solver::Euler:  SemiImplicitEuler::step(x, v, t, dt, a, accel); break;
+        case Solver::Verlet: VelocityVerlet::step(x, v, t, dt, a, accel); break;
+        case Solver::Exact: {
+            if(dt != map_dt){
+                double wn = sqrt(km);
+                exact = exact_step_map(wn, cm/(2*wn), dt);
+                map_dt = dt;
+            }
+            const StepMap& P = exact.map;
+            double xn = P.xx*x + P.xv*v + exact.xu*accel.fm;
+            v = P.vx*x + P.vv*v + exact.vu*accel.fm;
+            x = xn;
+            break;
+        }
+        default:             ExplicitRK<ClassicRK4>::step(x, v, t, dt, a, accel); break;
+    }
+    if(abs(x) + abs(v) < FLUSH_LEVEL){
+        x = 0;
+        v = 0;
+    }
+    t += dt;
+    n++;
+
+    if(timing){
+        uint64_t end = ticks();
+        last_ns = uint64_t(double(end - start)*ns_per_tick + 0.5);
+        latency_ns.add(last_ns);
+        if(n > 1){
+            double gap = double(start - last_start)*ns_per_tick;
+            jitter_ns.add(uint64_t(abs(gap - dt*1e9) + 0.5));
+        }
+        last_start = start;
+    }
+    return x;
+}
+
+void RealTimeStepper::reset(double x0, double v0){
+    x = x0;
+    v = v0;
+    t = 0;
+    force = 0;
+    n = 0;
+}
+
+void RealTimeStepper::reset_statistics(){
+    latency_ns.clear();
+    jitter_ns.clear();
+}
+
+// --- Soak test ---
+
+// "85 ns", "2.1 us", "1.3 ms"
+static string format_ns(double ns){
+    ostringstream s;
+    s << fixed;
+    if(ns < 1e3) s << setprecision(0) << ns << " ns";
+    else if(ns < 1e6) s << setprecision(1) << ns/1e3 << " us";
+    else s << setprecision(1) << ns/1e6 << " ms";
+    return s.str();
+}
+
+string latency_summary(const LatencyHistogram& h){
+    return "p50 " + format_ns(double(h.percentile(50))) + ", p99 " + format_ns(double(h.percentile(99)))
+         + ", max " + format_ns(double(h.max()));
+}
+
+SoakResult soak_test(RealTimeStepper& stepper, const SoakOptions& opts, const Forcing* force){
+    SoakResult r = {0, 0, 0, 0, 0, 0};
+    const double dt = (opts.rate > 0) ? 1.0/opts.rate : 1e-4;
+    r.period_ns = (opts.rate > 0) ? 1e9/opts.rate : 0;
+    r.budget_ns = (opts.budget_us > 0) ? opts.budget_us*1e3 : r.period_ns;
+
+    // At least one clock tick: a shorter period would round to 0 and divide by zero below.
+    const Clock::duration period = max(Clock::duration(1), chrono::duration_cast<Clock::duration>(chrono::duration<double, nano>(r.period_ns)));
+    const Clock::duration report = chrono::duration_cast<Clock::duration>(chrono::duration<double>(opts.report_every));
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point stop = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(opts.duration));
+    Clock::time_point next = start, next_report = start + report;
+
+    while(true){
+        if(r.period_ns > 0){
+            // Spin to the start of the period: sleeping would add the scheduler's wake-up delay.
+            Clock::time_point now = Clock::now();
+            while(now < next) now = Clock::now();
+            if(now >= next + period){
+                // Stalled past whole periods: skip them, keeping the original phase.
+                uint64_t missed = uint64_t((now - next) / period);
+                r.late += missed;
+                next += period*missed;
+            }
+            next += period;
+        }
+
+        double f = force ? force->value(stepper.time()) : 0;
+        stepper.step(dt, f);
+        r.steps++;
+        if(r.budget_ns > 0 && double(stepper.last_latency_ns()) > r.budget_ns) r.overruns++;
+
+        Clock::time_point now = Clock::now();
+        if(now >= stop) break;
+        if(opts.report_every > 0 && now >= next_report){
+            // The print itself can make the next period late.
+            cout << "[" << setw(6) << fixed << setprecision(0) << chrono::duration<double>(now - start).count() << " s] "
+                 << r.steps << " steps | latency " << latency_summary(stepper.latency())
+                 << " | jitter " << latency_summary(stepper.jitter())
+                 << " | overruns " << r.overruns << defaultfloat << setprecision(6) << endl;
+            next_report += report;
+        }
+    }
+    r.seconds = chrono::duration<double>(Clock::now() - start).count();
+    return r;
+}
+
+void print_soak_report(const RealTimeStepper& stepper, const SoakResult& result){
+    cout << "Soak test: " << result.steps << " steps in " << fixed << setprecision(1) << result.seconds << " s ("
+         << setprecision(0) << result.steps / result.seconds << " steps/s)" << defaultfloat << setprecision(6) << endl;
+    cout << "Step latency: " << latency_summary(stepper.latency())
+         << " (mean " << format_ns(stepper.latency().mean()) << ")" << endl;
+    if(result.period_ns > 0){
+        cout << "Jitter:       " << latency_summary(stepper.jitter()) << " (period " << format_ns(result.period_ns) << ")" << endl;
+    }
+    if(result.budget_ns > 0){
+        cout << "Budget " << format_ns(result.budget_ns) << ": " << result.overruns << " steps over, "
+             << result.late << " periods missed" << endl;
+    }
+}
@@ -0,0 +1,396 @@
+#include "ResultCache.h"
+#include "TrajectoryFile.h"
+#include <filesystem>
+#include <thread>       // For the temporary file names
+#include <functional>   // std::hash
+#include <cstdio>       // For snprintf
+#include <cstdlib>      // For strtoull
+#include <cstring>      // For memcmp / memcpy / memset
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Summary log (summaries.msds): a sequence of SummaryRecord, native endian.
+const char SUMMARY_MAGIC[8] = {'M','S','D','S','U','M','\0','\0'};
+static const char* LOG_NAME = "summaries.msds";
+
+// Garbage in the log is only worth a rewrite past this size.
+static const uint64_t MIN_COMPACT_BYTES = 64*1024;
+
+struct SummaryRecord{
+    char magic[8];    // SUMMARY_MAGIC
+    CacheKey key;     // Checked on every read, so a hash collision is a miss
+    double peak, settling_time, final_amplitude;
+    int64_t steps;
+    int64_t used;     // Last use (as of the last compaction), file clock ticks
+};
+static_assert(sizeof(SummaryRecord) == 120, "SummaryRecord must stay 120 bytes");
+
+CacheKey make_cache_key(const MassSpringDamper& s, Solver solver, double dt){
+    CacheKey key;
+    memset(&key, 0, sizeof(key));
+    // + 0.0 turns -0.0 into 0.0: both start the same run
+    key.m = s.get_m() + 0.0;
+    key.c = s.get_c() + 0.0;
+    key.k = s.get_k() + 0.0;
+    key.xo = s.get_xo() + 0.0;
+    key.vo = s.get_vo() + 0.0;
+    key.dt = (dt > 0) ? dt : default_dt(s);
+    if(solver == Solver::RK45){
+        key.atol = RK45_ATOL;
+        key.rtol = RK45_RTOL;
+    }
+    key.solver = uint32_t(solver);
+    key.version = CACHE_VERSION;
+    return key;
+}
+
+uint64_t cache_hash(const CacheKey& key){
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&key);
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < sizeof(key); i++){
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static string trajectory_name(uint64_t hash){
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.msdt", static_cast<unsigned long long>(hash));
+    return name;
+}
+
+static bool same_key(const CacheKey& a, const CacheKey& b){
+    return memcmp(&a, &b, sizeof(CacheKey)) == 0;
+}
+
+static int64_t now_ticks(){
+    return int64_t(fs::file_time_type::clock::now().time_since_epoch().count());
+}
+
+// Unique per thread, so concurrent stores of the same entry don't share a file.
+static string temporary_name(const string& name){
+    return name + "." + to_string(hash<thread::id>()(this_thread::get_id())) + ".tmp";
+}
+
+// --- ResultCache ---
+
+ResultCache::ResultCache(const string& directory_, size_t memory_entries, uint64_t disk_bytes)
+    : directory(directory_), memory_limit(memory_entries), disk_limit(disk_bytes){
+    if(directory.empty()) return;
+    lock_guard<mutex> guard(lock);
+
+    error_code ec;
+    fs::create_directories(directory, ec);
+
+    // Trajectories of earlier runs, with their modification time as last use
+    for(fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)){
+        const fs::path& file = it->path();
+        string name = file.filename().string();
+        if(file.extension() == ".tmp"){
+            error_code ignored;
+            fs::remove(file, ignored); // Left over by an interrupted store
+            continue;
+        }
+        if(file.extension() != ".msdt" || name.size() != 16 + 5) continue;
+        char* hex_end;
+        uint64_t hash = strtoull(name.c_str(), &hex_end, 16);
+        error_code size_ec, time_ec;
+        uint64_t bytes = fs::file_size(file, size_ec);
+        fs::file_time_type time = fs::last_write_time(file, time_ec);
+        if(hex_end != name.c_str() + 16 || size_ec || time_ec) continue;
+        add_disk(DiskEntry{hash, true, bytes, 0, int64_t(time.time_since_epoch().count())});
+    }
+    load_log();
+
+    // Most recent first, then trim to the limit
+    disk.sort([](const DiskEntry& a, const DiskEntry& b){ return a.used > b.used; });
+    evict(disk.end());
+}
+
+ResultCache::~ResultCache(){
+    lock_guard<mutex> guard(lock);
+    if(log.is_open()) log.close();
+}
+
+string ResultCache::path(const string& name) const{
+    return (fs::path(directory) / name).string();
+}
+
+// Indexes every complete record of the log and opens it for appending.
+// A truncated last record (interrupted write) is overwritten by the next one.
+void ResultCache::load_log(){
+    string file = path(LOG_NAME);
+    {
+        ofstream create(file, ios::binary | ios::app); // Make sure it exists
+    }
+    log.open(file, ios::in | ios::out | ios::binary);
+    if(!log.is_open()) return;
+
+    SummaryRecord r;
+    uint64_t offset = 0;
+    while(log.read(reinterpret_cast<char*>(&r), sizeof(r))){
+        if(memcmp(r.magic, SUMMARY_MAGIC, sizeof(r.magic)) != 0) break;
+        uint64_t hash = cache_hash(r.key);
+        auto old = disk_summaries.find(hash);
+        if(old != disk_summaries.end()) drop_disk(old->second); // Stored again later: the old one is garbage
+        add_disk(DiskEntry{hash, false, sizeof(r), offset, r.used});
+        offset += sizeof(r);
+    }
+    log.clear();
+    log_end = offset;
+}
+
+// Rewrites the log with the live records only, oldest first.
+void ResultCache::compact_log(){
+    string file = path(LOG_NAME), tmp = path(temporary_name(LOG_NAME));
+    vector<pair<DiskEntry*, uint64_t>> moved; // Entry and its new offset
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if(!out.is_open()) return;
+        uint64_t offset = 0;
+        for(auto it = disk.rbegin(); it != disk.rend(); ++it){
+            if(it->trajectory) continue;
+            SummaryRecord r;
+            log.clear();
+            log.seekg(streamoff(it->offset));
+            if(!log.read(reinterpret_cast<char*>(&r), sizeof(r))) return;
+            r.used = it->used;
+            if(!out.write(reinterpret_cast<const char*>(&r), sizeof(r))) return;
+            moved.push_back({&*it, offset});
+            offset += sizeof(r);
+        }
+    }
+
+    log.close();
+    error_code ec;
+    fs::rename(tmp, file, ec);
+    if(!ec){
+        for(auto& m : moved) m.first->offset = m.second;
+        log_end = uint64_t(moved.size())*sizeof(SummaryRecord);
+        garbage = 0;
+    } else {
+        fs::remove(tmp, ec);
+    }
+    log.open(file, ios::in | ios::out | ios::binary);
+}
+
+ResultCache::DiskIterator ResultCache::add_disk(const DiskEntry& entry){
+    disk.push_front(entry);
+    (entry.trajectory ? disk_trajectories : disk_summaries)[entry.hash] = disk.begin();
+    counters.disk_bytes += entry.bytes;
+    return disk.begin();
+}
+
+void ResultCache::forget(DiskIterator it){
+    counters.disk_bytes -= it->bytes;
+    (it->trajectory ? disk_trajectories : disk_summaries).erase(it->hash);
+    disk.erase(it);
+}
+
+void ResultCache::drop_disk(DiskIterator it){
+    if(it->trajectory){
+        // A mapped file may outlive its entry: POSIX keeps it until unmapped,
+        // and on Windows the removal fails and the next scan picks it up again.
+        error_code ec;
+        fs::remove(path(trajectory_name(it->hash)), ec);
+    } else {
+        garbage += it->bytes;
+    }
+    forget(it);
+}
+
+void ResultCache::use(DiskIterator it){
+    it->used = now_ticks();
+    disk.splice(disk.begin(), disk, it);
+    if(it->trajectory){
+        error_code ec;
+        fs::last_write_time(path(trajectory_name(it->hash)), fs::file_time_type::clock::now(), ec);
+    }
+}
+
+// Evicts from the old end until the disk tier fits its limit, never 'keep'
+// (the entry being stored), then compacts the log if garbage dominates it.
+void ResultCache::evict(DiskIterator keep){
+    while(counters.disk_bytes > disk_limit && !disk.empty() && prev(disk.end()) != keep){
+        drop_disk(prev(disk.end()));
+        counters.evictions++;
+    }
+    if(garbage > MIN_COMPACT_BYTES && garbage > log_end - garbage) compact_log();
+}
+
+void ResultCache::remember(const CacheKey& key, const SimSummary& summary){
+    if(memory_limit == 0) return;
+    uint64_t h = cache_hash(key);
+    auto it = memory_index.find(h);
+    if(it != memory_index.end()){
+        it->second->key = key;
+        it->second->summary = summary;
+        memory.splice(memory.begin(), memory, it->second);
+        return;
+    }
+    memory.push_front(MemoryEntry{key, summary});
+    memory_index[h] = memory.begin();
+    while(memory.size() > memory_limit){
+        memory_index.erase(cache_hash(memory.back().key));
+        memory.pop_back();
+        counters.evictions++;
+    }
+}
+
+bool ResultCache::find_summary(const CacheKey& key, SimSummary& out){
+    lock_guard<mutex> guard(lock);
+    uint64_t h = cache_hash(key);
+
+    auto it = memory_index.find(h);
+    if(it != memory_index.end() && same_key(it->second->key, key)){
+        memory.splice(memory.begin(), memory, it->second);
+        out = it->second->summary;
+        counters.memory_hits++;
+        return true;
+    }
+
+    auto on_disk = disk_summaries.find(h);
+    if(on_disk != disk_summaries.end()){
+        SummaryRecord r;
+        log.clear();
+        log.seekg(streamoff(on_disk->second->offset));
+        if(log.read(reinterpret_cast<char*>(&r), sizeof(r)) && same_key(r.key, key)){
+            out.peak = r.peak;
+            out.settling_time = r.settling_time;
+            out.final_amplitude = r.final_amplitude;
+            out.steps = int(r.steps);
+            remember(key, out);
+            use(on_disk->second);
+            counters.disk_hits++;
+            return true;
+        }
+    }
+    counters.misses++;
+    return false;
+}
+
+void ResultCache::store_summary(const CacheKey& key, const SimSummary& summary){
+    lock_guard<mutex> guard(lock);
+    remember(key, summary);
+    counters.stores++;
+    if(!log.is_open()) return;
+
+    SummaryRecord r;
+    memset(&r, 0, sizeof(r));
+    memcpy(r.magic, SUMMARY_MAGIC, sizeof(r.magic));
+    r.key = key;
+    r.peak = summary.peak;
+    r.settling_time = summary.settling_time;
+    r.final_amplitude = summary.final_amplitude;
+    r.steps = summary.steps;
+    r.used = now_ticks();
+
+    log.clear();
+    log.seekp(streamoff(log_end));
+    if(!log.write(reinterpret_cast<const char*>(&r), sizeof(r)) || !log.flush()) return;
+
+    uint64_t h = cache_hash(key);
+    auto old = disk_summaries.find(h);
+    if(old != disk_summaries.end()) drop_disk(old->second);
+    DiskIterator it = add_disk(DiskEntry{h, false, sizeof(r), log_end, r.used});
+    log_end += sizeof(r);
+    evict(it);
+}
+
+SimSummary ResultCache::summary(const MassSpringDamper& s, Solver solver){
+    CacheKey key = make_cache_key(s, solver);
+    SimSummary out;
+    if(find_summary(key, out)) return out;
+    out = simulate_summary(s, solver);
+    store_summary(key, out);
+    return out;
+}
+
+bool ResultCache::find_trajectory(const CacheKey& key, string& filename){
+    lock_guard<mutex> guard(lock);
+    auto it = disk_trajectories.find(cache_hash(key));
+    if(it != disk_trajectories.end()){
+        // The header repeats the run parameters: check them against the key
+        string name = path(trajectory_name(it->first));
+        ifstream file(name, ios::binary);
+        TrajectoryHeader h;
+        if(file.read(reinterpret_cast<char*>(&h), sizeof(h)) && memcmp(h.magic, TRAJECTORY_MAGIC, sizeof(h.magic)) == 0
+           && h.m == key.m && h.c == key.c && h.k == key.k && h.xo == key.xo && h.vo == key.vo && h.solver == key.solver){
+            filename = name;
+            use(it->second);
+            counters.disk_hits++;
+            return true;
+        }
+    }
+    counters.misses++;
+    return false;
+}
+
+bool ResultCache::store_trajectory(const CacheKey& key, const string& filename){
+    if(directory.empty()) return false;
+    uint64_t h = cache_hash(key);
+    string name = path(trajectory_name(h)), tmp = path(temporary_name(trajectory_name(h)));
+
+    // Copied aside and renamed, so a reader never maps half a file.
+    error_code ec;
+    fs::copy_file(filename, tmp, fs::copy_options::overwrite_existing, ec);
+    if(!ec) fs::rename(tmp, name, ec);
+    if(ec){
+        fs::remove(tmp, ec);
+        return false;
+    }
+    uint64_t bytes = fs::file_size(name, ec);
+
+    lock_guard<mutex> guard(lock);
+    counters.stores++;
+    auto old = disk_trajectories.find(h);
+    if(old != disk_trajectories.end()) forget(old->second); // Same file, just replaced
+    evict(add_disk(DiskEntry{h, true, bytes, 0, now_ticks()}));
+    return true;
+}
+
+bool ResultCache::trajectory(const MassSpringDamper& s, Solver solver, TrajectoryFile& view){
+    if(directory.empty()) return false;
+    CacheKey key = make_cache_key(s, solver);
+    string filename;
+    if(find_trajectory(key, filename)) return view.open(filename);
+
+    // Integrate into a temporary file, then store it like any finished run
+    string tmp = path(temporary_name("run.msdt"));
+    bool written;
+    {
+        BinaryStreamWriter file(tmp, false);
+        if(!file.is_open()) return false;
+        simulate(s, solver, file);
+        written = file.ok();
+    }
+    bool stored = written && store_trajectory(key, tmp);
+    error_code ec;
+    fs::remove(tmp, ec);
+    // Opened by name, not through find_trajectory(): this miss must not count a disk hit too.
+    // It fails only if the store evicted the file right away (a cache smaller than one run).
+    return stored && view.open(path(trajectory_name(cache_hash(key))));
+}
+
+CacheStats ResultCache::stats() const{
+    lock_guard<mutex> guard(lock);
+    CacheStats out = counters;
+    out.memory_entries = memory.size();
+    out.disk_entries = disk.size();
+    return out;
+}
+
+void ResultCache::clear(){
+    lock_guard<mutex> guard(lock);
+    while(!disk.empty()) drop_disk(disk.begin());
+    memory.clear();
+    memory_index.clear();
+    if(log.is_open()){
+        log.close();
+        log.open(path(LOG_NAME), ios::in | ios::out | ios::binary | ios::trunc);
+    }
+    log_end = 0;
+    garbage = 0;
+}
@@ -0,0 +1,614 @@
+#include "Server.h"
+#include "Batch.h"          // For simulate_summaries
+#include "ThreadPool.h"
+#include "Trace.h"          // MSD_TRACE_* (empty unless built with MSD_TRACE)
+#include <iostream>
+#include <cstring>
+#include <climits>      // For INT_MAX
+#include <algorithm>    // std::min
+#include <iterator>     // std::make_move_iterator
+#ifndef _WIN32
+#define MSD_HAS_UNIX_SOCKETS 1
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>   // For timeval (SO_SNDTIMEO)
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const char REQUEST_MAGIC[4] = {'M', 'S', 'D', 'Q'};
+static const char REPLY_MAGIC[4] = {'M', 'S', 'D', 'R'};
+
+// Samples per Samples frame (32 kB of payload).
+static const size_t SERVER_CHUNK_SAMPLES = 1024;
+
+// Summary requests per pool task: one call of the SIMD kernel.
+static const size_t SERVER_GRAIN = 64;
+
+static const size_t SOLVER_COUNT = size_t(Solver::Exact) + 1;
+
+ServerRequest make_request(RequestType type, uint64_t id, const MassSpringDamper& s, Solver solver,
+                           const OutputPolicy& policy, double dt){
+    ServerRequest r;
+    memset(&r, 0, sizeof(r));
+    memcpy(r.magic, REQUEST_MAGIC, 4);
+    r.type = uint32_t(type);
+    r.id = id;
+    r.m = s.get_m();
+    r.c = s.get_c();
+    r.k = s.get_k();
+    r.xo = s.get_xo();
+    r.vo = s.get_vo();
+    r.dt = dt;
+    r.interval = policy.interval;
+    r.solver = uint32_t(solver);
+    r.output = uint32_t(policy.mode);
+    r.every = uint32_t(policy.every);
+    return r;
+}
+
+static ServerReply make_reply(uint64_t id, ReplyKind kind, ReplyStatus status){
+    ServerReply r;
+    memset(&r, 0, sizeof(r));
+    memcpy(r.magic, REPLY_MAGIC, 4);
+    r.status = uint32_t(status);
+    r.id = id;
+    r.kind = uint32_t(kind);
+    return r;
+}
+
+// Checks a request before it is queued. BadRequest means the stream can't be trusted any more.
+static ReplyStatus check_request(const ServerRequest& r){
+    if(memcmp(r.magic, REQUEST_MAGIC, 4) != 0 || r.type > uint32_t(RequestType::Stats)) return ReplyStatus::BadRequest;
+    if(r.type == uint32_t(RequestType::Stats)) return ReplyStatus::Ok;
+    if(r.solver >= SOLVER_COUNT || r.output > uint32_t(OutputMode::Events)) return ReplyStatus::BadRequest;
+    if(r.output == uint32_t(OutputMode::EveryNth) && (r.every < 1 || r.every > uint32_t(INT_MAX))) return ReplyStatus::BadRequest;
+    if(r.output == uint32_t(OutputMode::FixedInterval) && !(r.interval > 0)) return ReplyStatus::BadRequest;
+    if(!(r.dt >= 0)) return ReplyStatus::BadRequest;
+
+    MassSpringDamper s;
+    int e[5] = {0,0,0,0,0};
+    s.validate_parameters(e, r.m, r.c, r.k, r.xo, r.vo);
+    if(!(e[0]==1 && e[1]==1 && e[2]==1 && e[3]==1 && e[4]==1)) return ReplyStatus::InvalidParameters;
+
+    // Trajectories: the step budget of run (summaries always take default_dt())
+    if(r.type == uint32_t(RequestType::Trajectory) && r.dt > 0 && Solver(r.solver) != Solver::RK45){
+        s.set_parameters(r.m, r.c, r.k, r.xo, r.vo);
+        if(fixed_step_count(s, r.dt) > MAX_FIXED_STEPS) return ReplyStatus::InvalidParameters;
+    }
+    return ReplyStatus::Ok;
+}
+
+static MassSpringDamper request_system(const ServerRequest& r){
+    MassSpringDamper s;
+    s.set_parameters(r.m, r.c, r.k, r.xo, r.vo);
+    return s;
+}
+
+#ifdef MSD_HAS_UNIX_SOCKETS
+
+// A peer that went away must not kill the server with SIGPIPE.
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static void no_sigpipe(int fd){
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)fd;
+#endif
+}
+
+// A blocked send() gives up after 'seconds' (EAGAIN), so a client that stops
+// reading can't hold a pool worker forever.
+static void send_timeout(int fd, double seconds){
+    timeval tv;
+    tv.tv_sec = time_t(seconds);
+    tv.tv_usec = suseconds_t((seconds - double(tv.tv_sec))*1e6);
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static bool send_all(int fd, const void* data, size_t bytes){
+    const char* p = static_cast<const char*>(data);
+    while(bytes > 0){
+        ssize_t n = ::send(fd, p, bytes, SEND_FLAGS);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        p += n;
+        bytes -= size_t(n);
+    }
+    return true;
+}
+
+// False on end of stream or error.
+static bool recv_all(int fd, void* data, size_t bytes){
+    char* p = static_cast<char*>(data);
+    while(bytes > 0){
+        ssize_t n = ::recv(fd, p, bytes, 0);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        p += n;
+        bytes -= size_t(n);
+    }
+    return true;
+}
+
+static bool make_address(const string& path, sockaddr_un& addr){
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.empty() || path.size() >= sizeof(addr.sun_path)){
+        cout << "Error: bad socket path '" << path << "' (at most " << sizeof(addr.sun_path) - 1 << " characters)" << endl;
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// --- SimulationServer ---
+
+// One client. Replies come from several pool workers, so every frame is sent
+// whole under write_lock. The socket closes with the last reference.
+struct SimulationServer::Connection{
+    int fd;
+    mutex write_lock;
+    bool broken = false;           // A send failed or timed out: drop the remaining replies
+    atomic<bool> reading{true};    // Reader thread still running
+
+    mutex pending_lock;
+    condition_variable pending_done;
+    size_t pending = 0;            // Requests queued or running
+    bool closing = false;          // Broken or server stopping: the reader stops waiting
+
+    explicit Connection(int fd_) : fd(fd_) {}
+    ~Connection(){ ::close(fd); }
+
+    bool send_frame(const ServerReply& reply, const void* payload = nullptr, size_t bytes = 0){
+        lock_guard<mutex> guard(write_lock);
+        if(broken) return false;
+        if(!send_all(fd, &reply, sizeof(reply)) || (bytes > 0 && !send_all(fd, payload, bytes))){
+            // Half a frame may have gone out: the stream is lost, so end the reader too.
+            broken = true;
+            ::shutdown(fd, SHUT_RDWR);
+            close_reading();
+        }
+        return !broken;
+    }
+
+    bool is_broken(){
+        lock_guard<mutex> guard(write_lock);
+        return broken;
+    }
+
+    // Reader: waits until fewer than 'limit' requests are pending, then counts one more.
+    // False once the connection is closing.
+    bool acquire(size_t limit){
+        unique_lock<mutex> guard(pending_lock);
+        pending_done.wait(guard, [&]{ return closing || pending < limit; });
+        if(closing) return false;
+        pending++;
+        return true;
+    }
+
+    // Worker: one request answered.
+    void release(){
+        {
+            lock_guard<mutex> guard(pending_lock);
+            pending--;
+        }
+        pending_done.notify_one();
+    }
+
+    void close_reading(){
+        {
+            lock_guard<mutex> guard(pending_lock);
+            closing = true;
+        }
+        pending_done.notify_one();
+    }
+};
+
+SimulationServer::SimulationServer(const ServerOptions& options_) : options(options_) {}
+
+SimulationServer::~SimulationServer(){
+    stop();
+}
+
+bool SimulationServer::start(){
+    if(listen_fd >= 0) return true;
+    sockaddr_un addr;
+    if(!make_address(options.socket_path, addr)) return false;
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0){
+        cout << "Error: could not create a socket" << endl;
+        return false;
+    }
+    // A socket file nobody answers on is left over from an old run: replace it.
+    if(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0){
+        ::close(fd);
+        cout << "Error: a server is already running on '" << options.socket_path << "'" << endl;
+        return false;
+    }
+    ::close(fd);
+    ::unlink(options.socket_path.c_str());
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0){
+        if(fd >= 0) ::close(fd);
+        cout << "Error: could not listen on '" << options.socket_path << "'" << endl;
+        return false;
+    }
+    listen_fd = fd;
+
+    pool.reset(new ThreadPool(options.threads));
+    stopping = false;
+    started = Clock::now();
+    acceptor = thread(&SimulationServer::accept_loop, this);
+    dispatcher = thread(&SimulationServer::dispatch_loop, this);
+    return true;
+}
+
+void SimulationServer::stop(){
+    if(listen_fd < 0) return;
+    {
+        lock_guard<mutex> guard(queue_lock);
+        stopping = true;
+    }
+    // Wakes accept() (EINVAL), then every reader (end of stream); replies can still go out.
+    ::shutdown(listen_fd, SHUT_RDWR);
+    acceptor.join();
+    ::close(listen_fd);
+    listen_fd = -1;
+    {
+        lock_guard<mutex> guard(readers_lock);
+        for(Reader& r : readers){
+            ::shutdown(r.conn->fd, SHUT_RD);
+            r.conn->close_reading();
+        }
+        for(Reader& r : readers) r.thread.join();
+        readers.clear();
+    }
+    queue_ready.notify_all();
+    dispatcher.join();
+    pool.reset(); // Waits for the queued work
+    ::unlink(options.socket_path.c_str());
+}
+
+void SimulationServer::accept_loop(){
+    MSD_TRACE_THREAD("acceptor", -1);
+    while(true){
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if(fd < 0){
+            {
+                lock_guard<mutex> guard(queue_lock);
+                if(stopping) return;
+            }
+            if(errno != EINTR) this_thread::sleep_for(chrono::milliseconds(1)); // Out of descriptors: back off
+            continue;
+        }
+        no_sigpipe(fd);
+        if(options.send_timeout_s > 0) send_timeout(fd, options.send_timeout_s);
+        shared_ptr<Connection> conn = make_shared<Connection>(fd);
+
+        lock_guard<mutex> guard(readers_lock);
+        // Reap the readers of clients that have gone
+        for(auto it = readers.begin(); it != readers.end();){
+            if(it->conn->reading) { ++it; continue; }
+            it->thread.join();
+            it = readers.erase(it);
+        }
+        readers.push_back(Reader{thread(&SimulationServer::read_loop, this, conn), conn});
+    }
+}
+
+void SimulationServer::read_loop(shared_ptr<Connection> conn){
+    const size_t max_pending = max<size_t>(1, options.max_pending);
+    ServerRequest r;
+    while(recv_all(conn->fd, &r, sizeof(r))){
+        n_requests++;
+        ReplyStatus status = check_request(r);
+        if(status != ReplyStatus::Ok){
+            conn->send_frame(make_reply(r.id, ReplyKind::Error, status));
+            if(status == ReplyStatus::BadRequest) break; // Out of step with the client
+            continue;
+        }
+        if(r.type == uint32_t(RequestType::Stats)){
+            ServerStats st = stats();
+            ServerReply reply = make_reply(r.id, ReplyKind::Stats, ReplyStatus::Ok);
+            const double values[8] = {st.requests, st.completed, st.queued, st.in_flight, st.batches, st.batched, st.samples, st.seconds};
+            memcpy(reply.values, values, sizeof(values));
+            conn->send_frame(reply);
+            continue;
+        }
+        // Backpressure: past max_pending the reader stops taking requests off the socket.
+        if(!conn->acquire(max_pending)) break;
+        {
+            lock_guard<mutex> guard(queue_lock);
+            queue.push_back(Pending{conn, r});
+        }
+        queue_ready.notify_one();
+    }
+    conn->reading = false;
+}
+
+void SimulationServer::dispatch_loop(){
+    MSD_TRACE_THREAD("dispatcher", -1);
+    const auto window = chrono::duration<double, micro>(options.batch_window_us);
+    const size_t batch_max = max<size_t>(1, options.batch_max);
+    while(true){
+        vector<Pending> batch;
+        {
+            unique_lock<mutex> guard(queue_lock);
+            queue_ready.wait(guard, [this]{ return stopping || !queue.empty(); });
+            if(queue.empty()) return; // Stopping, and nothing left to do
+            if(!stopping && queue.size() < batch_max){
+                // Give concurrent clients a moment to join the batch
+                queue_ready.wait_for(guard, window, [&]{ return stopping || queue.size() >= batch_max; });
+            }
+            size_t n = min(queue.size(), batch_max);
+            batch.assign(make_move_iterator(queue.begin()), make_move_iterator(queue.begin() + n));
+            queue.erase(queue.begin(), queue.begin() + n);
+        }
+        n_in_flight += batch.size();
+
+        // Trajectories run one per task; summaries are grouped by solver and
+        // split into kernel-sized chunks.
+        vector<Pending> by_solver[SOLVER_COUNT];
+        for(Pending& p : batch){
+            if(p.request.type == uint32_t(RequestType::Trajectory)) pool->submit([this, p]{ run_trajectory(p); });
+            else by_solver[p.request.solver].push_back(move(p));
+        }
+        for(vector<Pending>& group : by_solver){
+            if(group.empty()) continue;
+            n_batches++;
+            n_batched += group.size();
+            for(size_t begin = 0; begin < group.size(); begin += SERVER_GRAIN){
+                size_t end = min(group.size(), begin + SERVER_GRAIN);
+                vector<Pending> chunk(make_move_iterator(group.begin() + begin), make_move_iterator(group.begin() + end));
+                pool->submit([this, chunk]{ run_summaries(chunk); });
+            }
+        }
+    }
+}
+
+void SimulationServer::run_summaries(vector<Pending> batch){
+    MSD_TRACE_SCOPE(scope, "server batch");
+    const size_t n = batch.size();
+    MassSpringDamper systems[SERVER_GRAIN];
+    SimSummary out[SERVER_GRAIN];
+    for(size_t i = 0; i < n; i++) systems[i] = request_system(batch[i].request);
+    simulate_summaries(systems, n, Solver(batch[0].request.solver), out);
+
+    for(size_t i = 0; i < n; i++){
+        ServerReply reply = make_reply(batch[i].request.id, ReplyKind::Summary, ReplyStatus::Ok);
+        reply.values[0] = out[i].peak;
+        reply.values[1] = out[i].settling_time;
+        reply.values[2] = out[i].final_amplitude;
+        reply.values[3] = out[i].steps;
+        batch[i].conn->send_frame(reply);
+        batch[i].conn->release();
+    }
+    n_completed += n;
+    n_in_flight -= n;
+}
+
+void SimulationServer::run_trajectory(const Pending& p){
+    MSD_TRACE_SCOPE(scope, "server trajectory");
+    const ServerRequest& r = p.request;
+    if(p.conn->is_broken()){
+        // Nobody would get the samples: skip the integration.
+        p.conn->release();
+        n_in_flight--;
+        return;
+    }
+
+    // Collects samples into Samples frames.
+    struct SocketSink : public TrajectorySink{
+        Connection& conn;
+        uint64_t id;
+        double buffer[4*SERVER_CHUNK_SAMPLES];
+        size_t n = 0;
+        uint64_t sent = 0;
+        SocketSink(Connection& conn_, uint64_t id_) : conn(conn_), id(id_) {}
+        void write(double t, double x, double v, double a) override {
+            double* b = buffer + 4*n;
+            b[0] = t; b[1] = x; b[2] = v; b[3] = a;
+            if(++n == SERVER_CHUNK_SAMPLES) flush();
+        }
+        void close() override { flush(); }
+        void flush(){
+            if(n == 0) return;
+            ServerReply reply = make_reply(id, ReplyKind::Samples, ReplyStatus::Ok);
+            reply.count = uint32_t(n);
+            // A client that hung up only costs the integration: nothing more is sent.
+            if(conn.send_frame(reply, buffer, 4*n*sizeof(double))) sent += n;
+            n = 0;
+        }
+    };
+
+    OutputPolicy policy;
+    policy.mode = OutputMode(r.output);
+    policy.every = int(r.every);
+    policy.interval = r.interval;
+
+    unique_ptr<SocketSink> sink(new SocketSink(*p.conn, r.id)); // 32 kB: kept off the worker's stack
+    DecimatingSink out(*sink, policy);
+    StepStats stats = simulate(request_system(r), Solver(r.solver), out, r.dt);
+    MSD_TRACE_RUN(scope, stats);
+
+    ServerReply end = make_reply(r.id, ReplyKind::End, ReplyStatus::Ok);
+    end.values[0] = stats.accepted;
+    end.values[1] = stats.rejected;
+    end.values[2] = double(int(stats.stop));
+    end.values[3] = double(sink->sent);
+    p.conn->send_frame(end);
+    p.conn->release();
+
+    n_samples += sink->sent;
+    n_completed++;
+    n_in_flight--;
+}
+
+ServerStats SimulationServer::stats(){
+    ServerStats out;
+    {
+        lock_guard<mutex> guard(queue_lock);
+        out.queued = double(queue.size());
+    }
+    out.requests = double(n_requests.load());
+    out.completed = double(n_completed.load());
+    out.in_flight = double(n_in_flight.load());
+    out.batches = double(n_batches.load());
+    out.batched = double(n_batched.load());
+    out.samples = double(n_samples.load());
+    out.seconds = chrono::duration<double>(Clock::now() - started).count();
+    return out;
+}
+
+// --- ServerClient ---
+
+ServerClient::~ServerClient(){
+    close();
+}
+
+bool ServerClient::connect(const string& socket_path){
+    close();
+    sockaddr_un addr;
+    if(!make_address(socket_path, addr)) return false;
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0){
+        cout << "Error: could not connect to '" << socket_path << "'" << endl;
+        close();
+        return false;
+    }
+    no_sigpipe(fd);
+    return true;
+}
+
+void ServerClient::close(){
+    if(fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+bool ServerClient::send(const ServerRequest& request){
+    return fd >= 0 && send_all(fd, &request, sizeof(request));
+}
+
+bool ServerClient::receive(ServerReply& reply, vector<double>* samples){
+    if(fd < 0 || !recv_all(fd, &reply, sizeof(reply)) || memcmp(reply.magic, REPLY_MAGIC, 4) != 0) return false;
+    if(reply.kind != uint32_t(ReplyKind::Samples) || reply.count == 0) return true;
+
+    size_t values = 4*size_t(reply.count);
+    if(samples){
+        size_t old = samples->size();
+        samples->resize(old + values);
+        return recv_all(fd, samples->data() + old, values*sizeof(double));
+    }
+    double skip[4*SERVER_CHUNK_SAMPLES];
+    while(values > 0){
+        size_t n = min(values, 4*SERVER_CHUNK_SAMPLES);
+        if(!recv_all(fd, skip, n*sizeof(double))) return false;
+        values -= n;
+    }
+    return true;
+}
+
+bool ServerClient::summary(const MassSpringDamper& s, Solver solver, SimSummary& out, ReplyStatus* status){
+    const uint64_t id = 1;
+    if(!send(make_request(RequestType::Summary, id, s, solver))) return false;
+    ServerReply reply;
+    do{
+        if(!receive(reply)) return false;
+    } while(reply.id != id);
+    if(status) *status = ReplyStatus(reply.status);
+    if(reply.kind != uint32_t(ReplyKind::Summary)) return false;
+    out.peak = reply.values[0];
+    out.settling_time = reply.values[1];
+    out.final_amplitude = reply.values[2];
+    out.steps = int(reply.values[3]);
+    return true;
+}
+
+bool ServerClient::trajectory(const MassSpringDamper& s, Solver solver, const OutputPolicy& policy, double dt,
+                              TrajectorySink& out, StepStats* stats, ReplyStatus* status){
+    const uint64_t id = 1;
+    if(!send(make_request(RequestType::Trajectory, id, s, solver, policy, dt))) return false;
+
+    out.begin(s, solver, (solver == Solver::RK45) ? 0 : (dt > 0) ? dt : default_dt(s));
+    vector<double> samples;
+    ServerReply reply;
+    while(true){
+        samples.clear();
+        if(!receive(reply, &samples)) return false;
+        if(reply.id != id) continue;
+        if(status) *status = ReplyStatus(reply.status);
+        if(reply.kind == uint32_t(ReplyKind::Samples)){
+            for(size_t i = 0; i < samples.size(); i += 4) out.write(samples[i], samples[i + 1], samples[i + 2], samples[i + 3]);
+            continue;
+        }
+        if(reply.kind != uint32_t(ReplyKind::End)) return false;
+        out.close();
+        if(stats){
+            stats->accepted = int(reply.values[0]);
+            stats->rejected = int(reply.values[1]);
+            stats->stop = StopReason(int(reply.values[2]));
+        }
+        return true;
+    }
+}
+
+bool ServerClient::stats(ServerStats& out){
+    const uint64_t id = 1;
+    MassSpringDamper unused;
+    unused.set_parameters(1, 0, 1, 0, 0);
+    if(!send(make_request(RequestType::Stats, id, unused, Solver::RK4))) return false;
+    ServerReply reply;
+    do{
+        if(!receive(reply)) return false;
+    } while(reply.id != id);
+    if(reply.kind != uint32_t(ReplyKind::Stats)) return false;
+    double* fields[8] = {&out.requests, &out.completed, &out.queued, &out.in_flight, &out.batches, &out.batched, &out.samples, &out.seconds};
+    for(int i = 0; i < 8; i++) *fields[i] = reply.values[i];
+    return true;
+}
+
+#else // No Unix domain sockets
+
+struct SimulationServer::Connection{};
+
+SimulationServer::SimulationServer(const ServerOptions& options_) : options(options_) {}
+SimulationServer::~SimulationServer() {}
+
+bool SimulationServer::start(){
+    cout << "Error: the simulation server needs Unix domain sockets (POSIX)" << endl;
+    return false;
+}
+
+void SimulationServer::stop() {}
+
+ServerStats SimulationServer::stats(){ return ServerStats(); }
+
+ServerClient::~ServerClient() {}
+
+bool ServerClient::connect(const string& socket_path){
+    (void)socket_path;
+    cout << "Error: the simulation server needs Unix domain sockets (POSIX)" << endl;
+    return false;
+}
+
+void ServerClient::close() {}
+bool ServerClient::send(const ServerRequest&){ return false; }
+bool ServerClient::receive(ServerReply&, vector<double>*){ return false; }
+bool ServerClient::summary(const MassSpringDamper&, Solver, SimSummary&, ReplyStatus*){ return false; }
+bool ServerClient::trajectory(const MassSpringDamper&, Solver, const OutputPolicy&, double, TrajectorySink&, StepStats*, ReplyStatus*){ return false; }
+bool ServerClient::stats(ServerStats&){ return false; }
+
+#endif
@@ -1,133 +1,491 @@
-#include "simulation.h"
-#include "utils.h"      // For export_results()
-#include <vector>
+#include "Simulation.h"
+#include "Trajectory.h"     // For TrajectorySink
+#include "TrajectoryFile.h" // For BinaryStreamWriter
+#include "OutputPolicy.h"   // For DecimatingSink
+#include "Analytic.h"   // For ErrorTracker, exact_step_map
+#include "Forcing.h"    // For Forcing
+#include "Steppers.h"   // Methods and tableaus
+#include "Trace.h"      // MSD_TRACE_* (empty unless built with MSD_TRACE)
+#include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <algorithm>    // std::min
+#include <limits>       // For numeric_limits
+#include <type_traits>  // std::is_same
 
 using namespace std; 
 
-void euler(const MassSpringDamper& s){
-    vector<double> a, v, x, t;
-    double dt;
-
-    // Robust dt logic: scale dt to system frequency, but cap at 0.01s.
-    dt = min(0.1 / s.get_wn(), 0.01);
-
-    // Set initial conditions [t=0]
-    v.push_back(s.get_vo());
-    x.push_back(s.get_xo());
-    t.push_back(0);
-    a.push_back(-(s.get_c()/s.get_m())*v[0] - (s.get_k()/s.get_m())*x[0]);
-
-    int first_peak = 0, second_peak = 0, ref_peak = 0, count = 0;
-
-    // Main integration loop (max 100 natural periods)
-    for(int i = 1; i < int((100 * s.get_T())/dt); i++){
-
-        // --- Semi-Implicit Euler (a -> v -> x) ---
-        // More stable for oscillators than explicit Euler.
-        a.push_back(-(s.get_c()/s.get_m())*v[i-1] - (s.get_k()/s.get_m())*x[i-1]); 
-        v.push_back(v[i-1] + a[i]*dt); // v[i] uses new a[i]
-        x.push_back(x[i-1] + v[i]*dt); // x[i] uses new v[i]
-        t.push_back(i*dt);
-
-        // --- Optimized Stop Logic ---
-        if(s.get_zeta() <= 1){ // Oscillating systems
-            // Find peaks and break if amplitude is < 2% of first peak.
-            if(i > 2 && abs(x[i-2]) < abs(x[i-1]) && abs(x[i-1]) > abs(x[i])){
-                if(count == 0) { first_peak = i-1; ref_peak = i-1; }
-                if(count == 1) { second_peak = i-1; }
-                if(count > 1)  { first_peak = second_peak; second_peak = i - 1; }
-                if(count > 0 && abs(x[first_peak]) < 0.02*abs(x[ref_peak]) && abs(x[second_peak]) < 0.02*abs(x[ref_peak])){
-                    break; 
-                }
-                count++;
+// --- Acceleration models ---
+// The drive loops below take the right-hand side as a small functor:
+// a(t, x, v), plus an optional impulse that makes the velocity jump by
+// impulse_dv() at discontinuity() (infinity = never). In linear models a is
+// a fixed linear function of (x, v), which the fixed-step loop exploits; the
+// others add an input u(t) = F(t)/m to it, which the exact solver holds over a step.
+
+// Free response: a = -c/m*v - k/m*x (cm and km computed once per run).
+struct FreeModel{
+    static const bool linear = true;
+    double cm, km;
+    explicit FreeModel(const MassSpringDamper& s) : cm(s.get_c()/s.get_m()), km(s.get_k()/s.get_m()) {}
+    double operator()(double t, double x, double v) const { (void)t; return -cm*v - km*x; }
+    double input(double t) const { (void)t; return 0; }
+    double discontinuity() const { return numeric_limits<double>::infinity(); }
+    double impulse_dv() const { return 0; }
+};
+
+// Forced response: a = -c/m*v - k/m*x + F(t)/m.
+struct ForcedModel{
+    static const bool linear = false;
+    double cm, km, inv_m;
+    const Forcing& force;
+    ForcedModel(const MassSpringDamper& s, const Forcing& f)
+        : cm(s.get_c()/s.get_m()), km(s.get_k()/s.get_m()), inv_m(1.0/s.get_m()), force(f) {}
+    double operator()(double t, double x, double v) const { return -cm*v - km*x + inv_m*force.value(t); }
+    double input(double t) const { return inv_m*force.value(t); }
+    double discontinuity() const { return force.discontinuity(); }
+    double impulse_dv() const { return (force.type == ForceType::Impulse) ? inv_m*force.amplitude : 0; }
+};
+
+// Robust dt logic: scale dt to system frequency, but cap at 0.01s.
+double default_dt(const MassSpringDamper& s){
+    return min(0.1 / s.get_wn(), 0.01);
+}
+
+double fixed_step_count(const MassSpringDamper& s, double dt, double t_end){
+    return (t_end > 0) ? round(t_end/dt) : floor((100 * s.get_T())/dt);
+}
+
+// Loop bound of a run of n steps (in double, as computed), capped so it fits the int counter.
+static int step_bound(double n){
+    return int(min(n, MAX_FIXED_STEPS + 1));
+}
+
+// --- Stop policies ---
+// done(i, t, x) runs after step i (ending at t with position x); true ends the
+// run for 'reason'. The drive functions pick one per run, so the loops carry no
+// regime test.
+
+// Underdamped / critical: stop once two consecutive peaks are under 2% of the
+// first one. Only the last three positions and three peak values are kept.
+struct PeakStop{
+    static const StopReason reason = StopReason::Settled;
+    double x1, x2; // x[i-1] and x[i-2]
+    double ref_peak = 0, first_peak = 0, second_peak = 0;
+    int count = 0;
+    explicit PeakStop(double x0) : x1(x0), x2(x0) {}
+    bool done(int i, double, double x){
+        if(i > 2 && abs(x2) < abs(x1) && abs(x1) > abs(x)){
+            if(count == 0) { first_peak = x1; ref_peak = x1; }
+            if(count == 1) { second_peak = x1; }
+            if(count > 1)  { first_peak = second_peak; second_peak = x1; }
+            if(count > 0 && abs(first_peak) < 0.02*abs(ref_peak) && abs(second_peak) < 0.02*abs(ref_peak)){
+                return true;
             }
+            count++;
         }
-        else { // Overdamped systems
-            // No peaks. Just stop after 2 periods.
-            if(i == int(2*s.get_T()/dt)){
-                break;
-            }
+        x2 = x1;
+        x1 = x;
+        return false;
+    }
+};
+
+// Overdamped: no peaks. Just stop after 2 periods (in steps, or in time for RK45).
+struct StepLimit{
+    static const StopReason reason = StopReason::TwoPeriods;
+    int n;
+    bool done(int i, double, double) const { return i == n; }
+};
+struct TimeLimit{
+    static const StopReason reason = StopReason::TwoPeriods;
+    double t_over;
+    bool done(int, double t, double) const { return t >= t_over; }
+};
+
+// Fixed span (stop logic off): the loop bound ends the run.
+struct NoStop{
+    static const StopReason reason = StopReason::EndTime;
+    bool done(int, double, double) const { return false; }
+};
+
+// --- Drive loops ---
+// Both call sample(t, x, v, a) after every step; the sample functor is the
+// output policy (sink, summary metrics, ...) and is inlined like the rest.
+
+// On a linear model one step of any method is a fixed linear map
+// [x', v', a_out] = P [x, v]. It is found once per run by stepping the unit
+// states, after which a step costs 6 multiplies and 4 adds whatever the method
+// (and only two of them are on the step-to-step dependency chain).
+template<class Method, class Model>
+static StepMap step_map(const Model& accel, double dt){
+    StepMap P;
+    double x = 1, v = 0;
+    P.ax = Method::step(x, v, 0, dt, accel(0, x, v), accel);
+    P.xx = x; P.vx = v;
+    x = 0; v = 1;
+    P.av = Method::step(x, v, 0, dt, accel(0, x, v), accel);
+    P.xv = x; P.vv = v;
+    return P;
+}
+
+// Exact solver: no stepping method, but the exact map of the model's linear
+// part (wn^2 = k/m, 2*zeta*wn = c/m) plus the input held over the step.
+struct ExactStep{};
+
+template<class Model>
+static ExactStepMap model_exact_map(const Model& accel, double dt){
+    const double wn = sqrt(accel.km);
+    return exact_step_map(wn, accel.cm/(2*wn), dt);
+}
+
+// Reason of a run that used up its step or time budget: the end time when the
+// stop logic is off, the 100-period cap otherwise.
+template<class Stop>
+static StopReason budget_reason(){
+    return (Stop::reason == StopReason::EndTime) ? StopReason::EndTime : StopReason::PeriodLimit;
+}
+
+// Fixed-step loop of any method and stop policy, for at most n_max - 1 steps.
+// An impulse is applied at the step boundary nearest to it.
+template<class Method, class Model, class Stop, class Sample>
+static StepStats fixed_loop(double x, double v, const Model& accel, double dt, int n_max, Stop stop, Sample&& sample){
+    double t_kick = accel.discontinuity();
+    const double dv_kick = accel.impulse_dv();
+    constexpr bool exact = is_same<Method, ExactStep>::value;
+    ExactStepMap Z = {};
+    StepMap P = {};
+    if constexpr (exact) { Z = model_exact_map(accel, dt); P = Z.map; }
+    else if constexpr (Model::linear) P = step_map<Method>(accel, dt);
+    StepStats stats = {0, 0, budget_reason<Stop>()};
+
+    for(int i = 1; i < n_max; i++){
+        const double t = (i - 1)*dt;
+        if(dv_kick != 0 && t >= t_kick - dt/2){
+            v += dv_kick;
+            t_kick = numeric_limits<double>::infinity();
+        }
+
+        double a_out;
+        if constexpr (Model::linear){
+            a_out = P.ax*x + P.av*v;
+            double xn = P.xx*x + P.xv*v;
+            v = P.vx*x + P.vv*v;
+            x = xn;
+        } else if constexpr (exact){
+            const double u = accel.input(t);
+            double xn = P.xx*x + P.xv*v + Z.xu*u;
+            v = P.vx*x + P.vv*v + Z.vu*u;
+            x = xn;
+            a_out = accel(t + dt, x, v);
+        } else {
+            a_out = Method::step(x, v, t, dt, accel(t, x, v), accel);
+        }
+        sample(i*dt, x, v, a_out);
+        stats.accepted = i;
+        if(stop.done(i, i*dt, x)){
+            stats.stop = Stop::reason;
+            break;
         }
     }
-    export_results(t, x, v, a);
+    return stats;
 }
 
-void rk4(const MassSpringDamper& s){
-    vector<double> a, v, x, t;
-    double dt, avgx, avgv,newx, newv, newa;
-    double kx1, kx2, kx3, kx4, xmid, xmidbett, xfin;
-    double kv1, kv2, kv3, kv4, vmid, vmidbett, vfin;
-
-    dt = min(0.1 / s.get_wn(), 0.01); 
-
-    // Set initial conditions [t=0]
-    v.push_back(s.get_vo());
-    x.push_back(s.get_xo());
-    t.push_back(0);
-    a.push_back(-(s.get_c()/s.get_m())*v[0] - (s.get_k()/s.get_m())*x[0]);
-
-    int first_peak = 0, second_peak = 0, ref_peak = 0, count = 0;
-
-    for(int i = 1; i < int((100 * s.get_T())/dt); i++){
-        // --- RK4 2nd-Order ODE Implementation ---
-        // Solves dx/dt = v AND dv/dt = a
-
-        // k1: Slopes at start
-        kx1 = v[i-1];
-        kv1 = -(s.get_c()/s.get_m())*v[i-1] - (s.get_k()/s.get_m())*x[i-1];
-
-        // k2: Slopes at midpoint (using k1)
-        xmid = x[i-1] + kx1*dt/2.0;
-        vmid = v[i-1] + kv1*dt/2.0;
-        kx2 = vmid;
-        kv2 = -(s.get_c()/s.get_m())*vmid - (s.get_k()/s.get_m())*xmid;
-
-        // k3: Slopes at midpoint (using k2)
-        xmidbett = x[i-1] + kx2*dt/2.0;
-        vmidbett = v[i-1] + kv2*dt/2.0;
-        kx3 = vmidbett;
-        kv3 = -(s.get_c()/s.get_m())*vmidbett - (s.get_k()/s.get_m())*xmidbett;
-
-        // k4: Slopes at end (using k3)
-        xfin = x[i-1] + kx3*dt;
-        vfin = v[i-1] + kv3*dt;
-        kx4 = vfin; // kx4 is the velocity 'v' at the end point
-        kv4 = -(s.get_c()/s.get_m())*kx4 - (s.get_k()/s.get_m())*xfin; // (using kx4 here is correct since kx4=vfin)
-
-        // Weighted average (Simpson's rule)
-        avgx = (kx1 + 2.0*kx2 + 2.0*kx3 + kx4) / 6.0;
-        avgv = (kv1 + 2.0*kv2 + 2.0*kv3 + kv4) / 6.0;
-
-        // Calculate final new state
-        newx = x[i-1] + avgx*dt;
-        newv = v[i-1] + avgv*dt;
-        newa = -(s.get_c()/s.get_m())*newv - (s.get_k()/s.get_m())*newx;
-
-        // Store new state
-        v.push_back(newv);
-        x.push_back(newx);
-        a.push_back(newa);
-        t.push_back(i*dt);
-
-        // --- Smart Break Logic (same as Euler) ---
-        if(s.get_zeta() <= 1){
-            if(i > 2 && abs(x[i-2]) < abs(x[i-1]) && abs(x[i-1]) > abs(x[i])){
-                if(count == 0) { first_peak = i-1; ref_peak = i-1; }
-                if(count == 1) { second_peak = i-1; }
-                if(count > 1)  { first_peak = second_peak; second_peak = i - 1; }
-                if(count > 0 && abs(x[first_peak]) < 0.02*abs(x[ref_peak]) && abs(x[second_peak]) < 0.02*abs(x[ref_peak])){
-                    break;
-                }
-                count++;
-            }
+StepMap free_step_map(const MassSpringDamper& s, Solver solver, double dt){
+    FreeModel accel(s);
+    switch(solver){
+        case Solver::Euler:  return step_map<SemiImplicitEuler>(accel, dt);
+        case Solver::Verlet: return step_map<VelocityVerlet>(accel, dt);
+        case Solver::Exact:  return exact_step_map(s.get_wn(), s.get_zeta(), dt).map;
+        default:             return step_map<ExplicitRK<ClassicRK4>>(accel, dt);
+    }
+}
+
+// Picks the stop policy of a fixed-step run.
+// t_stop > 0 switches the stop logic off and runs until t_stop instead.
+template<class Method, class Model, class Sample>
+static StepStats fixed_drive(const MassSpringDamper& s, const Model& accel, double dt, double t_stop, Sample&& sample){
+    const double x = s.get_xo(), v = s.get_vo();
+    if(t_stop > 0){
+        return fixed_loop<Method>(x, v, accel, dt, step_bound(fixed_step_count(s, dt, t_stop) + 1), NoStop(), sample);
+    }
+    const int n_max = step_bound(fixed_step_count(s, dt)); // max 100 natural periods
+    if(s.get_zeta() <= 1) return fixed_loop<Method>(x, v, accel, dt, n_max, PeakStop(x), sample);
+    StepLimit over = {step_bound(floor(2*s.get_T()/dt))};
+    return fixed_loop<Method>(x, v, accel, dt, n_max, over, sample);
+}
+
+// One trial step of an embedded FSAL tableau T, of size h from (x, v), with
+// (kx1, kv1) the slopes at the start. Writes the higher order solution and its
+// slopes (next step's first stage). Returns the scaled error norm: <= 1 means
+// the step is accepted.
+template<class T, class Model>
+static double embedded_step(double t, double x, double v, double kx1, double kv1, const Model& accel, double h,
+                            double atol, double rtol, double& xn, double& vn, double& kxn, double& kvn){
+    const int S = T::stages;
+    double kx[S], kv[S];
+    kx[0] = kx1;
+    kv[0] = kv1;
+    rk_stages<T, 1, S - 1>(x, v, t, h, kx, kv, accel);
+
+    xn = x + h*combine<StageRow<T, S - 1>, S - 1>(kx);
+    vn = v + h*combine<StageRow<T, S - 1>, S - 1>(kv);
+    kx[S - 1] = kxn = vn;
+    kv[S - 1] = kvn = accel(t + T::c[S - 1]*h, xn, vn);
+
+    double ex = h*combine<ErrorRow<T>, S>(kx);
+    double ev = h*combine<ErrorRow<T>, S>(kv);
+
+    // RMS of each component's error over its own tolerance
+    double sx = ex / (atol + rtol*max(abs(x), abs(xn)));
+    double sv = ev / (atol + rtol*max(abs(v), abs(vn)));
+    return sqrt((sx*sx + sv*sv) / 2.0);
+}
+
+// Extremum of x inside a step where v changes sign: the cubic Hermite of
+// (x0, v0) -> (x1, v1) at the zero of v interpolated linearly.
+static double turning_point(double x0, double v0, double x1, double v1, double h){
+    const double th = v0 / (v0 - v1);
+    const double th2 = th*th, th3 = th2*th;
+    return (2*th3 - 3*th2 + 1)*x0 + (th3 - 2*th2 + th)*h*v0 + (3*th2 - 2*th3)*x1 + (th3 - th2)*h*v1;
+}
+
+// Adaptive loop of tableau T until t_end or the stop policy, which counts
+// accepted steps. Steps are shortened to land exactly on a force discontinuity.
+// Only the tolerances limit the step: the stop policy also gets the turning
+// point inside each step where v changes sign, so the peak rule sees every
+// peak however few samples a period gets.
+template<class T, class Model, class Stop, class Sample>
+static StepStats adaptive_loop(const MassSpringDamper& s, const Model& accel, double atol, double rtol, double t_end,
+                               Stop stop, Sample&& sample){
+    const double exponent = -1.0 / (T::error_order + 1);
+
+    StepStats stats = {0, 0, budget_reason<Stop>()};
+    double t = 0, x = s.get_xo(), v = s.get_vo();
+    double kx = v, kv = accel(t, x, v);
+    double h = default_dt(s); // Same start as the fixed-step solvers
+    double t_jump = accel.discontinuity();
+
+    while(t < t_end){
+        if(t >= t_jump){
+            // Restart the slopes after the jump (and kick v for an impulse)
+            v += accel.impulse_dv();
+            kx = v;
+            kv = accel(t, x, v);
+            t_jump = numeric_limits<double>::infinity();
         }
-        else {
-            if(i == int(2*s.get_T()/dt)){
-                break;
-            }
+
+        double xn, vn, kxn, kvn;
+        h = min(h, t_end - t);
+        bool to_jump = t + h >= t_jump;
+        if(to_jump) h = t_jump - t;
+        double err = embedded_step<T>(t, x, v, kx, kv, accel, h, atol, rtol, xn, vn, kxn, kvn);
+
+        // Standard controller: h *= 0.9 * err^(-1/(q+1)), limited to [0.2, 5]
+        double factor = (err == 0) ? 5.0 : min(5.0, max(0.2, 0.9 * pow(err, exponent)));
+        if(err > 1){
+            h *= min(factor, 1.0);
+            stats.rejected++;
+            continue;
+        }
+
+        const double t_old = t, x_old = x, v_old = v;
+        t = to_jump ? t_jump : t + h;
+        x = xn; v = vn; kx = kxn; kv = kvn;
+        stats.accepted++;
+        sample(t, x, v, kv);
+        const double h_taken = t - t_old;
+        h *= factor;
+        bool turned = v_old*v < 0 && stop.done(stats.accepted, t_old, turning_point(x_old, v_old, x, v, h_taken));
+        if(turned || stop.done(stats.accepted, t, x)){
+            stats.stop = Stop::reason;
+            break;
         }
     }
-    export_results(t, x, v, a);
-}
\ No newline at end of file
+    return stats;
+}
+
+// Picks the stop policy of an adaptive run: the same peak-based rule as the
+// fixed-step solvers, measured in time instead of steps.
+// t_stop > 0 switches the stop logic off and runs until t_stop instead.
+template<class T, class Model, class Sample>
+static StepStats adaptive_drive(const MassSpringDamper& s, const Model& accel, double atol, double rtol, double t_stop, Sample&& sample){
+    if(t_stop > 0) return adaptive_loop<T>(s, accel, atol, rtol, t_stop, NoStop(), sample);
+    const double t_end = 100 * s.get_T();
+    if(s.get_zeta() <= 1) return adaptive_loop<T>(s, accel, atol, rtol, t_end, PeakStop(s.get_xo()), sample);
+    TimeLimit over = {2 * s.get_T()};
+    return adaptive_loop<T>(s, accel, atol, rtol, t_end, over, sample);
+}
+
+// Trace label of a solver.
+[[maybe_unused]] static const char* solver_label(Solver solver){
+    switch(solver){
+        case Solver::Euler:  return "euler";
+        case Solver::RK4:    return "rk4";
+        case Solver::RK45:   return "rk45";
+        case Solver::Verlet: return "verlet";
+        case Solver::Exact:  return "exact";
+    }
+    return "";
+}
+
+// Runs any solver through its sample loop. Traced as one "integrate" event,
+// which includes the per-sample work of the output policy.
+template<class Model, class Sample>
+static StepStats drive(const MassSpringDamper& s, Solver solver, const Model& accel, double dt, double t_stop, Sample&& sample){
+    MSD_TRACE_SCOPE(scope, "integrate", solver_label(solver));
+    StepStats stats = {0, 0, StopReason::EndTime};
+    switch(solver){
+        case Solver::Euler:  stats = fixed_drive<SemiImplicitEuler>(s, accel, dt, t_stop, sample); break;
+        case Solver::RK4:    stats = fixed_drive<ExplicitRK<ClassicRK4>>(s, accel, dt, t_stop, sample); break;
+        case Solver::Verlet: stats = fixed_drive<VelocityVerlet>(s, accel, dt, t_stop, sample); break;
+        case Solver::Exact:  stats = fixed_drive<ExactStep>(s, accel, dt, t_stop, sample); break;
+        case Solver::RK45:   stats = adaptive_drive<DormandPrince>(s, accel, RK45_ATOL, RK45_RTOL, t_stop, sample); break;
+    }
+    MSD_TRACE_RUN(scope, stats);
+    return stats;
+}
+
+// Writes the initial state [t=0] to a sink.
+template<class Model>
+static void write_initial(const MassSpringDamper& s, const Model& accel, TrajectorySink& out){
+    out.write(0, s.get_xo(), s.get_vo(), accel(0, s.get_xo(), s.get_vo()));
+}
+
+// Shared body of simulate(), simulate_for() and simulate_forced().
+template<class Model>
+static StepStats run_to_sink(const MassSpringDamper& s, Solver solver, const Model& accel, double dt, double t_stop, TrajectorySink& out){
+    out.begin(s, solver, (solver == Solver::RK45) ? 0 : dt);
+    write_initial(s, accel, out);
+    StepStats stats = drive(s, solver, accel, dt, t_stop, [&](double t, double x, double v, double a){ out.write(t, x, v, a); });
+    out.close();
+    return stats;
+}
+
+// Run that only writes the initial state (t_end <= 0).
+template<class Model>
+static StepStats initial_only(const MassSpringDamper& s, Solver solver, const Model& accel, double dt, TrajectorySink& out){
+    out.begin(s, solver, (solver == Solver::RK45) ? 0 : dt);
+    write_initial(s, accel, out);
+    out.close();
+    StepStats none = {0, 0, StopReason::EndTime};
+    return none;
+}
+
+StepStats simulate(const MassSpringDamper& s, Solver solver, TrajectorySink& out, double dt){
+    return run_to_sink(s, solver, FreeModel(s), (dt > 0) ? dt : default_dt(s), 0, out);
+}
+
+StepStats simulate_for(const MassSpringDamper& s, Solver solver, double t_end, TrajectorySink& out){
+    if(t_end <= 0) return initial_only(s, solver, FreeModel(s), default_dt(s), out);
+    return run_to_sink(s, solver, FreeModel(s), default_dt(s), t_end, out);
+}
+
+StepStats simulate_forced(const MassSpringDamper& s, Solver solver, const Forcing& force, double t_end, TrajectorySink& out, double dt){
+    ForcedModel accel(s, force);
+    if(dt <= 0) dt = default_dt(s);
+    if(t_end <= 0) return initial_only(s, solver, accel, dt, out);
+    return run_to_sink(s, solver, accel, dt, t_end, out);
+}
+
+void euler(const MassSpringDamper& s, TrajectorySink& out){ simulate(s, Solver::Euler, out); }
+
+void rk4(const MassSpringDamper& s, TrajectorySink& out){ simulate(s, Solver::RK4, out); }
+
+StepStats rk45(const MassSpringDamper& s, TrajectorySink& out, double atol, double rtol){
+    FreeModel accel(s);
+    out.begin(s, Solver::RK45, 0);
+    write_initial(s, accel, out);
+    MSD_TRACE_SCOPE(scope, "integrate", "rk45");
+    StepStats stats = adaptive_drive<DormandPrince>(s, accel, atol, rtol, 0, [&](double t, double x, double v, double a){ out.write(t, x, v, a); });
+    MSD_TRACE_RUN(scope, stats);
+    out.close();
+    return stats;
+}
+
+// Streams a run to a .msdt file through an output policy and prints how far
+// it drifted from the exact solution (measured on every step, not just the stored ones).
+// Returns false, without the report, if the file could not be written.
+template<class Run>
+static bool run_to_file(const MassSpringDamper& s, const string& filename, const OutputPolicy& policy, Run&& run){
+    // Sink that feeds the error tracker and passes the step on to the policy.
+    struct FileWithError : public TrajectorySink{
+        BinaryStreamWriter file;
+        DecimatingSink decimator;
+        ErrorTracker error;
+        FileWithError(const MassSpringDamper& s_, const string& filename_, const OutputPolicy& policy_)
+            : file(filename_), decimator(file, policy_), error(s_) {}
+        void begin(const MassSpringDamper& s_, Solver solver, double dt) override { decimator.begin(s_, solver, dt); }
+        void write(double t, double x, double v, double a) override { decimator.write(t, x, v, a); error.add(t, x, v); }
+        void close() override { decimator.close(); }
+    } out(s, filename, policy);
+
+    run(out);
+    if(!out.file.ok()) return false;
+
+    ErrorReport err = out.error.report();
+    cout << scientific << setprecision(3)
+         << "Global error vs exact solution: max |x| = " << err.max_x_error << " m, max |v| = " << err.max_v_error
+         << " m/s, RMS x = " << err.rms_x_error << " m" << defaultfloat << endl;
+    if(policy.mode != OutputMode::EveryStep){
+        cout << out.decimator.samples_forwarded() << " of " << out.decimator.steps_seen() << " samples stored" << endl;
+    }
+    return true;
+}
+
+StepStats simulate_to_file(const MassSpringDamper& s, Solver solver, const string& filename, const OutputPolicy& policy, double dt){
+    StepStats stats;
+    bool written = run_to_file(s, filename, policy, [&](TrajectorySink& out){ stats = simulate(s, solver, out, dt); });
+    stats.written = written;
+    return stats;
+}
+
+StepStats simulate_to_file(const MassSpringDamper& s, Solver solver, const string& filename){
+    return simulate_to_file(s, solver, filename, OutputPolicy());
+}
+
+StepStats simulate_forced_to_file(const MassSpringDamper& s, Solver solver, const Forcing& force, double t_end,
+                                  const string& filename, const OutputPolicy& policy, double dt){
+    // No error report here: FreeResponse is the unforced solution.
+    BinaryStreamWriter file(filename);
+    DecimatingSink out(file, policy);
+    StepStats stats = simulate_forced(s, solver, force, t_end, out, dt);
+    stats.written = file.ok();
+    if(stats.written && policy.mode != OutputMode::EveryStep){
+        cout << out.samples_forwarded() << " of " << out.steps_seen() << " samples stored" << endl;
+    }
+    return stats;
+}
+
+void euler(const MassSpringDamper& s){
+    simulate_to_file(s, Solver::Euler, "results.msdt");
+}
+
+void rk4(const MassSpringDamper& s){
+    simulate_to_file(s, Solver::RK4, "results.msdt");
+}
+
+StepStats rk45(const MassSpringDamper& s, double atol, double rtol){
+    StepStats stats;
+    bool written = run_to_file(s, "results.msdt", OutputPolicy(), [&](TrajectorySink& out){ stats = rk45(s, out, atol, rtol); });
+    stats.written = written;
+    return stats;
+}
+
+SimSummary simulate_summary(const MassSpringDamper& s, Solver solver){
+    SimSummary out;
+    out.peak = abs(s.get_xo());
+    out.settling_time = 0;
+    double x_end = s.get_xo(), v_end = s.get_vo();
+
+    StepStats stats = drive(s, solver, FreeModel(s), default_dt(s), 0, [&](double t, double x, double v, double){
+        // Running peak, so early samples are judged against a smaller
+        // threshold; harmless since the first peak comes within half a period.
+        if(abs(x) > out.peak) out.peak = abs(x);
+        if(abs(x) > 0.02*out.peak) out.settling_time = t;
+        x_end = x;
+        v_end = v;
+    });
+
+    out.steps = stats.accepted;
+    out.final_amplitude = sqrt(x_end*x_end + (v_end/s.get_wn())*(v_end/s.get_wn()));
+    return out;
+}
@@ -0,0 +1,306 @@
+#include "SoaRK4.h"
+#include <cmath>
+#include <algorithm>    // std::min, std::max
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// --- Lane types ---
+// Each one wraps a register type and its mask type behind the same small
+// set of operations, so the kernel below is written only once.
+// select(m, a, b) = m ? a : b, lane by lane.
+
+template<class Real>
+struct ScalarLanes{
+    static const int width = 1;
+    typedef Real real;
+    typedef Real vec;
+    typedef bool mask;
+
+    static vec load(const Real* p){ return *p; }
+    static void store(Real* p, vec a){ *p = a; }
+    static vec set1(Real a){ return a; }
+    static vec add(vec a, vec b){ return a + b; }
+    static vec sub(vec a, vec b){ return a - b; }
+    static vec mul(vec a, vec b){ return a * b; }
+    static vec abs(vec a){ return std::abs(a); }
+    static vec max(vec a, vec b){ return a > b ? a : b; }
+    static mask lt(vec a, vec b){ return a < b; }
+    static mask land(mask a, mask b){ return a && b; }
+    static mask lor(mask a, mask b){ return a || b; }
+    static mask landnot(mask a, mask b){ return a && !b; }
+    static vec select(mask m, vec a, vec b){ return m ? a : b; }
+    static bool any(mask m){ return m; }
+};
+
+#if defined(__AVX2__)
+struct Avx2Lanes{
+    static const int width = 4;
+    typedef double real;
+    typedef __m256d vec;
+    typedef __m256d mask;
+
+    static vec load(const double* p){ return _mm256_loadu_pd(p); }
+    static void store(double* p, vec a){ _mm256_storeu_pd(p, a); }
+    static vec set1(double a){ return _mm256_set1_pd(a); }
+    static vec add(vec a, vec b){ return _mm256_add_pd(a, b); }
+    static vec sub(vec a, vec b){ return _mm256_sub_pd(a, b); }
+    static vec mul(vec a, vec b){ return _mm256_mul_pd(a, b); }
+    static vec abs(vec a){ return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static vec max(vec a, vec b){ return _mm256_max_pd(a, b); }
+    static mask lt(vec a, vec b){ return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static mask land(mask a, mask b){ return _mm256_and_pd(a, b); }
+    static mask lor(mask a, mask b){ return _mm256_or_pd(a, b); }
+    static mask landnot(mask a, mask b){ return _mm256_andnot_pd(b, a); }
+    static vec select(mask m, vec a, vec b){ return _mm256_blendv_pd(b, a, m); }
+    static bool any(mask m){ return _mm256_movemask_pd(m) != 0; }
+};
+
+struct Avx2FloatLanes{
+    static const int width = 8;
+    typedef float real;
+    typedef __m256 vec;
+    typedef __m256 mask;
+
+    static vec load(const float* p){ return _mm256_loadu_ps(p); }
+    static void store(float* p, vec a){ _mm256_storeu_ps(p, a); }
+    static vec set1(float a){ return _mm256_set1_ps(a); }
+    static vec add(vec a, vec b){ return _mm256_add_ps(a, b); }
+    static vec sub(vec a, vec b){ return _mm256_sub_ps(a, b); }
+    static vec mul(vec a, vec b){ return _mm256_mul_ps(a, b); }
+    static vec abs(vec a){ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static vec max(vec a, vec b){ return _mm256_max_ps(a, b); }
+    static mask lt(vec a, vec b){ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static mask land(mask a, mask b){ return _mm256_and_ps(a, b); }
+    static mask lor(mask a, mask b){ return _mm256_or_ps(a, b); }
+    static mask landnot(mask a, mask b){ return _mm256_andnot_ps(b, a); }
+    static vec select(mask m, vec a, vec b){ return _mm256_blendv_ps(b, a, m); }
+    static bool any(mask m){ return _mm256_movemask_ps(m) != 0; }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct Avx512Lanes{
+    static const int width = 8;
+    typedef double real;
+    typedef __m512d vec;
+    typedef __mmask8 mask;
+
+    static vec load(const double* p){ return _mm512_loadu_pd(p); }
+    static void store(double* p, vec a){ _mm512_storeu_pd(p, a); }
+    static vec set1(double a){ return _mm512_set1_pd(a); }
+    static vec add(vec a, vec b){ return _mm512_add_pd(a, b); }
+    static vec sub(vec a, vec b){ return _mm512_sub_pd(a, b); }
+    static vec mul(vec a, vec b){ return _mm512_mul_pd(a, b); }
+    static vec abs(vec a){ return _mm512_abs_pd(a); }
+    static vec max(vec a, vec b){ return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ), a, b); }
+    static mask lt(vec a, vec b){ return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static mask land(mask a, mask b){ return mask(a & b); }
+    static mask lor(mask a, mask b){ return mask(a | b); }
+    static mask landnot(mask a, mask b){ return mask(a & ~b); }
+    static vec select(mask m, vec a, vec b){ return _mm512_mask_blend_pd(m, b, a); }
+    static bool any(mask m){ return m != 0; }
+};
+
+struct Avx512FloatLanes{
+    static const int width = 16;
+    typedef float real;
+    typedef __m512 vec;
+    typedef __mmask16 mask;
+
+    static vec load(const float* p){ return _mm512_loadu_ps(p); }
+    static void store(float* p, vec a){ _mm512_storeu_ps(p, a); }
+    static vec set1(float a){ return _mm512_set1_ps(a); }
+    static vec add(vec a, vec b){ return _mm512_add_ps(a, b); }
+    static vec sub(vec a, vec b){ return _mm512_sub_ps(a, b); }
+    static vec mul(vec a, vec b){ return _mm512_mul_ps(a, b); }
+    static vec abs(vec a){ return _mm512_abs_ps(a); }
+    static vec max(vec a, vec b){ return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), a, b); }
+    static mask lt(vec a, vec b){ return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static mask land(mask a, mask b){ return mask(a & b); }
+    static mask lor(mask a, mask b){ return mask(a | b); }
+    static mask landnot(mask a, mask b){ return mask(a & ~b); }
+    static vec select(mask m, vec a, vec b){ return _mm512_mask_blend_ps(m, b, a); }
+    static bool any(mask m){ return m != 0; }
+};
+#endif
+
+#if defined(__AVX512F__)
+typedef Avx512Lanes Lanes;
+typedef Avx512FloatLanes FloatLanes;
+static const char* const LANES_ISA = "AVX-512";
+#elif defined(__AVX2__)
+typedef Avx2Lanes Lanes;
+typedef Avx2FloatLanes FloatLanes;
+static const char* const LANES_ISA = "AVX2";
+#else
+typedef ScalarLanes<double> Lanes;
+typedef ScalarLanes<float> FloatLanes;
+static const char* const LANES_ISA = "scalar";
+#endif
+
+int rk4_soa_width(){ return Lanes::width; }
+
+int rk4_soa_float_width(){ return FloatLanes::width; }
+
+const char* rk4_soa_isa(){ return LANES_ISA; }
+
+// Same limits as rk4(): at most 100 periods, 2 periods for overdamped systems.
+double rk4_soa_step_limit(const MassSpringDamper& s){
+    double dt = default_dt(s);
+    double n_max = floor((100 * s.get_T())/dt);
+    double n_over = floor(2*s.get_T()/dt);
+    // The loop runs while i < n_max; overdamped systems also stop at n_over.
+    return (s.get_zeta() <= 1) ? n_max - 1 : min(n_over, n_max - 1);
+}
+
+template<class L>
+static void load_lanes(BasicOscillatorSoA<typename L::real>& soa, const MassSpringDamper* systems, size_t n){
+    typedef typename L::real Real;
+    size_t padded = (n + L::width - 1) / L::width * L::width;
+    soa.count = n;
+    soa.x.assign(padded, Real(0));
+    soa.v.assign(padded, Real(0));
+    soa.xx.assign(padded, Real(0));
+    soa.xv.assign(padded, Real(0));
+    soa.vx.assign(padded, Real(0));
+    soa.vv.assign(padded, Real(0));
+    soa.dt.assign(padded, Real(0));
+    soa.wn.assign(padded, Real(1));
+    soa.limit.assign(padded, Real(0));
+    soa.oscillating.assign(padded, Real(0));
+
+    for(size_t i = 0; i < n; i++){
+        const MassSpringDamper& s = systems[i];
+        double dt = default_dt(s);
+
+        soa.x[i] = Real(s.get_xo());
+        soa.v[i] = Real(s.get_vo());
+        StepMap P = free_step_map(s, Solver::RK4, dt);
+        soa.xx[i] = Real(P.xx);
+        soa.xv[i] = Real(P.xv);
+        soa.vx[i] = Real(P.vx);
+        soa.vv[i] = Real(P.vv);
+        soa.dt[i] = Real(dt);
+        soa.wn[i] = Real(s.get_wn());
+        soa.oscillating[i] = (s.get_zeta() <= 1) ? Real(1) : Real(0);
+        soa.limit[i] = Real(rk4_soa_step_limit(s));
+    }
+}
+
+void load_soa(OscillatorSoA& soa, const MassSpringDamper* systems, size_t n){ load_lanes<Lanes>(soa, systems, n); }
+
+void load_soa(FloatOscillatorSoA& soa, const MassSpringDamper* systems, size_t n){ load_lanes<FloatLanes>(soa, systems, n); }
+
+// Runs one block of L::width lanes to completion.
+// Same per-step logic as simulate_summary(), with the branches turned into masks.
+template<class L>
+static void rk4_block(BasicOscillatorSoA<typename L::real>& soa, size_t base, typename L::real* peak_out,
+                      typename L::real* settle_out, typename L::real* steps_out){
+    typedef typename L::real Real;
+    typedef typename L::vec vec;
+    typedef typename L::mask mask;
+
+    const vec zero = L::set1(Real(0)), half = L::set1(Real(0.5)), one = L::set1(Real(1));
+    const vec onehalf = L::set1(Real(1.5)), tol = L::set1(Real(0.02));
+    // Underflow stop: a state this close to the denormal range is settled
+    // (strongly damped runs get there before their third peak in float, and
+    // denormal arithmetic is many times slower).
+    const vec tiny = L::set1(numeric_limits<Real>::min() * Real(1 << 24));
+
+    vec x = L::load(&soa.x[base]);
+    vec v = L::load(&soa.v[base]);
+    const vec xx = L::load(&soa.xx[base]), xv = L::load(&soa.xv[base]);
+    const vec vx = L::load(&soa.vx[base]), vv = L::load(&soa.vv[base]);
+    const vec dt = L::load(&soa.dt[base]);
+    const vec limit = L::load(&soa.limit[base]);
+    const mask osc = L::lt(half, L::load(&soa.oscillating[base]));
+
+    vec x1 = x, x2 = x;
+    vec peak = L::abs(x), settle = zero, steps = zero;
+    vec ref_peak = zero, first_peak = zero, second_peak = zero, count = zero;
+
+    mask running = L::lt(zero, limit);
+
+    for(int i = 1; L::any(running); i++){
+        const vec iv = L::set1(Real(i));
+
+        // --- RK4 step, as its linear map ---
+        vec xn = L::add(L::mul(xx, x), L::mul(xv, v));
+        vec vn = L::add(L::mul(vx, x), L::mul(vv, v));
+
+        // Settled lanes keep their last state
+        x = L::select(running, xn, x);
+        v = L::select(running, vn, v);
+        steps = L::select(running, iv, steps);
+
+        // --- Summary metrics ---
+        vec ax = L::abs(x), ax1 = L::abs(x1), ax2 = L::abs(x2);
+        peak = L::select(running, L::max(peak, ax), peak);
+        settle = L::select(L::land(running, L::lt(L::mul(tol, peak), ax)), L::mul(iv, dt), settle);
+
+        // --- Stop logic ---
+        mask stop = L::lt(limit, L::add(iv, half)); // i >= limit
+        if(i > 2){
+            mask pk = L::land(L::land(running, osc), L::land(L::lt(ax2, ax1), L::lt(ax, ax1)));
+            if(L::any(pk)){
+                mask c0 = L::land(pk, L::lt(count, half));
+                mask cg = L::land(pk, L::lt(onehalf, count));
+                mask c1 = L::landnot(L::landnot(pk, c0), cg);
+
+                ref_peak = L::select(c0, ax1, ref_peak);
+                first_peak = L::select(c0, ax1, L::select(cg, second_peak, first_peak));
+                second_peak = L::select(L::lor(c1, cg), ax1, second_peak);
+
+                mask settled = L::land(L::landnot(pk, c0),
+                                       L::land(L::lt(first_peak, L::mul(tol, ref_peak)),
+                                               L::lt(second_peak, L::mul(tol, ref_peak))));
+                stop = L::lor(stop, settled);
+                count = L::select(pk, L::add(count, one), count);
+            }
+        }
+        if((i & 63) == 0){
+            const vec wn = L::load(&soa.wn[base]);
+            mask vanished = L::land(L::land(L::lt(L::abs(x), tiny), L::lt(L::abs(v), L::mul(tiny, wn))),
+                                    L::lt(L::add(tiny, tiny), L::mul(tol, peak)));
+            stop = L::lor(stop, vanished);
+        }
+        running = L::landnot(running, stop);
+
+        x2 = x1;
+        x1 = x;
+    }
+
+    L::store(&soa.x[base], x);
+    L::store(&soa.v[base], v);
+    L::store(peak_out, peak);
+    L::store(settle_out, settle);
+    L::store(steps_out, steps);
+}
+
+template<class L>
+static void rk4_lanes(BasicOscillatorSoA<typename L::real>& soa, SimSummary* out){
+    typedef typename L::real Real;
+    Real peak[L::width], settle[L::width], steps[L::width];
+
+    for(size_t base = 0; base < soa.size(); base += L::width){
+        rk4_block<L>(soa, base, peak, settle, steps);
+
+        for(int j = 0; j < L::width && base + j < soa.count; j++){
+            size_t i = base + j;
+            double x = soa.x[i], vw = double(soa.v[i])/soa.wn[i];
+            out[i].peak = peak[j];
+            out[i].settling_time = settle[j];
+            out[i].final_amplitude = sqrt(x*x + vw*vw);
+            out[i].steps = int(steps[j]);
+        }
+    }
+}
+
+void rk4_soa(OscillatorSoA& soa, SimSummary* out){ rk4_lanes<Lanes>(soa, out); }
+
+void rk4_soa(FloatOscillatorSoA& soa, SimSummary* out){ rk4_lanes<FloatLanes>(soa, out); }
@@ -0,0 +1,119 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>    // std::min
+
+using namespace std;
+
+// Lets submit() know whether it is being called from one of this pool's workers.
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+ThreadPool::ThreadPool(unsigned n_threads){
+    if(n_threads == 0){
+        n_threads = thread::hardware_concurrency();
+        if(n_threads == 0) n_threads = 1; // hardware_concurrency() may be unknown
+    }
+    for(unsigned i = 0; i < n_threads; i++){
+        queues.push_back(make_unique<Queue>());
+    }
+    for(unsigned i = 0; i < n_threads; i++){
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    wait();
+    {
+        lock_guard<mutex> guard(state_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(thread& w : workers){
+        w.join();
+    }
+}
+
+void ThreadPool::submit(function<void()> task){
+    size_t id;
+    if(current_pool == this){
+        id = current_worker; // Keep nested work local (better cache reuse)
+    } else {
+        id = next_queue.fetch_add(1, memory_order_relaxed) % queues.size();
+    }
+
+    pending.fetch_add(1);
+    {
+        lock_guard<mutex> guard(queues[id]->lock);
+        queues[id]->tasks.push_back(move(task));
+    }
+    {
+        // Taking state_lock here closes the window between a worker's
+        // "queued == 0" check and its wait(), so no wake-up is lost.
+        lock_guard<mutex> guard(state_lock);
+        queued.fetch_add(1);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::pop_task(size_t id, function<void()>& task){
+    // 1st: own deque, newest task first (LIFO)
+    {
+        Queue& own = *queues[id];
+        lock_guard<mutex> guard(own.lock);
+        if(!own.tasks.empty()){
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    // 2nd: steal the oldest task from somebody else (FIFO)
+    for(size_t j = 1; j < queues.size(); j++){
+        Queue& victim = *queues[(id + j) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if(!victim.tasks.empty()){
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t id){
+    current_pool = this;
+    current_worker = id;
+    MSD_TRACE_THREAD("worker", int(id));
+
+    function<void()> task;
+    while(true){
+        if(pop_task(id, task)){
+            task();
+            task = nullptr; // Release captures before signalling completion
+            if(pending.fetch_sub(1) == 1){
+                lock_guard<mutex> guard(state_lock);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock<mutex> guard(state_lock);
+        wake.wait(guard, [this]{ return stopping || queued.load() > 0; });
+        if(stopping && queued.load() == 0) return;
+    }
+}
+
+void ThreadPool::wait(){
+    unique_lock<mutex> guard(state_lock);
+    idle.wait(guard, [this]{ return pending.load() == 0; });
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const function<void(size_t, size_t)>& body){
+    if(grain == 0) grain = 1;
+    for(size_t begin = 0; begin < n; begin += grain){
+        size_t end = min(n, begin + grain);
+        submit([&body, begin, end]{ body(begin, end); });
+    }
+    wait();
+}
@@ -0,0 +1,193 @@
+#include "Trace.h"
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+// Every thread appends to its own log with no locking. The registry owns the
+// logs (so they outlive their threads) and its lock is only taken when a
+// thread traces for the first time, and by snapshot / reset.
+static mutex registry_lock;
+
+static vector<unique_ptr<TraceThreadLog>>& registry(){
+    static vector<unique_ptr<TraceThreadLog>> logs;
+    return logs;
+}
+
+static thread_local TraceThreadLog* current_log = nullptr;
+
+static void clear_log(TraceThreadLog& log){
+    log.events.clear();
+    for(uint64_t& c : log.counters) c = 0;
+    for(uint64_t& s : log.stops) s = 0;
+    log.dropped = 0;
+}
+
+static TraceThreadLog& thread_log(){
+    if(!current_log){
+        lock_guard<mutex> guard(registry_lock);
+        vector<unique_ptr<TraceThreadLog>>& logs = registry();
+        logs.push_back(make_unique<TraceThreadLog>());
+        current_log = logs.back().get();
+        current_log->id = int(logs.size()) - 1;
+        current_log->name = "thread " + to_string(current_log->id);
+        clear_log(*current_log);
+    }
+    return *current_log;
+}
+
+#ifdef MSD_TRACE
+
+// ns since the first call.
+static uint64_t now_ns(){
+    static const chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count());
+}
+
+// --- TraceScope ---
+
+TraceScope::TraceScope(const char* name, const char* detail){
+    event.name = name;
+    event.detail = detail;
+    event.steps = 0;
+    event.bytes = 0;
+    event.stop = -1;
+    event.duration_ns = 0;
+    event.start_ns = now_ns();
+}
+
+TraceScope::~TraceScope(){
+    event.duration_ns = now_ns() - event.start_ns;
+    TraceThreadLog& log = thread_log();
+    if(log.events.size() < TRACE_EVENT_LIMIT) log.events.push_back(event);
+    else log.dropped++;
+}
+
+void TraceScope::record_run(const StepStats& stats){
+    TraceThreadLog& log = thread_log();
+    event.steps += uint64_t(stats.accepted);
+    event.stop = int(stats.stop);
+    log.counters[int(TraceCounter::Runs)]++;
+    log.counters[int(TraceCounter::Steps)] += uint64_t(stats.accepted);
+    log.counters[int(TraceCounter::Rejected)] += uint64_t(stats.rejected);
+    log.stops[int(stats.stop)]++;
+}
+
+void TraceScope::record_runs(uint64_t runs, uint64_t steps){
+    TraceThreadLog& log = thread_log();
+    event.steps += steps;
+    log.counters[int(TraceCounter::Runs)] += runs;
+    log.counters[int(TraceCounter::Steps)] += steps;
+}
+
+void TraceScope::record_bytes(uint64_t bytes){
+    event.bytes += bytes;
+    thread_log().counters[int(TraceCounter::BytesWritten)] += bytes;
+}
+
+void trace_count(TraceCounter counter, uint64_t n){
+    thread_log().counters[int(counter)] += n;
+}
+
+#endif
+
+// --- Logs ---
+
+void trace_thread_name(const char* name, int index){
+    if(!TRACE_ENABLED) return;
+    thread_log().name = (index < 0) ? string(name) : string(name) + " " + to_string(index);
+}
+
+vector<TraceThreadLog> trace_snapshot(){
+    lock_guard<mutex> guard(registry_lock);
+    vector<TraceThreadLog> copy;
+    for(const unique_ptr<TraceThreadLog>& log : registry()) copy.push_back(*log);
+    return copy;
+}
+
+void trace_reset(){
+    lock_guard<mutex> guard(registry_lock);
+    for(unique_ptr<TraceThreadLog>& log : registry()) clear_log(*log);
+}
+
+const char* stop_reason_name(int reason){
+    static const char* const names[STOP_REASONS] = { "settled", "two periods", "end time", "period limit" };
+    return (reason >= 0 && reason < STOP_REASONS) ? names[reason] : "";
+}
+
+// --- Summary ---
+
+// Time of each phase minus the scopes nested in it, added up per name.
+// Scopes of one thread nest properly, so sorting them by start (outer first on
+// ties) and keeping a stack of the open ones finds every direct parent.
+static void exclusive_times(const vector<TraceEvent>& events, vector<pair<string, uint64_t>>& phases){
+    vector<const TraceEvent*> order;
+    for(const TraceEvent& e : events) order.push_back(&e);
+    sort(order.begin(), order.end(), [](const TraceEvent* a, const TraceEvent* b){
+        return (a->start_ns != b->start_ns) ? a->start_ns < b->start_ns : a->duration_ns > b->duration_ns;
+    });
+
+    vector<int64_t> self(order.size());
+    vector<size_t> open;
+    for(size_t i = 0; i < order.size(); i++){
+        const TraceEvent& e = *order[i];
+        while(!open.empty() && order[open.back()]->start_ns + order[open.back()]->duration_ns <= e.start_ns) open.pop_back();
+        if(!open.empty()) self[open.back()] -= int64_t(e.duration_ns);
+        self[i] += int64_t(e.duration_ns);
+        open.push_back(i);
+    }
+
+    for(size_t i = 0; i < order.size(); i++){
+        auto it = find_if(phases.begin(), phases.end(), [&](const pair<string, uint64_t>& p){ return p.first == order[i]->name; });
+        if(it == phases.end()){
+            phases.push_back(make_pair(string(order[i]->name), uint64_t(0)));
+            it = phases.end() - 1;
+        }
+        it->second += uint64_t(max<int64_t>(self[i], 0));
+    }
+}
+
+string trace_summary(){
+    if(!TRACE_ENABLED) return "";
+    vector<TraceThreadLog> logs = trace_snapshot();
+
+    uint64_t totals[int(TraceCounter::Count)] = {};
+    uint64_t stops[STOP_REASONS] = {};
+    uint64_t dropped = 0;
+    int threads = 0;
+    vector<pair<string, uint64_t>> phases;
+    for(const TraceThreadLog& log : logs){
+        bool used = !log.events.empty() || log.dropped > 0;
+        for(int i = 0; i < int(TraceCounter::Count); i++){
+            totals[i] += log.counters[i];
+            if(log.counters[i] > 0) used = true;
+        }
+        for(int i = 0; i < STOP_REASONS; i++) stops[i] += log.stops[i];
+        dropped += log.dropped;
+        if(used) threads++;
+        exclusive_times(log.events, phases);
+    }
+    sort(phases.begin(), phases.end(), [](const pair<string, uint64_t>& a, const pair<string, uint64_t>& b){ return a.second > b.second; });
+
+    ostringstream s;
+    s << "Trace: " << totals[int(TraceCounter::Runs)] << " runs, " << totals[int(TraceCounter::Steps)] << " steps";
+    if(totals[int(TraceCounter::Rejected)] > 0) s << " (" << totals[int(TraceCounter::Rejected)] << " rejected)";
+    bool first = true;
+    for(int i = 0; i < STOP_REASONS; i++){
+        if(stops[i] == 0) continue;
+        s << (first ? ", stop: " : ", ") << stop_reason_name(i) << " " << stops[i];
+        first = false;
+    }
+    s << fixed << setprecision(2) << " | " << totals[int(TraceCounter::BytesWritten)] / 1e6 << " MB written";
+    if(totals[int(TraceCounter::Reallocations)] > 0) s << ", " << totals[int(TraceCounter::Reallocations)] << " reallocations";
+    for(size_t i = 0; i < phases.size(); i++){
+        s << (i ? ", " : " | ") << phases[i].first << " " << phases[i].second / 1e6 << " ms";
+    }
+    s << " | " << threads << (threads == 1 ? " thread" : " threads");
+    if(dropped > 0) s << " (" << dropped << " events dropped)";
+    return s.str();
+}
@@ -0,0 +1,135 @@
+#include "Trajectory.h"
+#include "Trace.h"
+#include <iostream>
+#include <iomanip>      // For setprecision
+#include <limits>       // For numeric_limits
+
+using namespace std;
+
+static const char* const CSV_HEADER = "time(s),position(m),velocity(m/s),acceleration(m/s^2)\n";
+
+// --- StreamWriter ---
+
+StreamWriter::~StreamWriter(){
+    // Derived classes close() first; this only guards against a leaked thread.
+    if(writer.joinable()){
+        {
+            lock_guard<mutex> guard(lock);
+            finishing = true;
+        }
+        chunk_ready.notify_one();
+        writer.join();
+    }
+}
+
+void StreamWriter::start(){
+    ring.resize(CHUNK_COUNT * 4 * CHUNK_SAMPLES);
+    started = true;
+    writer = thread(&StreamWriter::writer_loop, this);
+}
+
+void StreamWriter::write(double t, double x, double v, double a){
+    if(!started || closed) return;
+
+    column(fill_chunk, 0)[fill_size] = t;
+    column(fill_chunk, 1)[fill_size] = x;
+    column(fill_chunk, 2)[fill_size] = v;
+    column(fill_chunk, 3)[fill_size] = a;
+    if(++fill_size == CHUNK_SAMPLES){
+        hand_over();
+    }
+}
+
+// Gives the current chunk to the writer thread and waits for a free one.
+void StreamWriter::hand_over(){
+    unique_lock<mutex> guard(lock);
+    ready_chunks++;
+    chunk_ready.notify_one();
+    chunk_free.wait(guard, [this]{ return ready_chunks < CHUNK_COUNT; });
+    fill_chunk++;
+    fill_size = 0;
+}
+
+void StreamWriter::writer_loop(){
+    MSD_TRACE_THREAD("stream writer", -1);
+    while(true){
+        size_t n;
+        bool full;
+        {
+            unique_lock<mutex> guard(lock);
+            chunk_ready.wait(guard, [this]{ return ready_chunks > 0 || finishing; });
+            full = ready_chunks > 0;
+            if(full){
+                n = CHUNK_SAMPLES;
+            } else if(last_size > 0){
+                n = last_size;
+                last_size = 0;
+            } else {
+                return; // finishing and nothing left
+            }
+        }
+
+        // Write outside the lock, so the solver can keep filling other chunks.
+        size_t c = write_chunk_id;
+        write_chunk(column(c, 0), column(c, 1), column(c, 2), column(c, 3), n);
+
+        {
+            lock_guard<mutex> guard(lock);
+            if(full){
+                ready_chunks--;
+                write_chunk_id++;
+            }
+        }
+        chunk_free.notify_one();
+    }
+}
+
+void StreamWriter::close(){
+    if(!started || closed) return;
+    MSD_TRACE_SCOPE(scope, "close");  // Waits for the writer thread to drain the ring
+    closed = true;
+    {
+        lock_guard<mutex> guard(lock);
+        last_size = fill_size;
+        finishing = true;
+    }
+    chunk_ready.notify_one();
+    writer.join();
+    finish();
+}
+
+// --- CsvStreamWriter ---
+
+CsvStreamWriter::CsvStreamWriter(const string& filename_) : filename(filename_), file(filename_){
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return;
+    }
+    // max_digits10 (17) round-trips every double; the 6-digit default does not.
+    file << setprecision(numeric_limits<double>::max_digits10);
+    file << CSV_HEADER;
+    bytes = string(CSV_HEADER).size();
+    start();
+}
+
+CsvStreamWriter::~CsvStreamWriter(){
+    close();
+}
+
+void CsvStreamWriter::write_chunk(const double* t, const double* x, const double* v, const double* a, size_t n){
+    MSD_TRACE_SCOPE(scope, "write", "csv");
+    streampos before = file.tellp();
+    for(size_t i = 0; i < n; i++){
+        file << t[i] << "," << x[i] << "," << v[i] << "," << a[i] << "\n";
+    }
+    size_t written = size_t(file.tellp() - before);
+    bytes += written;
+    MSD_TRACE_BYTES(scope, written);
+}
+
+void CsvStreamWriter::finish(){
+    file.close();
+    written = !file.fail();
+    if(!written) cout << "Error: could not write '" << filename << "'" << endl;
+    else cout << "'" << filename << "' file successfully exported!" << endl;
+}
@@ -0,0 +1,157 @@
+#include "TrajectoryFile.h"
+#include "Trace.h"
+#include <iostream>
+#include <cstring>      // For memcpy / memcmp / memset
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --- BinaryStreamWriter ---
+
+BinaryStreamWriter::BinaryStreamWriter(const string& filename_, bool report_) : filename(filename_), file(filename_, ios::binary), report(report_){
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.block_size = CHUNK_SAMPLES;
+
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return;
+    }
+    // Placeholder; the real header goes in once the sample count is known.
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes = sizeof(header);
+    start();
+}
+
+BinaryStreamWriter::~BinaryStreamWriter(){
+    close();
+}
+
+void BinaryStreamWriter::begin(const MassSpringDamper& s, Solver solver, double dt){
+    header.solver = uint32_t(solver);
+    header.m = s.get_m();
+    header.c = s.get_c();
+    header.k = s.get_k();
+    header.xo = s.get_xo();
+    header.vo = s.get_vo();
+    header.dt = dt;
+}
+
+void BinaryStreamWriter::write_chunk(const double* t, const double* x, const double* v, const double* a, size_t n){
+    MSD_TRACE_SCOPE(scope, "write", "msdt");
+    const double* cols[4] = {t, x, v, a};
+    for(const double* col : cols){
+        file.write(reinterpret_cast<const char*>(col), streamsize(n*sizeof(double)));
+    }
+    samples += n;
+    bytes += 4*n*sizeof(double);
+    MSD_TRACE_BYTES(scope, 4*n*sizeof(double));
+}
+
+void BinaryStreamWriter::finish(){
+    header.samples = samples;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    written = !file.fail();
+    if(!written) cout << "Error: could not write '" << filename << "'" << endl;
+    else if(report) cout << "'" << filename << "' file successfully exported!" << endl;
+}
+
+// --- TrajectoryFile ---
+
+TrajectoryFile::~TrajectoryFile(){
+    close();
+}
+
+bool TrajectoryFile::open(const string& filename){
+    close();
+
+#ifdef _WIN32
+    HANDLE fh = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(fh == INVALID_HANDLE_VALUE){
+        cout << "Error: could not open '" << filename << "'" << endl;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(fh, &file_size);
+    length = size_t(file_size.QuadPart);
+    HANDLE mh = (length > 0) ? CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    const void* view = mh ? MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0) : NULL;
+    file_handle = fh;
+    mapping = mh;
+#else
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0){
+        cout << "Error: could not open '" << filename << "'" << endl;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    length = size_t(st.st_size);
+    void* view = (length > 0) ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if(view == MAP_FAILED) view = nullptr;
+#endif
+
+    data = static_cast<const unsigned char*>(view);
+    if(!data){
+        cout << "Error: could not map '" << filename << "'" << endl;
+        close();
+        return false;
+    }
+
+    // Validate before handing out any pointer into the mapping.
+    const TrajectoryHeader* h = reinterpret_cast<const TrajectoryHeader*>(data);
+    if(length < sizeof(TrajectoryHeader) || memcmp(h->magic, TRAJECTORY_MAGIC, sizeof(h->magic)) != 0
+       || h->version != TRAJECTORY_VERSION || h->block_size == 0
+       || (length - sizeof(TrajectoryHeader)) / (4*sizeof(double)) < h->samples){
+        cout << "Error: '" << filename << "' is not a valid trajectory file" << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TrajectoryFile::close(){
+#ifdef _WIN32
+    if(data) UnmapViewOfFile(data);
+    if(mapping) CloseHandle(mapping);
+    if(file_handle) CloseHandle(file_handle);
+    mapping = nullptr;
+    file_handle = nullptr;
+#else
+    if(data) munmap(const_cast<unsigned char*>(data), length);
+    if(fd >= 0) ::close(fd);
+    fd = -1;
+#endif
+    data = nullptr;
+    length = 0;
+}
+
+size_t TrajectoryFile::block_count() const{
+    size_t b = size_t(header().block_size);
+    return (size() + b - 1) / b;
+}
+
+size_t TrajectoryFile::block_length(size_t b) const{
+    size_t bs = size_t(header().block_size);
+    size_t begin = b*bs;
+    return (size() - begin < bs) ? size() - begin : bs;
+}
+
+const double* TrajectoryFile::column(size_t block, int col) const{
+    // Every block before 'block' is full, so its offset is a simple product.
+    size_t bs = size_t(header().block_size);
+    size_t offset = sizeof(TrajectoryHeader) + block*4*bs*sizeof(double) + col*block_length(block)*sizeof(double);
+    return reinterpret_cast<const double*>(data + offset);
+}
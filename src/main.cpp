@@ -9,8 +9,9 @@
 // Project headers
 #include "constants.h"
 #include "MassSpringDamper.h"
-#include "simulation.h"
+#include "Simulation.h"
 #include "utils.h"
+#include "Cli.h"
 
 using namespace std;
 
@@ -19,7 +20,10 @@ MassSpringDamper manual_sys_creation();
 void menu();
 
 // Main entry point
-int main(){
+int main(int argc, char* argv[]){
+    if(argc > 1){
+        return run_cli(argc, argv); // Headless: never touches cin
+    }
     menu();
     return 0;
 }
@@ -89,6 +93,7 @@ MassSpringDamper manual_sys_creation(){
 void menu(){
     int creation = 0; // Flag to check if a system exists
     int opt_menu = 0, opt_sim = 0, opt_par = 0;
+    bool csv_copy = false; // Also write results.csv after each simulation
     MassSpringDamper s; // The main system object
 
     while(opt_menu != 4){ // Loop until user selects "4 - Finish"
@@ -112,7 +117,7 @@ void menu(){
             continue; 
         }
         
-        system("cls");
+        clearScreen();
 
         switch(opt_menu){
             case 1: // --- Create System ---
@@ -157,7 +162,7 @@ void menu(){
                         pauseAndClear();
                         continue;
                     }
-                    system("cls");
+                    clearScreen();
                     
                     // This is long, but a 'switch' is more complex with the pause
                     if(opt_par == 1){
@@ -224,7 +229,7 @@ void menu(){
                         pauseAndClear();
                     }
                     else if(opt_par == 16){ export_parameters(s); pauseAndClear(); }
-                    else if(opt_par == 17){ system("cls"); break; } // Exit sub-menu
+                    else if(opt_par == 17){ clearScreen(); break; } // Exit sub-menu
                     else { cout << "Invalid option." << endl; pauseAndClear(); }
                 }
                 break;
@@ -235,13 +240,15 @@ void menu(){
                     pauseAndClear();
                     break;
                 }
-                while(opt_sim != 3){ // Simulation sub-menu
+                while(opt_sim != 5){ // Simulation sub-menu
                     cout << "______________________________________________________" << endl;
                     cout << "                       Simulate" << endl;
-                    cout << "(your simulation will be exported as a .csv file)" << endl << endl;
+                    cout << "(your simulation will be exported as results.msdt)" << endl << endl;
                     cout << "1 - Euler's Method" << endl
                          << "2 - Range-Kutta's Method" << endl
-                         << "3 - Back" << endl 
+                         << "3 - Dormand-Prince (adaptive step)" << endl
+                         << "4 - Also export results.csv: " << (csv_copy ? "ON" : "OFF") << endl
+                         << "5 - Back" << endl 
                          << "______________________________________________________" << endl;
                     
                     if (!(cin >> opt_sim)) {
@@ -254,16 +261,29 @@ void menu(){
 
                     if(opt_sim == 1){
                         euler(s);
+                        if(csv_copy) export_results_csv();
                         pauseAndClear();
-                        opt_sim = 3; // Go back after running
+                        opt_sim = 5; // Go back after running
                     }
                     else if(opt_sim == 2){
                         rk4(s);
+                        if(csv_copy) export_results_csv();
                         pauseAndClear();
-                        opt_sim = 3; // Go back after running
+                        opt_sim = 5; // Go back after running
                     }
                     else if(opt_sim == 3){
-                        system("cls");
+                        StepStats stats = rk45(s);
+                        cout << "Accepted steps: " << stats.accepted << ", rejected steps: " << stats.rejected << endl;
+                        if(csv_copy) export_results_csv();
+                        pauseAndClear();
+                        opt_sim = 5; // Go back after running
+                    }
+                    else if(opt_sim == 4){
+                        csv_copy = !csv_copy;
+                        clearScreen();
+                    }
+                    else if(opt_sim == 5){
+                        clearScreen();
                         break; // Exit sub-menu
                     }
                     else { cout << "Invalid option." << endl; pauseAndClear(); }
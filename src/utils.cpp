@@ -1,20 +1,48 @@
 #include "utils.h"
 #include "constants.h" // For pi and e
 #include "MassSpringDamper.h" // Need the full class def here
+#include "Batch.h"            // For BatchResult
+#include "TrajectoryFile.h"   // For TrajectoryFile
+#include "FrequencyResponse.h" // For FrequencyPoint
+#include "MonteCarlo.h"   // For MonteCarloResult
+#include "Identification.h" // For FitResult
+#include "RealTime.h"     // For LatencyHistogram
+#include "Parareal.h"     // For PararealResult
+#include "Trace.h"        // For trace_snapshot and MSD_TRACE_*
 #include <iostream>
 #include <fstream>      // For ofstream
 #include <iomanip>      // For setprecision
 #include <limits>       // For numeric_limits
-#include <cstdlib>      // For system("cls") / system("clear")
+#include <cstdlib>      // For system("cls")
 #include <cmath>
+#include <algorithm>    // For sort
 
 using namespace std;
 
-void export_parameters(const MassSpringDamper& s) {
-    ofstream file("system_parameters.csv");
+// Closes an export file; a failed write or close (e.g. a full disk) is an error.
+static bool close_export(ofstream& file, const string& filename){
+    file.close();
+    if(!file.fail()) return true;
+    cout << "Error: could not write '" << filename << "'" << endl;
+    return false;
+}
+
+bool damped_parameters(const MassSpringDamper& s, double& wd, double& Td, double& Mp, double& delta){
+    double zeta = s.get_zeta();
+    if (zeta >= 1) return false;
+    wd = s.get_wn() * sqrt(1 - pow(zeta, 2));
+    Td = 2 * pi / wd;
+    Mp = 100 * pow(e, (-zeta * pi) / sqrt(1 - pow(zeta, 2)));
+    delta = (2 * pi * zeta) / sqrt(1 - pow(zeta, 2));
+    return true;
+}
+
+bool export_parameters(const MassSpringDamper& s, const string& filename) {
+    MSD_TRACE_SCOPE(scope, "export", "parameters");
+    ofstream file(filename);
     if (!file.is_open()) {
-        cout << "Error: could not create 'system_parameters.csv'" << endl;
-        return;
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
     }
 
     double wn = s.get_wn();
@@ -41,11 +69,8 @@ void export_parameters(const MassSpringDamper& s) {
     file << "Settling time (2%)," << Ts << ",s,\n";
 
     // Damped/Overshoot parameters only exist for underdamped systems.
-    if (zeta < 1) {
-        double wd = wn * sqrt(1 - pow(zeta, 2));
-        double Td = 2 * pi / wd;
-        double Mp = 100 * pow(e, (-zeta * pi) / sqrt(1 - pow(zeta, 2)));
-        double delta = (2 * pi * zeta) / sqrt(1 - pow(zeta, 2));
+    double wd, Td, Mp, delta;
+    if (damped_parameters(s, wd, Td, Mp, delta)) {
         file << "Damped frequency (wd)," << wd << ",rad/s,\n";
         file << "Damped period (Td)," << Td << ",s,\n";
         file << "Overshoot (Mp)," << Mp << ",%,\n";
@@ -57,26 +82,289 @@ void export_parameters(const MassSpringDamper& s) {
         file << "Logarithmic decrement (delta),N/A,,Not applicable\n";
     }
 
-    file.close();
-    cout << "'system_parameters.csv' successfully exported!" << endl;
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' successfully exported!" << endl;
+    return true;
 }
 
 
-void export_results(const vector<double>& t, const vector<double>& x, const vector<double>& v, const vector<double>& a){
-    ofstream file("results.csv");
+bool export_results(const vector<double>& t, const vector<double>& x, const vector<double>& v, const vector<double>& a, const string& filename){
+    MSD_TRACE_SCOPE(scope, "export", "results");
+    ofstream file(filename);
     if (!file.is_open()) {
-        cout << "Error: could not create 'results.csv'" << endl;
-        return;
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
     }
 
     file << "time(s),position(m),velocity(m/s),acceleration(m/s^2)\n";
+    file << setprecision(numeric_limits<double>::max_digits10);
 
     for (size_t i = 0; i < t.size(); i++) {
         file << t[i] << "," << x[i] << "," << v[i] << "," << a[i] << "\n";
     }
 
-    file.close();
-    cout << "'results.csv' file successfully exported!" << endl;
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_results_csv(const string& binary_file, const string& csv_file){
+    MSD_TRACE_SCOPE(scope, "export", "msdt to csv");
+    TrajectoryFile traj;
+    if(!traj.open(binary_file)) return false;
+
+    ofstream file(csv_file);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << csv_file << "'" << endl;
+        return false;
+    }
+
+    file << "time(s),position(m),velocity(m/s),acceleration(m/s^2)\n";
+    file << setprecision(numeric_limits<double>::max_digits10);
+
+    for (size_t b = 0; b < traj.block_count(); b++) {
+        const double *t = traj.t(b), *x = traj.x(b), *v = traj.v(b), *a = traj.a(b);
+        for (size_t i = 0; i < traj.block_length(b); i++) {
+            file << t[i] << "," << x[i] << "," << v[i] << "," << a[i] << "\n";
+        }
+    }
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, csv_file)) return false;
+    cout << "'" << csv_file << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_frequency_response(const MassSpringDamper& s, const vector<FrequencyPoint>& points, const string& filename){
+    MSD_TRACE_SCOPE(scope, "export", "frequency response");
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    double wn = s.get_wn(), zeta = s.get_zeta();
+    double wd, Td, Mp, delta;
+    file << "# Mass (m)," << s.get_m() << ",kg\n";
+    file << "# Damping coefficient (c)," << s.get_c() << ",N·s/m\n";
+    file << "# Spring constant (k)," << s.get_k() << ",N/m\n";
+    file << "# Natural frequency (wn)," << wn << ",rad/s\n";
+    file << "# Damping ratio (zeta)," << zeta << ",-\n";
+    if (damped_parameters(s, wd, Td, Mp, delta)) {
+        file << "# Damped frequency (wd)," << wd << ",rad/s\n";
+        file << "# Overshoot (Mp)," << Mp << ",%\n";
+    } else {
+        file << "# Damped frequency (wd),N/A,rad/s\n";
+        file << "# Overshoot (Mp),0,%\n";
+    }
+    // A resonance peak only exists for zeta < 1/sqrt(2).
+    if (zeta < 1 / sqrt(2.0)) {
+        file << "# Resonant frequency (wr)," << wn * sqrt(1 - 2 * zeta * zeta) << ",rad/s\n";
+        file << "# Resonant peak (|H| max)," << 1 / (2 * s.get_k() * zeta * sqrt(1 - zeta * zeta)) << ",m/N\n";
+    } else {
+        file << "# Resonant frequency (wr),N/A,rad/s\n";
+        file << "# Resonant peak (|H| max)," << 1 / s.get_k() << ",m/N\n";
+    }
+
+    file << "omega(rad/s),frequency(Hz),amplitude(m/N),magnitude(dB),phase(deg)\n";
+    file << setprecision(numeric_limits<double>::max_digits10);
+    for (const FrequencyPoint& p : points) {
+        file << p.omega << "," << p.omega / (2 * pi) << "," << p.amplitude << ","
+             << 20 * log10(p.amplitude) << "," << p.phase * 180 / pi << "\n";
+    }
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_fit_results(const FitResult& best, const vector<FitResult>& starts, const string& filename){
+    MSD_TRACE_SCOPE(scope, "export", "fit");
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    file << "start,c0(N.s/m),k0(N/m),c(N.s/m),k(N/m),c_error(N.s/m),k_error(N/m),rms(m),iterations,converged\n";
+    file << setprecision(numeric_limits<double>::max_digits10);
+
+    auto row = [&](const string& name, const FitResult& f){
+        file << name << "," << f.c0 << "," << f.k0 << "," << f.c << "," << f.k << "," << f.c_error << ","
+             << f.k_error << "," << f.rms << "," << f.iterations << "," << (f.converged ? "yes" : "no") << "\n";
+    };
+    row("best", best);
+    for (size_t i = 0; i < starts.size(); i++) row(to_string(i), starts[i]);
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_parareal(const PararealResult& result, const string& filename){
+    MSD_TRACE_SCOPE(scope, "export", "parareal");
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    file << "# Iterations," << result.iterations
+         << (result.converged ? "" : result.serial_fallback ? " (not converged, fell back to serial)" : " (not converged)") << "\n";
+    for (size_t i = 0; i < result.corrections.size(); i++) {
+        file << "# Correction " << (i + 1) << "," << result.corrections[i] << "\n";
+    }
+    file << "# Seconds," << result.seconds << "\n";
+    if (result.serial_seconds > 0) {
+        file << "# Serial seconds," << result.serial_seconds << "\n";
+        file << "# Speedup," << result.speedup << "\n";
+        file << "# Max deviation from serial (m)," << result.max_deviation << "\n";
+    }
+    file << "time(s),position(m),velocity(m/s)\n";
+    file << setprecision(numeric_limits<double>::max_digits10);
+    for (size_t j = 0; j < result.t.size(); j++) {
+        file << result.t[j] << "," << result.x[j] << "," << result.v[j] << "\n";
+    }
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_latency_histogram(const LatencyHistogram& latency, const LatencyHistogram& jitter, const string& filename){
+    MSD_TRACE_SCOPE(scope, "export", "latency");
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    file << "# Steps," << latency.count() << "\n";
+    file << "bucket_upper(ns),latency_count,jitter_count\n";
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        if (latency.bucket(i) == 0 && jitter.bucket(i) == 0) continue;
+        file << LatencyHistogram::bucket_upper(i) << "," << latency.bucket(i) << "," << jitter.bucket(i) << "\n";
+    }
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_monte_carlo(const MonteCarloResult& result, const string& filename){
+    MSD_TRACE_SCOPE(scope, "export", "monte carlo");
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    file << "# Accepted samples," << result.accepted << "\n";
+    file << "# Rejected samples," << result.rejected << "\n";
+    file << "metric,unit,count,mean,std,min,p5,p50,p95,max\n";
+    file << setprecision(numeric_limits<double>::max_digits10);
+
+    const RunningStats* stats[3] = { &result.settling_time, &result.overshoot, &result.peak };
+    const char* names[3] = { "settling_time", "overshoot", "peak" };
+    const char* units[3] = { "s", "%", "m" };
+    for (int i = 0; i < 3; i++) {
+        const RunningStats& r = *stats[i];
+        file << names[i] << "," << units[i] << "," << r.count << "," << r.mean << "," << r.stddev() << ","
+             << r.min << "," << r.percentile(5) << "," << r.percentile(50) << "," << r.percentile(95) << "," << r.max << "\n";
+    }
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_trace(const string& filename){
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    vector<TraceThreadLog> logs = trace_snapshot();
+    file << fixed << setprecision(3); // Timestamps in us, to the ns
+    file << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"summary\":\"" << trace_summary() << "\"},\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"msd\"}}";
+
+    // Running totals of steps and bytes, drawn by the viewer as counter tracks.
+    struct Mark{ uint64_t t_ns, steps, bytes; };
+    vector<Mark> marks;
+
+    for (const TraceThreadLog& log : logs) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << log.id
+             << ",\"args\":{\"name\":\"" << log.name << "\"}}";
+        for (const TraceEvent& e : log.events) {
+            file << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"msd\",\"ph\":\"X\",\"pid\":1,\"tid\":" << log.id
+                 << ",\"ts\":" << e.start_ns / 1e3 << ",\"dur\":" << e.duration_ns / 1e3 << ",\"args\":{";
+            const char* sep = "";
+            if (e.detail) { file << "\"detail\":\"" << e.detail << "\""; sep = ","; }
+            if (e.stop >= 0) { file << sep << "\"steps\":" << e.steps << ",\"stop\":\"" << stop_reason_name(e.stop) << "\""; sep = ","; }
+            else if (e.steps > 0) { file << sep << "\"steps\":" << e.steps; sep = ","; }
+            if (e.bytes > 0) file << sep << "\"bytes\":" << e.bytes;
+            file << "}}";
+            if (e.steps > 0 || e.bytes > 0) marks.push_back({e.start_ns + e.duration_ns, e.steps, e.bytes});
+        }
+    }
+
+    sort(marks.begin(), marks.end(), [](const Mark& a, const Mark& b){ return a.t_ns < b.t_ns; });
+    uint64_t steps = 0, bytes = 0;
+    for (const Mark& m : marks) {
+        steps += m.steps;
+        bytes += m.bytes;
+        file << ",\n{\"name\":\"totals\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << m.t_ns / 1e3
+             << ",\"args\":{\"steps\":" << steps << ",\"bytes written\":" << bytes << "}}";
+    }
+    file << "\n]}\n";
+
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+bool export_batch_results(const vector<BatchResult>& results, const char* filename, bool precision_columns){
+    MSD_TRACE_SCOPE(scope, "export", "batch");
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: could not create '" << filename << "'" << endl;
+        return false;
+    }
+
+    file << "m(kg),c(N.s/m),k(N/m),x0(m),v0(m/s),zeta,peak(m),settling_time(s),final_amplitude(m),steps"
+         << (precision_columns ? ",float_error,rerun\n" : "\n");
+    file << setprecision(10);
+
+    for (const BatchResult& r : results) {
+        const MassSpringDamper& s = r.system;
+        file << s.get_m() << "," << s.get_c() << "," << s.get_k() << "," << s.get_xo() << "," << s.get_vo() << ","
+             << s.get_zeta() << "," << r.summary.peak << "," << r.summary.settling_time << ","
+             << r.summary.final_amplitude << "," << r.summary.steps;
+        if(precision_columns) file << "," << r.float_error << "," << (r.rerun ? 1 : 0);
+        file << "\n";
+    }
+
+    MSD_TRACE_BYTES(scope, uint64_t(file.tellp()));
+    if(!close_export(file, filename)) return false;
+    cout << "'" << filename << "' file successfully exported!" << endl;
+    return true;
+}
+
+void clearScreen() {
+    #ifdef _WIN32
+        system("cls");
+    #else
+        cout << "\033[2J\033[H" << flush;
+    #endif
 }
 
 void pauseAndClear() {
@@ -86,10 +374,5 @@ void pauseAndClear() {
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
     cin.get();
     
-    // Cross-platform screen clear
-    #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
-    #endif
+    clearScreen();
 }
\ No newline at end of file